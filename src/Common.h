@@ -12,9 +12,25 @@
 #include <HandmadeMath/HandmadeMath.h>
 /*----- END  LIBRARIES-----*/
 // Standard Library
+#include <cstdint>
 #include <cstdio>
 
 #define LOGF(...) printf(__VA_ARGS__)
 #define ARRAY_SIZE(a) (sizeof(a) / sizeof(a[0]))
 
+namespace Lofi
+{
+// fopen_s is MSVC-only; everywhere else plain fopen is fine
+inline FILE* FileOpen(const char* Filename, const char* Mode)
+{
+    FILE* Result = nullptr;
+#if defined(_MSC_VER)
+    fopen_s(&Result, Filename, Mode);
+#else
+    Result = fopen(Filename, Mode);
+#endif
+    return Result;
+}
+}
+
 #endif // COMMON_H
\ No newline at end of file
@@ -0,0 +1,422 @@
+#include "LofiAllocTracker.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+#if LOFI_ALLOC_TRACKING && defined(_MSC_VER)
+#include <intrin.h>
+#define LOFI_RETURN_ADDRESS() _ReturnAddress()
+#elif LOFI_ALLOC_TRACKING
+#define LOFI_RETURN_ADDRESS() __builtin_return_address(0)
+#endif
+
+// glibc lets the executable replace malloc and still reach the real one; MSVC debug CRTs report through a hook
+#if LOFI_ALLOC_TRACKING && defined(__GLIBC__)
+#include <dlfcn.h>
+#define LOFI_ALLOC_GLIBC 1
+extern "C" void* __libc_malloc(size_t Size);
+extern "C" void* __libc_calloc(size_t Num, size_t Size);
+extern "C" void* __libc_realloc(void* Ptr, size_t Size);
+#else
+#define LOFI_ALLOC_GLIBC 0
+#endif
+#if LOFI_ALLOC_TRACKING && defined(_MSC_VER) && defined(_DEBUG)
+#include <crtdbg.h>
+#define LOFI_ALLOC_CRT_HOOK 1
+extern "C" char __ImageBase;
+#else
+#define LOFI_ALLOC_CRT_HOOK 0
+#endif
+
+namespace Lofi
+{
+#if LOFI_ALLOC_TRACKING
+// DEV_NOTE: Everything here is reachable from inside malloc, even before main; it must be constant
+//     initialized and must not allocate (no locks on the counting path either)
+struct AllocCounters
+{
+    std::atomic<uint64_t> NumAllocs{ 0 };
+    std::atomic<uint64_t> Bytes{ 0 };
+
+    void Add(size_t Size)
+    {
+        NumAllocs.fetch_add(1, std::memory_order_relaxed);
+        Bytes.fetch_add(Size, std::memory_order_relaxed);
+    }
+    AllocCounts Load() const
+    {
+        AllocCounts Result;
+        Result.NumAllocs = NumAllocs.load(std::memory_order_relaxed);
+        Result.Bytes = Bytes.load(std::memory_order_relaxed);
+        return Result;
+    }
+};
+
+struct AllocSlot
+{
+    char Name[MaxAllocNameLength];
+    bool bExempt; // Tags only, set before the tag is published
+    AllocCounters Total;
+    AllocCounts FrameStart;
+    AllocCounts LastFrame;
+};
+
+struct AllocCallSite
+{
+    std::atomic<uintptr_t> Address{ 0 };
+    AllocCounters Counts;
+};
+
+struct AllocTrackerState_t
+{
+    AllocCounters Total;
+    AllocCounters Frame; // Outside exempt scopes
+    AllocCounters ExemptTotal;
+
+    std::mutex NamesMutex; // RegisterTag and SetThreadName only
+    AllocSlot Tags[MaxAllocTags] = {}; // Tag 0 is "Untagged", named by Init
+    std::atomic<int> NumTags{ 1 };
+    AllocSlot Threads[MaxAllocThreads] = {};
+    std::atomic<int> NumThreads{ 0 };
+
+    AllocCallSite CallSites[MaxAllocCallSites];
+    std::atomic<uint64_t> NumDroppedCallSites{ 0 };
+} AllocTrackerState;
+
+thread_local int AllocCurrentTag = 0;
+thread_local int AllocThreadIdx = -1;
+thread_local bool bAllocInOperatorNew = false;
+
+int GetAllocThreadIdx()
+{
+    if (AllocThreadIdx < 0)
+    {
+        const int ThreadIdx = AllocTrackerState.NumThreads.fetch_add(1, std::memory_order_relaxed);
+        AllocThreadIdx = ThreadIdx < MaxAllocThreads ? ThreadIdx : MaxAllocThreads - 1;
+    }
+    return AllocThreadIdx;
+}
+
+void RecordCallSite(uintptr_t Address, size_t Size)
+{
+    constexpr int MaxProbes = 16;
+    const uint64_t Hash = ((uint64_t)Address >> 2) * 0x9E3779B97F4A7C15ull;
+    for (int ProbeIdx = 0; ProbeIdx < MaxProbes; ProbeIdx++)
+    {
+        AllocCallSite& Site = AllocTrackerState.CallSites[(Hash + ProbeIdx) & (MaxAllocCallSites - 1)];
+        uintptr_t SiteAddress = Site.Address.load(std::memory_order_relaxed);
+        if (SiteAddress == 0 && Site.Address.compare_exchange_strong(SiteAddress, Address, std::memory_order_relaxed))
+        {
+            SiteAddress = Address;
+        }
+        if (SiteAddress == Address)
+        {
+            Site.Counts.Add(Size);
+            return;
+        }
+    }
+    AllocTrackerState.NumDroppedCallSites.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TrackAllocation(size_t Size, void* CallSite)
+{
+    AllocTrackerState_t& State = AllocTrackerState;
+    AllocSlot& Tag = State.Tags[AllocCurrentTag];
+    State.Total.Add(Size);
+    Tag.Total.Add(Size);
+    State.Threads[GetAllocThreadIdx()].Total.Add(Size);
+    if (Tag.bExempt)
+    {
+        State.ExemptTotal.Add(Size);
+        return;
+    }
+    State.Frame.Add(Size);
+#if LOFI_ALLOC_CALLSITES
+    if (CallSite) { RecordCallSite((uintptr_t)CallSite, Size); }
+#else
+    (void)CallSite;
+#endif
+}
+
+void* TrackedNew(size_t Size, void* CallSite)
+{
+    TrackAllocation(Size, CallSite);
+#if LOFI_ALLOC_GLIBC
+    return __libc_malloc(Size ? Size : 1);
+#else
+    bAllocInOperatorNew = true; // The CRT hook already saw this one
+    void* Result = malloc(Size ? Size : 1);
+    bAllocInOperatorNew = false;
+    return Result;
+#endif
+}
+
+#if LOFI_ALLOC_CRT_HOOK
+int CRTAllocHook(int AllocType, void* UserData, size_t Size, int BlockType, long RequestNumber, const unsigned char* Filename, int LineNumber)
+{
+    (void)UserData; (void)RequestNumber; (void)Filename; (void)LineNumber;
+    const bool bAlloc = AllocType == _HOOK_ALLOC || AllocType == _HOOK_REALLOC;
+    if (bAlloc && BlockType != _CRT_BLOCK && !bAllocInOperatorNew) { TrackAllocation(Size, nullptr); }
+    return TRUE;
+}
+#endif
+
+void AllocTracker::Init()
+{
+    snprintf(AllocTrackerState.Tags[0].Name, MaxAllocNameLength, "Untagged");
+#if LOFI_ALLOC_CRT_HOOK
+    _CrtSetAllocHook(CRTAllocHook);
+#endif
+}
+
+void BeginSlotFrame(AllocSlot& Slot)
+{
+    Slot.FrameStart = Slot.Total.Load();
+}
+
+void EndSlotFrame(AllocSlot& Slot)
+{
+    const AllocCounts Now = Slot.Total.Load();
+    Slot.LastFrame.NumAllocs = Now.NumAllocs - Slot.FrameStart.NumAllocs;
+    Slot.LastFrame.Bytes = Now.Bytes - Slot.FrameStart.Bytes;
+}
+
+void AllocTracker::BeginFrame()
+{
+    AllocTrackerState_t& State = AllocTrackerState;
+    const int NumTags = State.NumTags.load(std::memory_order_acquire);
+    const int NumThreads = HMM_MIN(State.NumThreads.load(std::memory_order_relaxed), MaxAllocThreads);
+    for (int TagIdx = 0; TagIdx < NumTags; TagIdx++) { BeginSlotFrame(State.Tags[TagIdx]); }
+    for (int ThreadIdx = 0; ThreadIdx < NumThreads; ThreadIdx++) { BeginSlotFrame(State.Threads[ThreadIdx]); }
+    State.Frame.NumAllocs.store(0, std::memory_order_relaxed);
+    State.Frame.Bytes.store(0, std::memory_order_relaxed);
+}
+
+AllocCounts AllocTracker::EndFrame()
+{
+    AllocTrackerState_t& State = AllocTrackerState;
+    const AllocCounts Result = State.Frame.Load();
+    const int NumTags = State.NumTags.load(std::memory_order_acquire);
+    const int NumThreads = HMM_MIN(State.NumThreads.load(std::memory_order_relaxed), MaxAllocThreads);
+    for (int TagIdx = 0; TagIdx < NumTags; TagIdx++) { EndSlotFrame(State.Tags[TagIdx]); }
+    for (int ThreadIdx = 0; ThreadIdx < NumThreads; ThreadIdx++) { EndSlotFrame(State.Threads[ThreadIdx]); }
+    return Result;
+}
+
+AllocCounts AllocTracker::GetTotal()
+{
+    return AllocTrackerState.Total.Load();
+}
+
+AllocCounts AllocTracker::GetExemptTotal()
+{
+    return AllocTrackerState.ExemptTotal.Load();
+}
+
+void AllocTracker::SetThreadName(const char* Name)
+{
+    std::lock_guard<std::mutex> Lock(AllocTrackerState.NamesMutex);
+    snprintf(AllocTrackerState.Threads[GetAllocThreadIdx()].Name, MaxAllocNameLength, "%s", Name);
+}
+
+int AllocTracker::RegisterTag(const char* Name, bool bExempt)
+{
+    AllocTrackerState_t& State = AllocTrackerState;
+    std::lock_guard<std::mutex> Lock(State.NamesMutex);
+    const int NumTags = State.NumTags.load(std::memory_order_relaxed);
+    for (int TagIdx = 0; TagIdx < NumTags; TagIdx++)
+    {
+        if (0 == strcmp(State.Tags[TagIdx].Name, Name)) { return TagIdx; }
+    }
+    if (NumTags == MaxAllocTags)
+    {
+        LOGF("AllocTracker: out of tags, %s is counted as Untagged\n", Name);
+        return 0;
+    }
+    snprintf(State.Tags[NumTags].Name, MaxAllocNameLength, "%s", Name);
+    State.Tags[NumTags].bExempt = bExempt;
+    State.NumTags.store(NumTags + 1, std::memory_order_release);
+    return NumTags;
+}
+
+void AllocTracker::ResetCallSites()
+{
+    for (AllocCallSite& Site : AllocTrackerState.CallSites)
+    {
+        Site.Address.store(0, std::memory_order_relaxed);
+        Site.Counts.NumAllocs.store(0, std::memory_order_relaxed);
+        Site.Counts.Bytes.store(0, std::memory_order_relaxed);
+    }
+    AllocTrackerState.NumDroppedCallSites.store(0, std::memory_order_relaxed);
+}
+
+const char* GetThreadLabel(int ThreadIdx, char* Buffer, int BufferSize)
+{
+    const char* Name = AllocTrackerState.Threads[ThreadIdx].Name;
+    if (Name[0]) { return Name; }
+    snprintf(Buffer, BufferSize, ThreadIdx == MaxAllocThreads - 1 ? "Thread %d+" : "Thread %d", ThreadIdx);
+    return Buffer;
+}
+
+void LogCallSite(const AllocCallSite& Site)
+{
+    const uintptr_t Address = Site.Address.load(std::memory_order_relaxed);
+    const AllocCounts Counts = Site.Counts.Load();
+    // Module relative where possible, so the address can be looked up after the process is gone
+#if LOFI_ALLOC_GLIBC
+    Dl_info Info;
+    if (dladdr((void*)Address, &Info) && Info.dli_fname)
+    {
+        LOGF("    %10llu %12llu  %s+0x%llx (%s)\n", (unsigned long long)Counts.NumAllocs, (unsigned long long)Counts.Bytes,
+            Info.dli_fname, (unsigned long long)(Address - (uintptr_t)Info.dli_fbase), Info.dli_sname ? Info.dli_sname : "?");
+        return;
+    }
+#elif LOFI_ALLOC_CRT_HOOK
+    LOGF("    %10llu %12llu  exe+0x%llx\n", (unsigned long long)Counts.NumAllocs, (unsigned long long)Counts.Bytes,
+        (unsigned long long)(Address - (uintptr_t)&__ImageBase));
+    return;
+#endif
+    LOGF("    %10llu %12llu  0x%llx\n", (unsigned long long)Counts.NumAllocs, (unsigned long long)Counts.Bytes, (unsigned long long)Address);
+}
+
+void AllocTracker::LogFrame()
+{
+    AllocTrackerState_t& State = AllocTrackerState;
+    const int NumTags = State.NumTags.load(std::memory_order_acquire);
+    const int NumThreads = HMM_MIN(State.NumThreads.load(std::memory_order_relaxed), MaxAllocThreads);
+    LOGF("    %-24s %10s %12s\n", "Subsystem", "Allocs", "Bytes");
+    for (int TagIdx = 0; TagIdx < NumTags; TagIdx++)
+    {
+        const AllocCounts& Counts = State.Tags[TagIdx].LastFrame;
+        if (Counts.NumAllocs == 0) { continue; }
+        LOGF("    %-24s %10llu %12llu%s\n", State.Tags[TagIdx].Name, (unsigned long long)Counts.NumAllocs, (unsigned long long)Counts.Bytes,
+            State.Tags[TagIdx].bExempt ? "  (exempt)" : "");
+    }
+    LOGF("    %-24s %10s %12s\n", "Thread", "Allocs", "Bytes");
+    for (int ThreadIdx = 0; ThreadIdx < NumThreads; ThreadIdx++)
+    {
+        const AllocCounts& Counts = State.Threads[ThreadIdx].LastFrame;
+        if (Counts.NumAllocs == 0) { continue; }
+        char Label[MaxAllocNameLength];
+        LOGF("    %-24s %10llu %12llu\n", GetThreadLabel(ThreadIdx, Label, MaxAllocNameLength),
+            (unsigned long long)Counts.NumAllocs, (unsigned long long)Counts.Bytes);
+    }
+
+#if LOFI_ALLOC_CALLSITES
+    // Busiest sites first, a selection pass per line is plenty for a failure report
+    constexpr int MaxLoggedCallSites = 16;
+    bool bLogged[MaxAllocCallSites] = {};
+    LOGF("    Call sites since warm-up (%llu not recorded, table full):\n", (unsigned long long)State.NumDroppedCallSites.load());
+    LOGF("    %10s %12s  %s\n", "Allocs", "Bytes", "Return address");
+    for (int LineIdx = 0; LineIdx < MaxLoggedCallSites; LineIdx++)
+    {
+        int BestIdx = -1;
+        for (int SiteIdx = 0; SiteIdx < MaxAllocCallSites; SiteIdx++)
+        {
+            const AllocCallSite& Site = State.CallSites[SiteIdx];
+            if (bLogged[SiteIdx] || Site.Address.load(std::memory_order_relaxed) == 0) { continue; }
+            if (BestIdx < 0 || Site.Counts.NumAllocs.load() > State.CallSites[BestIdx].Counts.NumAllocs.load()) { BestIdx = SiteIdx; }
+        }
+        if (BestIdx < 0) { break; }
+        bLogged[BestIdx] = true;
+        LogCallSite(State.CallSites[BestIdx]);
+    }
+#endif
+}
+
+void AllocTracker::LogTotals()
+{
+    AllocTrackerState_t& State = AllocTrackerState;
+    const AllocCounts Total = State.Total.Load();
+    const AllocCounts Exempt = State.ExemptTotal.Load();
+    LOGF("    Heap allocations since startup: %llu, %llu bytes%s; %llu of them (%llu bytes) in exempt driver/platform calls\n",
+        (unsigned long long)Total.NumAllocs, (unsigned long long)Total.Bytes, LOFI_ALLOC_GLIBC || LOFI_ALLOC_CRT_HOOK ? "" : " (operator new only)",
+        (unsigned long long)Exempt.NumAllocs, (unsigned long long)Exempt.Bytes);
+    LOGF("    %-24s %10s %12s\n", "Subsystem", "Allocs", "Bytes");
+    const int NumTags = State.NumTags.load(std::memory_order_acquire);
+    for (int TagIdx = 0; TagIdx < NumTags; TagIdx++)
+    {
+        const AllocCounts Counts = State.Tags[TagIdx].Total.Load();
+        LOGF("    %-24s %10llu %12llu%s\n", State.Tags[TagIdx].Name, (unsigned long long)Counts.NumAllocs, (unsigned long long)Counts.Bytes,
+            State.Tags[TagIdx].bExempt ? "  (exempt)" : "");
+    }
+    LOGF("    %-24s %10s %12s\n", "Thread", "Allocs", "Bytes");
+    const int NumThreads = HMM_MIN(State.NumThreads.load(std::memory_order_relaxed), MaxAllocThreads);
+    for (int ThreadIdx = 0; ThreadIdx < NumThreads; ThreadIdx++)
+    {
+        const AllocCounts Counts = State.Threads[ThreadIdx].Total.Load();
+        char Label[MaxAllocNameLength];
+        LOGF("    %-24s %10llu %12llu\n", GetThreadLabel(ThreadIdx, Label, MaxAllocNameLength),
+            (unsigned long long)Counts.NumAllocs, (unsigned long long)Counts.Bytes);
+    }
+}
+#else
+void AllocTracker::Init() {}
+void AllocTracker::BeginFrame() {}
+AllocCounts AllocTracker::EndFrame() { return AllocCounts{}; }
+AllocCounts AllocTracker::GetTotal() { return AllocCounts{}; }
+AllocCounts AllocTracker::GetExemptTotal() { return AllocCounts{}; }
+void AllocTracker::SetThreadName(const char* Name) { (void)Name; }
+int AllocTracker::RegisterTag(const char* Name, bool bExempt) { (void)Name; (void)bExempt; return 0; }
+void AllocTracker::ResetCallSites() {}
+void AllocTracker::LogFrame() {}
+void AllocTracker::LogTotals() { LOGF("    Allocation tracking compiled out (LOFI_ALLOC_TRACKING=0)\n"); }
+#endif
+}
+
+#if LOFI_ALLOC_TRACKING
+// Replacements for the global allocation functions, these must live at global scope
+void* operator new(size_t Size)
+{
+    void* Result = Lofi::TrackedNew(Size, LOFI_RETURN_ADDRESS());
+    if (!Result) { throw std::bad_alloc(); }
+    return Result;
+}
+
+void* operator new[](size_t Size)
+{
+    void* Result = Lofi::TrackedNew(Size, LOFI_RETURN_ADDRESS());
+    if (!Result) { throw std::bad_alloc(); }
+    return Result;
+}
+
+void* operator new(size_t Size, const std::nothrow_t&) noexcept
+{
+    return Lofi::TrackedNew(Size, LOFI_RETURN_ADDRESS());
+}
+
+void* operator new[](size_t Size, const std::nothrow_t&) noexcept
+{
+    return Lofi::TrackedNew(Size, LOFI_RETURN_ADDRESS());
+}
+
+void operator delete(void* Ptr) noexcept { free(Ptr); }
+void operator delete[](void* Ptr) noexcept { free(Ptr); }
+void operator delete(void* Ptr, const std::nothrow_t&) noexcept { free(Ptr); }
+void operator delete[](void* Ptr, const std::nothrow_t&) noexcept { free(Ptr); }
+void operator delete(void* Ptr, size_t) noexcept { free(Ptr); }
+void operator delete[](void* Ptr, size_t) noexcept { free(Ptr); }
+
+#if LOFI_ALLOC_GLIBC
+extern "C" void* malloc(size_t Size) noexcept
+{
+    Lofi::TrackAllocation(Size, LOFI_RETURN_ADDRESS());
+    return __libc_malloc(Size);
+}
+
+extern "C" void* calloc(size_t Num, size_t Size) noexcept
+{
+    Lofi::TrackAllocation(Num * Size, LOFI_RETURN_ADDRESS());
+    return __libc_calloc(Num, Size);
+}
+
+extern "C" void* realloc(void* Ptr, size_t Size) noexcept
+{
+    Lofi::TrackAllocation(Size, LOFI_RETURN_ADDRESS());
+    return __libc_realloc(Ptr, Size);
+}
+#endif
+#endif
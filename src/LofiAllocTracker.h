@@ -0,0 +1,95 @@
+#ifndef LOFIALLOCTRACKER_H
+#define LOFIALLOCTRACKER_H
+
+#include "Common.h"
+
+// Build with LOFI_ALLOC_TRACKING=0 to leave operator new / malloc alone; ALLOC_SCOPE then compiles out
+#if !defined(LOFI_ALLOC_TRACKING)
+#define LOFI_ALLOC_TRACKING 1
+#endif
+
+// Debug builds also count allocations per return address
+#if !defined(LOFI_ALLOC_CALLSITES)
+#if LOFI_ALLOC_TRACKING && !defined(NDEBUG)
+#define LOFI_ALLOC_CALLSITES 1
+#else
+#define LOFI_ALLOC_CALLSITES 0
+#endif
+#endif
+
+namespace Lofi
+{
+constexpr int MaxAllocTags = 32;
+constexpr int MaxAllocThreads = 64; // Later threads share the last slot
+constexpr int MaxAllocCallSites = 1024; // Power of two
+constexpr int MaxAllocNameLength = 32;
+
+struct AllocCounts
+{
+    uint64_t NumAllocs = 0;
+    uint64_t Bytes = 0;
+};
+
+/*
+    Counts every heap allocation: operator new everywhere, plus malloc / calloc / realloc where they
+        can be interposed (glibc; the CRT's alloc hook in MSVC debug builds). Each allocation is
+        charged to its thread, to the innermost ALLOC_SCOPE on that thread ("Untagged" outside any),
+        to the current frame and, with LOFI_ALLOC_CALLSITES, to the address that called the allocator.
+    Frees aren't tracked, the point is finding allocations that shouldn't happen at all.
+    ALLOC_EXEMPT_SCOPE wraps individual driver and platform calls (gl*, glfw*) whose allocations the
+        engine can't avoid: they're still reported under the scope's tag, but EndFrame leaves them out
+        and they get no call site. Keep engine code out of them, anything it allocated would go unseen;
+        an ALLOC_SCOPE nested inside one counts as usual again.
+*/
+struct AllocTracker
+{
+    // Installs the CRT hook where there is one, call before anything worth counting
+    static void Init();
+
+    // Frame boundaries: everything allocated between BeginFrame and EndFrame, on any thread, is that frame's;
+    //     EndFrame returns the frame's allocations outside exempt scopes
+    static void BeginFrame();
+    static AllocCounts EndFrame();
+    static AllocCounts GetTotal();
+    // Everything allocated inside exempt scopes since startup
+    static AllocCounts GetExemptTotal();
+
+    // Shown in reports instead of the slot number; Profiler::SetThreadName forwards here
+    static void SetThreadName(const char* Name);
+    // A name's first registration decides whether the tag is exempt
+    static int RegisterTag(const char* Name, bool bExempt = false);
+
+    // Forgets the call sites seen so far; main thread, between frames
+    static void ResetCallSites();
+    // Tags and threads that allocated during the last frame, call sites since ResetCallSites
+    static void LogFrame();
+    // Every tag and thread since startup
+    static void LogTotals();
+};
+
+#if LOFI_ALLOC_TRACKING
+extern thread_local int AllocCurrentTag;
+
+struct AllocScope
+{
+    AllocScope(int Tag) : PrevTag(AllocCurrentTag) { AllocCurrentTag = Tag; }
+    ~AllocScope() { AllocCurrentTag = PrevTag; }
+    int PrevTag;
+};
+
+#define LOFI_ALLOC_JOIN2(A, B) A##B
+#define LOFI_ALLOC_JOIN(A, B) LOFI_ALLOC_JOIN2(A, B)
+// Name must be a string literal; the tag is looked up once per call site
+#define ALLOC_SCOPE(Name) \
+    static const int LOFI_ALLOC_JOIN(AllocTag_, __LINE__) = ::Lofi::AllocTracker::RegisterTag(Name); \
+    ::Lofi::AllocScope LOFI_ALLOC_JOIN(AllocScope_, __LINE__){ LOFI_ALLOC_JOIN(AllocTag_, __LINE__) }
+#define ALLOC_EXEMPT_SCOPE(Name) \
+    static const int LOFI_ALLOC_JOIN(AllocTag_, __LINE__) = ::Lofi::AllocTracker::RegisterTag(Name, true); \
+    ::Lofi::AllocScope LOFI_ALLOC_JOIN(AllocScope_, __LINE__){ LOFI_ALLOC_JOIN(AllocTag_, __LINE__) }
+#else
+#define ALLOC_SCOPE(Name) do {} while (0)
+#define ALLOC_EXEMPT_SCOPE(Name) do {} while (0)
+#endif
+}
+
+#endif // LOFIALLOCTRACKER_H
@@ -0,0 +1,244 @@
+#include "LofiCulling.h"
+
+#include <cmath>
+
+#if LOFI_CULL_AVX2
+#include <immintrin.h>
+#elif LOFI_CULL_SSE
+#include <emmintrin.h>
+#endif
+
+namespace Lofi
+{
+constexpr int CullBlockSize = 8;
+
+Frustum Culling::ExtractFrustum(const m4f& ViewProj)
+{
+    // Gribb/Hartmann: clip-space -w <= x,y,z <= w, so every plane is the last row plus or minus one of the others
+    //     DEV_NOTE: HMM matrices are column-major, Elements[Col][Row]
+    const float (&M)[4][4] = ViewProj.Elements;
+    const v4f Rows[4] = {
+        v4f{ M[0][0], M[1][0], M[2][0], M[3][0] },
+        v4f{ M[0][1], M[1][1], M[2][1], M[3][1] },
+        v4f{ M[0][2], M[1][2], M[2][2], M[3][2] },
+        v4f{ M[0][3], M[1][3], M[2][3], M[3][3] },
+    };
+
+    Frustum Result;
+    for (int PlaneIdx = 0; PlaneIdx < FrustumPlane_Count; PlaneIdx++)
+    {
+        const v4f& Axis = Rows[PlaneIdx / 2];
+        const float Sign = (PlaneIdx & 1) ? -1.0f : 1.0f; // Left/Bottom/Near add, Right/Top/Far subtract
+        v4f Plane{ Rows[3].X + Sign * Axis.X, Rows[3].Y + Sign * Axis.Y, Rows[3].Z + Sign * Axis.Z, Rows[3].W + Sign * Axis.W };
+        // Unit normals, so the plane equation gives distances that radii and extents can be compared against
+        const float Length = sqrtf(Plane.X * Plane.X + Plane.Y * Plane.Y + Plane.Z * Plane.Z);
+        const float InvLength = Length > 0.0f ? 1.0f / Length : 1.0f;
+        Result.planes[PlaneIdx] = v4f{ Plane.X * InvLength, Plane.Y * InvLength, Plane.Z * InvLength, Plane.W * InvLength };
+    }
+    return Result;
+}
+
+bool IsSphereVisible(const Frustum& View, const BoundingSpheres& Bounds, int ObjIdx)
+{
+    for (const v4f& Plane : View.planes)
+    {
+        const float Dist = Plane.X * Bounds.center_x[ObjIdx] + Plane.Y * Bounds.center_y[ObjIdx] +
+            Plane.Z * Bounds.center_z[ObjIdx] + Plane.W;
+        if (Dist + Bounds.radius[ObjIdx] < 0.0f) { return false; }
+    }
+    return true;
+}
+
+bool IsBoxVisible(const Frustum& View, const BoundingBoxes& Bounds, int ObjIdx)
+{
+    for (const v4f& Plane : View.planes)
+    {
+        const float Dist = Plane.X * Bounds.center_x[ObjIdx] + Plane.Y * Bounds.center_y[ObjIdx] +
+            Plane.Z * Bounds.center_z[ObjIdx] + Plane.W;
+        // Half extents projected onto the normal: how far the box reaches towards the plane
+        const float Reach = fabsf(Plane.X) * Bounds.extent_x[ObjIdx] + fabsf(Plane.Y) * Bounds.extent_y[ObjIdx] +
+            fabsf(Plane.Z) * Bounds.extent_z[ObjIdx];
+        if (Dist + Reach < 0.0f) { return false; }
+    }
+    return true;
+}
+
+int CullSpheresRange(const Frustum& View, const BoundingSpheres& Bounds, int FirstIdx, int Count, uint32_t* OutVisible, int NumVisible)
+{
+    for (int ObjIdx = FirstIdx; ObjIdx < Count; ObjIdx++)
+    {
+        if (IsSphereVisible(View, Bounds, ObjIdx)) { OutVisible[NumVisible++] = (uint32_t)ObjIdx; }
+    }
+    return NumVisible;
+}
+
+int CullBoxesRange(const Frustum& View, const BoundingBoxes& Bounds, int FirstIdx, int Count, uint32_t* OutVisible, int NumVisible)
+{
+    for (int ObjIdx = FirstIdx; ObjIdx < Count; ObjIdx++)
+    {
+        if (IsBoxVisible(View, Bounds, ObjIdx)) { OutVisible[NumVisible++] = (uint32_t)ObjIdx; }
+    }
+    return NumVisible;
+}
+
+int Culling::CullSpheresScalar(const Frustum& View, const BoundingSpheres& Bounds, int Count, uint32_t* OutVisible)
+{
+    return CullSpheresRange(View, Bounds, 0, Count, OutVisible, 0);
+}
+
+int Culling::CullBoxesScalar(const Frustum& View, const BoundingBoxes& Bounds, int Count, uint32_t* OutVisible)
+{
+    return CullBoxesRange(View, Bounds, 0, Count, OutVisible, 0);
+}
+
+#if LOFI_CULL_AVX2 || LOFI_CULL_SSE
+// 8 floats, one per object of a block. Comparisons produce all-ones lanes, like the intrinsics they wrap.
+#if LOFI_CULL_AVX2
+struct Float8
+{
+    __m256 V;
+};
+
+inline Float8 Load8(const float* Src) { return Float8{ _mm256_loadu_ps(Src) }; }
+inline Float8 Splat8(float Value) { return Float8{ _mm256_set1_ps(Value) }; }
+inline Float8 operator+(Float8 A, Float8 B) { return Float8{ _mm256_add_ps(A.V, B.V) }; }
+inline Float8 operator*(Float8 A, Float8 B) { return Float8{ _mm256_mul_ps(A.V, B.V) }; }
+inline Float8 operator&(Float8 A, Float8 B) { return Float8{ _mm256_and_ps(A.V, B.V) }; }
+// Not-less rather than greater-equal: a NaN stays visible, matching the scalar path's (Dist < 0) test
+inline Float8 NotLess8(Float8 A, Float8 B) { return Float8{ _mm256_cmp_ps(A.V, B.V, _CMP_NLT_UQ) }; }
+inline uint32_t MoveMask8(Float8 A) { return (uint32_t)_mm256_movemask_ps(A.V); }
+#else
+struct Float8
+{
+    __m128 Lo;
+    __m128 Hi;
+};
+
+inline Float8 Load8(const float* Src) { return Float8{ _mm_loadu_ps(Src), _mm_loadu_ps(Src + 4) }; }
+inline Float8 Splat8(float Value) { return Float8{ _mm_set1_ps(Value), _mm_set1_ps(Value) }; }
+inline Float8 operator+(Float8 A, Float8 B) { return Float8{ _mm_add_ps(A.Lo, B.Lo), _mm_add_ps(A.Hi, B.Hi) }; }
+inline Float8 operator*(Float8 A, Float8 B) { return Float8{ _mm_mul_ps(A.Lo, B.Lo), _mm_mul_ps(A.Hi, B.Hi) }; }
+inline Float8 operator&(Float8 A, Float8 B) { return Float8{ _mm_and_ps(A.Lo, B.Lo), _mm_and_ps(A.Hi, B.Hi) }; }
+inline Float8 NotLess8(Float8 A, Float8 B) { return Float8{ _mm_cmpnlt_ps(A.Lo, B.Lo), _mm_cmpnlt_ps(A.Hi, B.Hi) }; }
+inline uint32_t MoveMask8(Float8 A) { return (uint32_t)(_mm_movemask_ps(A.Lo) | (_mm_movemask_ps(A.Hi) << 4)); }
+#endif
+
+// Planes broadcast once per call rather than once per block
+struct FrustumLanes
+{
+    Float8 X[FrustumPlane_Count];
+    Float8 Y[FrustumPlane_Count];
+    Float8 Z[FrustumPlane_Count];
+    Float8 W[FrustumPlane_Count];
+    Float8 AbsX[FrustumPlane_Count];
+    Float8 AbsY[FrustumPlane_Count];
+    Float8 AbsZ[FrustumPlane_Count];
+
+    FrustumLanes(const Frustum& View)
+    {
+        for (int PlaneIdx = 0; PlaneIdx < FrustumPlane_Count; PlaneIdx++)
+        {
+            const v4f& Plane = View.planes[PlaneIdx];
+            X[PlaneIdx] = Splat8(Plane.X);
+            Y[PlaneIdx] = Splat8(Plane.Y);
+            Z[PlaneIdx] = Splat8(Plane.Z);
+            W[PlaneIdx] = Splat8(Plane.W);
+            AbsX[PlaneIdx] = Splat8(fabsf(Plane.X));
+            AbsY[PlaneIdx] = Splat8(fabsf(Plane.Y));
+            AbsZ[PlaneIdx] = Splat8(fabsf(Plane.Z));
+        }
+    }
+};
+
+// Branchless compaction: every lane is written, only visible ones advance the cursor.
+//     NumVisible never passes BaseIdx + Lane, so the writes stay inside OutVisible[0, Count).
+inline int AppendVisible(uint32_t Mask, uint32_t BaseIdx, uint32_t* OutVisible, int NumVisible)
+{
+    for (uint32_t Lane = 0; Lane < CullBlockSize; Lane++)
+    {
+        OutVisible[NumVisible] = BaseIdx + Lane;
+        NumVisible += (int)((Mask >> Lane) & 1);
+    }
+    return NumVisible;
+}
+
+int Culling::CullSpheres(const Frustum& View, const BoundingSpheres& Bounds, int Count, uint32_t* OutVisible)
+{
+    const FrustumLanes Lanes{ View };
+    const Float8 Zero = Splat8(0.0f);
+    const Float8 AllSet = NotLess8(Zero, Zero);
+    const int NumBlocks = Count / CullBlockSize;
+    int NumVisible = 0;
+    for (int BlockIdx = 0; BlockIdx < NumBlocks; BlockIdx++)
+    {
+        const int BaseIdx = BlockIdx * CullBlockSize;
+        const Float8 CenterX = Load8(Bounds.center_x + BaseIdx);
+        const Float8 CenterY = Load8(Bounds.center_y + BaseIdx);
+        const Float8 CenterZ = Load8(Bounds.center_z + BaseIdx);
+        const Float8 Radius = Load8(Bounds.radius + BaseIdx);
+
+        Float8 Inside = AllSet;
+        for (int PlaneIdx = 0; PlaneIdx < FrustumPlane_Count; PlaneIdx++)
+        {
+            const Float8 Dist = Lanes.X[PlaneIdx] * CenterX + Lanes.Y[PlaneIdx] * CenterY + Lanes.Z[PlaneIdx] * CenterZ + Lanes.W[PlaneIdx];
+            Inside = Inside & NotLess8(Dist + Radius, Zero);
+        }
+        const uint32_t Mask = MoveMask8(Inside);
+        if (Mask == 0) { continue; }
+        NumVisible = AppendVisible(Mask, (uint32_t)BaseIdx, OutVisible, NumVisible);
+    }
+    return CullSpheresRange(View, Bounds, NumBlocks * CullBlockSize, Count, OutVisible, NumVisible);
+}
+
+int Culling::CullBoxes(const Frustum& View, const BoundingBoxes& Bounds, int Count, uint32_t* OutVisible)
+{
+    const FrustumLanes Lanes{ View };
+    const Float8 Zero = Splat8(0.0f);
+    const Float8 AllSet = NotLess8(Zero, Zero);
+    const int NumBlocks = Count / CullBlockSize;
+    int NumVisible = 0;
+    for (int BlockIdx = 0; BlockIdx < NumBlocks; BlockIdx++)
+    {
+        const int BaseIdx = BlockIdx * CullBlockSize;
+        const Float8 CenterX = Load8(Bounds.center_x + BaseIdx);
+        const Float8 CenterY = Load8(Bounds.center_y + BaseIdx);
+        const Float8 CenterZ = Load8(Bounds.center_z + BaseIdx);
+        const Float8 ExtentX = Load8(Bounds.extent_x + BaseIdx);
+        const Float8 ExtentY = Load8(Bounds.extent_y + BaseIdx);
+        const Float8 ExtentZ = Load8(Bounds.extent_z + BaseIdx);
+
+        Float8 Inside = AllSet;
+        for (int PlaneIdx = 0; PlaneIdx < FrustumPlane_Count; PlaneIdx++)
+        {
+            const Float8 Dist = Lanes.X[PlaneIdx] * CenterX + Lanes.Y[PlaneIdx] * CenterY + Lanes.Z[PlaneIdx] * CenterZ + Lanes.W[PlaneIdx];
+            const Float8 Reach = Lanes.AbsX[PlaneIdx] * ExtentX + Lanes.AbsY[PlaneIdx] * ExtentY + Lanes.AbsZ[PlaneIdx] * ExtentZ;
+            Inside = Inside & NotLess8(Dist + Reach, Zero);
+        }
+        const uint32_t Mask = MoveMask8(Inside);
+        if (Mask == 0) { continue; }
+        NumVisible = AppendVisible(Mask, (uint32_t)BaseIdx, OutVisible, NumVisible);
+    }
+    return CullBoxesRange(View, Bounds, NumBlocks * CullBlockSize, Count, OutVisible, NumVisible);
+}
+
+const char* Culling::GetPathName()
+{
+    return LOFI_CULL_AVX2 ? "AVX2" : "SSE";
+}
+#else
+int Culling::CullSpheres(const Frustum& View, const BoundingSpheres& Bounds, int Count, uint32_t* OutVisible)
+{
+    return CullSpheresScalar(View, Bounds, Count, OutVisible);
+}
+
+int Culling::CullBoxes(const Frustum& View, const BoundingBoxes& Bounds, int Count, uint32_t* OutVisible)
+{
+    return CullBoxesScalar(View, Bounds, Count, OutVisible);
+}
+
+const char* Culling::GetPathName()
+{
+    return "scalar";
+}
+#endif
+}
@@ -0,0 +1,81 @@
+#ifndef LOFICULLING_H
+#define LOFICULLING_H
+
+#include "Common.h"
+#include "LofiGraphics.h"
+
+// 8 objects per iteration: one AVX register when built with /arch:AVX2 (-mavx2), two SSE registers otherwise
+#if defined(__AVX2__)
+#define LOFI_CULL_AVX2 1
+#else
+#define LOFI_CULL_AVX2 0
+#endif
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__)
+#define LOFI_CULL_SSE 1
+#else
+#define LOFI_CULL_SSE 0
+#endif
+
+namespace Lofi
+{
+enum FrustumPlane : int
+{
+    FrustumPlane_Left = 0,
+    FrustumPlane_Right,
+    FrustumPlane_Bottom,
+    FrustumPlane_Top,
+    FrustumPlane_Near,
+    FrustumPlane_Far,
+    FrustumPlane_Count,
+};
+
+// xyz: unit normal pointing into the frustum, w: distance; P is inside a plane when dot(xyz, P) + w >= 0
+struct Frustum
+{
+    v4f planes[FrustumPlane_Count];
+};
+
+// Structure-of-arrays bounds, element N of every array describes object N. No alignment requirements.
+struct BoundingSpheres
+{
+    const float* center_x;
+    const float* center_y;
+    const float* center_z;
+    const float* radius;
+};
+
+// Axis-aligned boxes as center + half extents
+struct BoundingBoxes
+{
+    const float* center_x;
+    const float* center_y;
+    const float* center_z;
+    const float* extent_x;
+    const float* extent_y;
+    const float* extent_z;
+};
+
+/*
+    Conservative frustum culling: an object is dropped only when it lies entirely on the outside
+        of one of the six planes, so large objects near a frustum corner can still pass.
+    Every Cull* writes the indices of the visible objects to OutVisible in increasing order and returns
+        how many there are. OutVisible needs room for Count indices.
+*/
+struct Culling
+{
+    // Planes of a clip-space (GL, z in [-1, 1]) view-projection matrix, in world space
+    static Frustum ExtractFrustum(const m4f& ViewProj);
+
+    static int CullSpheres(const Frustum& View, const BoundingSpheres& Bounds, int Count, uint32_t* OutVisible);
+    static int CullBoxes(const Frustum& View, const BoundingBoxes& Bounds, int Count, uint32_t* OutVisible);
+
+    // One object at a time, same results as the SIMD paths; the benchmark baseline
+    static int CullSpheresScalar(const Frustum& View, const BoundingSpheres& Bounds, int Count, uint32_t* OutVisible);
+    static int CullBoxesScalar(const Frustum& View, const BoundingBoxes& Bounds, int Count, uint32_t* OutVisible);
+
+    // "AVX2", "SSE" or "scalar", whichever CullSpheres / CullBoxes were built with
+    static const char* GetPathName();
+};
+}
+
+#endif // LOFICULLING_H
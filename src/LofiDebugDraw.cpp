@@ -0,0 +1,88 @@
+#include "LofiDebugDraw.h"
+
+#if LOFI_DEBUG_DRAW
+#include "LofiDynamicRing.h"
+#include "LofiMesh.h"
+#include "LofiRenderQueue.h"
+
+#include <cstring>
+
+namespace Lofi
+{
+constexpr int MaxDebugVerts = 64 * 1024;
+
+struct DebugDrawState_t
+{
+    vxcolor Verts[MaxDebugVerts];
+    int NumVerts = 0;
+    bool bOverflowLogged = false;
+
+    MeshHandle lines_mesh = InvalidMesh;
+} DebugDrawState;
+
+void DebugLine(v3f A, v3f B, v3f Color)
+{
+    if (DebugDrawState.NumVerts + 2 > MaxDebugVerts)
+    {
+        if (!DebugDrawState.bOverflowLogged) { LOGF("DebugDraw: vertex limit reached, dropping lines!\n"); }
+        DebugDrawState.bOverflowLogged = true;
+        return;
+    }
+    DebugDrawState.Verts[DebugDrawState.NumVerts++] = vxcolor{ A, Color };
+    DebugDrawState.Verts[DebugDrawState.NumVerts++] = vxcolor{ B, Color };
+}
+
+void DebugBox(v3f Min, v3f Max, v3f Color)
+{
+    const v3f Corners[] =
+    {
+        { Min.X, Min.Y, Min.Z }, { Max.X, Min.Y, Min.Z }, { Max.X, Max.Y, Min.Z }, { Min.X, Max.Y, Min.Z },
+        { Min.X, Min.Y, Max.Z }, { Max.X, Min.Y, Max.Z }, { Max.X, Max.Y, Max.Z }, { Min.X, Max.Y, Max.Z },
+    };
+    for (int EdgeIdx = 0; EdgeIdx < 4; EdgeIdx++)
+    {
+        DebugLine(Corners[EdgeIdx], Corners[(EdgeIdx + 1) % 4], Color); // Min.Z face
+        DebugLine(Corners[EdgeIdx + 4], Corners[(EdgeIdx + 1) % 4 + 4], Color); // Max.Z face
+        DebugLine(Corners[EdgeIdx], Corners[EdgeIdx + 4], Color); // Connecting edges
+    }
+}
+
+void DebugAxes(const m4f& Transform, float Size)
+{
+    const v3f Origin = Transform.Columns[3].XYZ;
+    const v3f AxisColors[] = { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } };
+    for (int AxisIdx = 0; AxisIdx < 3; AxisIdx++)
+    {
+        const v3f Axis = Transform.Columns[AxisIdx].XYZ;
+        DebugLine(Origin, Origin + Axis * Size, AxisColors[AxisIdx]);
+    }
+}
+
+void DebugDraw::Init()
+{
+    DebugDrawState.lines_mesh = MeshRegistry::CreateDynamic(VertexFormat::VxColor, GL_LINES);
+    RenderQueue::AddModelStream(DebugDrawState.lines_mesh);
+}
+
+void DebugDraw::Flush(GLuint VxColorProgram)
+{
+    const int NumVerts = DebugDrawState.NumVerts;
+    DebugDrawState.NumVerts = 0;
+    DebugDrawState.bOverflowLogged = false;
+    if (NumVerts == 0 || !VxColorProgram) { return; }
+
+    // Aligned to the vertex size so the ring offset is a whole first-vertex index
+    DynamicAlloc VertAlloc = DynamicRing::Alloc(sizeof(vxcolor) * NumVerts, sizeof(vxcolor));
+    if (!VertAlloc.IsValid()) { return; }
+    memcpy(VertAlloc.ptr, DebugDrawState.Verts, sizeof(vxcolor) * NumVerts);
+    MeshRegistry::SetDynamicRange(DebugDrawState.lines_mesh, (GLsizei)(VertAlloc.offset / sizeof(vxcolor)), NumVerts);
+
+    DrawPacket Packet;
+    Packet.camera = Camera_World;
+    Packet.program = VxColorProgram;
+    Packet.mesh = DebugDrawState.lines_mesh;
+    Packet.model = HMM_M4D(1.0f);
+    RenderQueue::Submit(Packet);
+}
+}
+#endif // LOFI_DEBUG_DRAW
@@ -0,0 +1,42 @@
+#ifndef LOFIDEBUGDRAW_H
+#define LOFIDEBUGDRAW_H
+
+#include "Common.h"
+#include "LofiGraphics.h"
+
+// Debug draw is compiled out of Release builds, every call below becomes an empty inline
+#if !defined(NDEBUG)
+#define LOFI_DEBUG_DRAW 1
+#else
+#define LOFI_DEBUG_DRAW 0
+#endif
+
+namespace Lofi
+{
+#if LOFI_DEBUG_DRAW
+// World-space lines, accumulated on the CPU and drawn in a single GL_LINES draw at the end of the frame
+void DebugLine(v3f A, v3f B, v3f Color);
+void DebugBox(v3f Min, v3f Max, v3f Color);
+// X/Y/Z as red/green/blue, Size long, at Transform's origin
+void DebugAxes(const m4f& Transform, float Size);
+
+struct DebugDraw
+{
+    static void Init();
+    // Streams this frame's lines through the DynamicRing and submits one packet to the RenderQueue
+    static void Flush(GLuint VxColorProgram);
+};
+#else
+inline void DebugLine(v3f, v3f, v3f) {}
+inline void DebugBox(v3f, v3f, v3f) {}
+inline void DebugAxes(const m4f&, float) {}
+
+struct DebugDraw
+{
+    static void Init() {}
+    static void Flush(GLuint) {}
+};
+#endif
+}
+
+#endif // LOFIDEBUGDRAW_H
@@ -0,0 +1,154 @@
+#include "LofiDynamicRing.h"
+#include "LofiAllocTracker.h"
+
+namespace Lofi
+{
+struct DynamicRingState_t
+{
+    GLuint Buffer = 0;
+    unsigned char* Mapped = nullptr; // Persistent mapping, or CPU staging copy
+    bool bPersistent = false;
+
+    GLsizeiptr BytesPerFrame = 0;
+    int FrameIdx = 0;
+    GLsizeiptr Head = 0; // Relative to the current frame's region
+    GLsizeiptr Flushed = 0;
+    GLsync Fences[DynamicRing_NumFrames] = {};
+
+    DynamicRingStats Stats;
+} DynamicRingState;
+
+bool DynamicRing::Init(GLsizeiptr BytesPerFrame)
+{
+    DynamicRingState.BytesPerFrame = BytesPerFrame;
+    const GLsizeiptr TotalSize = BytesPerFrame * DynamicRing_NumFrames;
+
+    DynamicRingState.bPersistent = GLAD_GL_ARB_buffer_storage != 0;
+    glGenBuffers(1, &DynamicRingState.Buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, DynamicRingState.Buffer);
+    if (DynamicRingState.bPersistent)
+    {
+        const GLbitfield Flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, TotalSize, nullptr, Flags);
+        DynamicRingState.Mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, TotalSize, Flags);
+    }
+    else
+    {
+        LOGF("DynamicRing: ARB_buffer_storage unavailable, falling back to staged uploads\n");
+        glBufferData(GL_COPY_WRITE_BUFFER, TotalSize, nullptr, GL_STREAM_DRAW);
+        DynamicRingState.Mapped = new unsigned char[TotalSize];
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if (!DynamicRingState.Mapped) { LOGF("DynamicRing: map FAILED!\n"); return false; }
+    return true;
+}
+
+void DynamicRing::Terminate()
+{
+    for (int FrameIdx = 0; FrameIdx < DynamicRing_NumFrames; FrameIdx++)
+    {
+        if (DynamicRingState.Fences[FrameIdx]) { glDeleteSync(DynamicRingState.Fences[FrameIdx]); }
+        DynamicRingState.Fences[FrameIdx] = nullptr;
+    }
+    if (DynamicRingState.bPersistent && DynamicRingState.Mapped)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, DynamicRingState.Buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    else if (DynamicRingState.Mapped)
+    {
+        delete[] DynamicRingState.Mapped;
+    }
+    DynamicRingState.Mapped = nullptr;
+    glDeleteBuffers(1, &DynamicRingState.Buffer);
+    DynamicRingState.Buffer = 0;
+}
+
+void DynamicRing::BeginFrame()
+{
+    DynamicRingState.FrameIdx = (DynamicRingState.FrameIdx + 1) % DynamicRing_NumFrames;
+    DynamicRingState.Head = 0;
+    DynamicRingState.Flushed = 0;
+
+    // Don't overwrite a region the GPU may still be reading from
+    GLsync& Fence = DynamicRingState.Fences[DynamicRingState.FrameIdx];
+    if (Fence)
+    {
+        GLenum WaitResult = glClientWaitSync(Fence, 0, 0);
+        if (WaitResult == GL_TIMEOUT_EXPIRED)
+        {
+            const double WaitStart = glfwGetTime();
+            const GLuint64 OneSecondNs = 1000000000;
+            do
+            {
+                WaitResult = glClientWaitSync(Fence, GL_SYNC_FLUSH_COMMANDS_BIT, OneSecondNs);
+            } while (WaitResult == GL_TIMEOUT_EXPIRED);
+            DynamicRingState.Stats.FenceWaits++;
+            DynamicRingState.Stats.FenceWaitMs += (glfwGetTime() - WaitStart) * 1000.0;
+        }
+        glDeleteSync(Fence);
+        Fence = nullptr;
+    }
+}
+
+DynamicAlloc DynamicRing::Alloc(GLsizeiptr Size, GLsizeiptr Alignment)
+{
+    DynamicAlloc Result;
+    // Absolute offsets must be aligned, regions start at multiples of BytesPerFrame
+    const GLsizeiptr RegionStart = DynamicRingState.BytesPerFrame * DynamicRingState.FrameIdx;
+    GLsizeiptr Offset = RegionStart + DynamicRingState.Head;
+    if (Alignment > 1) { Offset = ((Offset + Alignment - 1) / Alignment) * Alignment; }
+
+    if (Size <= 0 || Offset + Size > RegionStart + DynamicRingState.BytesPerFrame)
+    {
+        LOGF("DynamicRing: frame region full (%lld bytes requested)!\n", (long long)Size);
+        return Result;
+    }
+
+    DynamicRingState.Head = Offset + Size - RegionStart;
+    Result.ptr = DynamicRingState.Mapped + Offset;
+    Result.buffer = DynamicRingState.Buffer;
+    Result.offset = Offset;
+    Result.size = Size;
+    return Result;
+}
+
+void DynamicRing::Flush()
+{
+    if (DynamicRingState.bPersistent) { return; } // Coherent mapping, nothing to do
+    if (DynamicRingState.Flushed == DynamicRingState.Head) { return; }
+
+    const GLsizeiptr RegionStart = DynamicRingState.BytesPerFrame * DynamicRingState.FrameIdx;
+    const GLsizeiptr Offset = RegionStart + DynamicRingState.Flushed;
+    {
+        ALLOC_EXEMPT_SCOPE("DynamicRing GL");
+        glBindBuffer(GL_COPY_WRITE_BUFFER, DynamicRingState.Buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, Offset, DynamicRingState.Head - DynamicRingState.Flushed, DynamicRingState.Mapped + Offset);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    DynamicRingState.Flushed = DynamicRingState.Head;
+}
+
+void DynamicRing::EndFrame()
+{
+    Flush();
+    {
+        // llvmpipe allocates every sync object
+        ALLOC_EXEMPT_SCOPE("DynamicRing GL");
+        DynamicRingState.Fences[DynamicRingState.FrameIdx] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    DynamicRingState.Stats.BytesUsed = DynamicRingState.Head;
+}
+
+GLuint DynamicRing::GetBuffer()
+{
+    return DynamicRingState.Buffer;
+}
+
+const DynamicRingStats& DynamicRing::GetStats()
+{
+    return DynamicRingState.Stats;
+}
+}
@@ -0,0 +1,52 @@
+#ifndef LOFIDYNAMICRING_H
+#define LOFIDYNAMICRING_H
+
+#include "Common.h"
+
+namespace Lofi
+{
+struct DynamicAlloc
+{
+    void* ptr = nullptr; // CPU write pointer, valid until the end of the frame
+    GLuint buffer = 0;
+    GLsizeiptr offset = 0; // Byte offset into buffer for binds/draws
+    GLsizeiptr size = 0;
+
+    bool IsValid() const { return nullptr != ptr; }
+};
+
+struct DynamicRingStats
+{
+    GLsizeiptr BytesUsed = 0; // Last frame
+    int FenceWaits = 0; // Frames where the CPU caught up with the GPU
+    double FenceWaitMs = 0.0;
+};
+
+/*
+    One buffer split into DynamicRing_NumFrames regions, CPU writes region N while the GPU
+        reads regions N-1 and N-2. Each region is fenced at EndFrame and waited on before reuse.
+
+    With ARB_buffer_storage the whole buffer stays persistently + coherently mapped, so Alloc hands
+        out pointers straight into GPU-visible memory. Without it Alloc writes to a CPU staging copy
+        and Flush uploads the frame's bytes with one glBufferSubData.
+*/
+constexpr int DynamicRing_NumFrames = 3;
+
+struct DynamicRing
+{
+    static bool Init(GLsizeiptr BytesPerFrame);
+    static void Terminate();
+
+    static void BeginFrame();
+    // Returns an invalid alloc if the frame's region is full
+    static DynamicAlloc Alloc(GLsizeiptr Size, GLsizeiptr Alignment = 16);
+    // Makes everything allocated so far this frame visible to the GPU, call before drawing from it
+    static void Flush();
+    static void EndFrame();
+
+    static GLuint GetBuffer();
+    static const DynamicRingStats& GetStats();
+};
+}
+
+#endif // LOFIDYNAMICRING_H
@@ -1,6 +1,21 @@
 #include "LofiEngine.h"
 #include "Common.h"
+#include "LofiAllocTracker.h"
+#include "LofiCulling.h"
+#include "LofiDynamicRing.h"
+#include "LofiEntities.h"
+#include "LofiFrameArena.h"
+#include "LofiGLState.h"
+#include "LofiGPUProfiler.h"
 #include "LofiGraphics.h"
+#include "LofiJobs.h"
+#include "LofiProfiler.h"
+#include "LofiRenderQueue.h"
+#include "LofiSimulation.h"
+#include "LofiSpriteBatch.h"
+
+#include <cstdlib>
+#include <cstring>
 
 namespace Lofi
 {
@@ -13,9 +28,36 @@ struct AppState
     const int AppWidth = ResXs[ResIdx_1280x960];
     const int AppHeight = ResYs[ResIdx_1280x960];
     GLFWwindow* AppWindow = nullptr;
+
+    // --headless: no display/GPU required, render offscreen for N frames and report timings
+    bool bHeadless = false;
+    // --uncapped: vsync off, frames as fast as they render, frame rate logged every second
+    bool bUncapped = false;
+    // --bench-instances: scale the instanced cubie count from 1 to 100k, N frames per step
+    bool bBenchInstances = false;
+    // --bench-sprites: draw BenchSpriteCount HUD sprites per frame for N frames
+    bool bBenchSprites = false;
+    // --bench-culling: frustum cull BenchCullCount objects N times, scalar vs SIMD
+    bool bBenchCulling = false;
+    // --bench-profiler: cost of an empty PROFILE_SCOPE
+    bool bBenchProfiler = false;
+    // --bench-jobs: job system scaling from 1 to every hardware thread
+    bool bBenchJobs = false;
+    // --bench-ecs: spin BenchEntityCount entities' transforms, serial vs job system vs a plain array of structs
+    bool bBenchECS = false;
+    // --trace FILE: write a Chrome trace of the CPU zones on exit
+    const char* TraceFilename = nullptr;
+    // --zero-alloc-test N: fail as soon as a frame after the first N allocates (driver/platform calls exempt), -1 when off
+    int ZeroAllocWarmupFrames = -1;
+    AllocCounts ZeroAllocExemptStart; // Exempt allocations when the warm-up ended
+    int BenchFrames = 0;
+    int64_t NumFramesRun = 0; // Every frame of every loop, what --zero-alloc-test counts
 };
 AppState GlobalState;
 
+// F2 dumps the CPU zones here
+const char* DefaultTraceFilename = "lofi_trace.json";
+
 void HandleError(int ErrorNo, const char* ErrorDesc)
 {
     LOGF("ERROR: %d, %s\n", ErrorNo, ErrorDesc);
@@ -23,13 +65,17 @@ void HandleError(int ErrorNo, const char* ErrorDesc)
 
 void HandleKeyInput(GLFWwindow* InWindow, int InKey, int ScanCode, int Action, int Modifiers)
 {
-    (void)ScanCode; (void)Action; (void)Modifiers;
+    (void)ScanCode; (void)Modifiers;
     switch (InKey)
     {
         case GLFW_KEY_ESCAPE:
         {
             glfwSetWindowShouldClose(InWindow, GLFW_TRUE);
         } break;
+        case GLFW_KEY_F2:
+        {
+            if (Action == GLFW_PRESS) { Profiler::DumpChromeTrace(DefaultTraceFilename); }
+        } break;
         default:
         {} break;
     }
@@ -38,21 +84,117 @@ void HandleKeyInput(GLFWwindow* InWindow, int InKey, int ScanCode, int Action, i
 constexpr int SuccessRetval = 0;
 constexpr int ErrorRetval = -1;
 
+constexpr int DefaultHeadlessFrames = 1000;
+constexpr int DefaultBenchStepFrames = 100;
+constexpr int BenchSpriteCount = 50000;
+constexpr int BenchCullCount = 1000000;
+constexpr int BenchProfileZones = 10000000;
+constexpr int BenchJobBatchSize = 16384;
+constexpr int BenchEmptyJobCount = 100000;
+constexpr int BenchEntityCount = 1000000;
+
 bool HandleArgs(int argc, const char* argv[])
 {
-    (void)argc; (void)argv;
+    for (int ArgIdx = 1; ArgIdx < argc; ArgIdx++)
+    {
+        const char* Arg = argv[ArgIdx];
+        if (0 == strcmp(Arg, "--headless"))
+        {
+            GlobalState.bHeadless = true;
+        }
+        else if (0 == strcmp(Arg, "--uncapped"))
+        {
+            GlobalState.bUncapped = true;
+        }
+        else if (0 == strcmp(Arg, "--bench-instances"))
+        {
+            GlobalState.bBenchInstances = true;
+        }
+        else if (0 == strcmp(Arg, "--bench-sprites"))
+        {
+            GlobalState.bBenchSprites = true;
+        }
+        else if (0 == strcmp(Arg, "--bench-culling"))
+        {
+            GlobalState.bBenchCulling = true;
+        }
+        else if (0 == strcmp(Arg, "--bench-profiler"))
+        {
+            GlobalState.bBenchProfiler = true;
+        }
+        else if (0 == strcmp(Arg, "--bench-jobs"))
+        {
+            GlobalState.bBenchJobs = true;
+        }
+        else if (0 == strcmp(Arg, "--bench-ecs"))
+        {
+            GlobalState.bBenchECS = true;
+        }
+        else if (0 == strcmp(Arg, "--trace") && ArgIdx + 1 < argc)
+        {
+            GlobalState.TraceFilename = argv[++ArgIdx];
+        }
+        else if (0 == strcmp(Arg, "--zero-alloc-test") && ArgIdx + 1 < argc)
+        {
+            const int WarmupFrames = atoi(argv[++ArgIdx]);
+            GlobalState.ZeroAllocWarmupFrames = WarmupFrames > 0 ? WarmupFrames : 0;
+        }
+        else if (0 == strcmp(Arg, "--frames") && ArgIdx + 1 < argc)
+        {
+            GlobalState.BenchFrames = atoi(argv[++ArgIdx]);
+        }
+        else
+        {
+            LOGF("Unknown argument: %s\n", Arg);
+            LOGF("Usage: LofiEngine [--headless] [--uncapped] [--bench-instances] [--bench-sprites] [--bench-culling] [--bench-profiler]\n");
+            LOGF("                  [--bench-jobs] [--bench-ecs] [--trace FILE] [--zero-alloc-test N] [--frames N]\n");
+            return false;
+        }
+    }
+
+    if (GlobalState.BenchFrames <= 0)
+    {
+        const bool bBenchmark = GlobalState.bBenchInstances || GlobalState.bBenchSprites || GlobalState.bBenchCulling ||
+            GlobalState.bBenchJobs || GlobalState.bBenchECS;
+        GlobalState.BenchFrames = bBenchmark ? DefaultBenchStepFrames : DefaultHeadlessFrames;
+    }
     return true;
 }
 
+GLFWwindow* CreateHeadlessWindow()
+{
+    // The null platform needs no display server; GLFW then creates a surfaceless
+    //     EGL context (EGL_MESA_platform_surfaceless) or falls back to OSMesa.
+    //     Either way nothing is presented, Graphics renders into its own FBO.
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+    GLFWwindow* Result = glfwCreateWindow(GlobalState.AppWidth, GlobalState.AppHeight, "LofiEngine", nullptr, nullptr);
+    if (!Result)
+    {
+        LOGF("Headless: EGL context unavailable, trying OSMesa\n");
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+        Result = glfwCreateWindow(GlobalState.AppWidth, GlobalState.AppHeight, "LofiEngine", nullptr, nullptr);
+    }
+    return Result;
+}
+
 bool EngineInit()
 {
+    PROFILE_SCOPE("EngineInit");
     LOGF("LofiEngine -- Init\n");
 
-    if (!glfwInit()) { return false; }
-
     glfwSetErrorCallback(HandleError);
 
-    GLFWwindow* NewWindow = glfwCreateWindow(GlobalState.AppWidth, GlobalState.AppHeight, "LofiEngine", nullptr, nullptr);
+    if (GlobalState.bHeadless)
+    {
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    }
+
+    if (!glfwInit()) { return false; }
+
+    GLFWwindow* NewWindow = GlobalState.bHeadless ?
+        CreateHeadlessWindow() :
+        glfwCreateWindow(GlobalState.AppWidth, GlobalState.AppHeight, "LofiEngine", nullptr, nullptr);
     if (!NewWindow) { LOGF("glfwCreateWindow FAILED!\n"); return false; }
 
     GlobalState.AppWindow = NewWindow;
@@ -61,36 +203,547 @@ bool EngineInit()
 
     glfwMakeContextCurrent(GlobalState.AppWindow);
     gladLoadGL(glfwGetProcAddress);
-    glfwSwapInterval(1);
+    GLState::Init();
+
+    if (GlobalState.bHeadless)
+    {
+        LOGF("Headless: %s / %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+        if (!Graphics::InitOffscreenTarget(GlobalState.AppWidth, GlobalState.AppHeight)) { return false; }
+    }
+    else
+    {
+        // Benchmarks measure raw frame time, don't let vsync cap them
+        const bool bBenchmark = GlobalState.bBenchInstances || GlobalState.bBenchSprites || GlobalState.bBenchCulling;
+        glfwSwapInterval(bBenchmark || GlobalState.bUncapped ? 0 : 1);
+    }
 
+    Jobs::Init();
+    FrameArena::Init();
+    Entities::Init();
     Graphics::Init();
+    Simulation::Init(glfwGetTime());
+
+    return true;
+}
+
+void BeginEngineFrame()
+{
+    FrameArena::BeginFrame();
+    if (GlobalState.NumFramesRun == GlobalState.ZeroAllocWarmupFrames)
+    {
+        AllocTracker::ResetCallSites();
+        GlobalState.ZeroAllocExemptStart = AllocTracker::GetExemptTotal();
+    }
+    AllocTracker::BeginFrame();
+}
+
+// False when --zero-alloc-test is on, the warm-up is over and the frame allocated outside exempt scopes
+bool EndEngineFrame()
+{
+    const AllocCounts FrameAllocs = AllocTracker::EndFrame();
+    const int64_t FrameIdx = GlobalState.NumFramesRun++;
+    if (GlobalState.ZeroAllocWarmupFrames < 0 || FrameIdx < GlobalState.ZeroAllocWarmupFrames || FrameAllocs.NumAllocs == 0)
+    {
+        return true;
+    }
+    LOGF("Zero-alloc test FAILED: frame %lld made %llu heap allocations (%llu bytes) after %d warm-up frames\n",
+        (long long)FrameIdx, (unsigned long long)FrameAllocs.NumAllocs, (unsigned long long)FrameAllocs.Bytes,
+        GlobalState.ZeroAllocWarmupFrames);
+    AllocTracker::LogFrame();
+    return false;
+}
+
+struct FrameStats
+{
+    bool bAllocFailed = false; // --zero-alloc-test stopped the run
+    int NumFrames = 0;
+    double TotalCPUMs = 0.0;
+    double TotalGPUMs = 0.0;
+    double MaxCPUMs = 0.0;
+    double MaxGPUMs = 0.0;
+
+    double AvgCPUMs() const { return NumFrames > 0 ? TotalCPUMs / NumFrames : 0.0; }
+    double AvgGPUMs() const { return NumFrames > 0 ? TotalGPUMs / NumFrames : 0.0; }
+};
+
+FrameStats RunTimedFrames(int NumFrames, bool bLogFrames)
+{
+    FrameStats Result;
+    GLuint TimerQuery = 0;
+    glGenQueries(1, &TimerQuery);
+
+    for (int FrameIdx = 0; FrameIdx < NumFrames; FrameIdx++)
+    {
+        PROFILE_SCOPE("Frame");
+        BeginEngineFrame();
+        const double CPUStart = glfwGetTime();
+        {
+            // Drivers may allocate query storage on begin and end (llvmpipe does every frame)
+            ALLOC_EXEMPT_SCOPE("Frame timer GL");
+            glBeginQuery(GL_TIME_ELAPSED, TimerQuery);
+        }
+
+        Graphics::Draw(GlobalState.AppWindow, Simulation::GetRenderState(CPUStart));
+
+        {
+            ALLOC_EXEMPT_SCOPE("Frame timer GL");
+            glEndQuery(GL_TIME_ELAPSED);
+        }
+        const double CPUMs = (glfwGetTime() - CPUStart) * 1000.0;
+
+        // DEV_NOTE: Blocking readback, fine for batch benchmarking but not for interactive use
+        GLuint64 GPUNs = 0;
+        glGetQueryObjectui64v(TimerQuery, GL_QUERY_RESULT, &GPUNs);
+        const double GPUMs = (double)GPUNs / 1000000.0;
+
+        if (bLogFrames)
+        {
+            const RenderQueueStats& QueueStats = RenderQueue::GetStats();
+            const GLStateStats& BindStats = GLState::GetStats();
+            LOGF("Frame %d: CPU %.3f ms, GPU %.3f ms, %d packets, %d state changes (%d saved), binds %d issued / %d skipped\n",
+                FrameIdx, CPUMs, GPUMs, QueueStats.NumPackets, QueueStats.StateChanges, QueueStats.SavedStateChanges,
+                BindStats.Issued, BindStats.Skipped);
+        }
+        Result.NumFrames++;
+        Result.TotalCPUMs += CPUMs;
+        Result.TotalGPUMs += GPUMs;
+        if (CPUMs > Result.MaxCPUMs) { Result.MaxCPUMs = CPUMs; }
+        if (GPUMs > Result.MaxGPUMs) { Result.MaxGPUMs = GPUMs; }
+
+        if (!GlobalState.bHeadless)
+        {
+            ALLOC_EXEMPT_SCOPE("Platform");
+            glfwPollEvents();
+        }
+        if (!EndEngineFrame())
+        {
+            Result.bAllocFailed = true;
+            break;
+        }
+    }
+
+    glDeleteQueries(1, &TimerQuery);
+    return Result;
+}
+
+bool EngineHeadlessLoop()
+{
+    FrameStats Stats = RunTimedFrames(GlobalState.BenchFrames, true);
+    if (Stats.NumFrames > 0)
+    {
+        LOGF("Headless: %d frames\n", Stats.NumFrames);
+        LOGF("    CPU avg %.3f ms, max %.3f ms\n", Stats.AvgCPUMs(), Stats.MaxCPUMs);
+        LOGF("    GPU avg %.3f ms, max %.3f ms\n", Stats.AvgGPUMs(), Stats.MaxGPUMs);
+
+        const DynamicRingStats& RingStats = DynamicRing::GetStats();
+        LOGF("    Dynamic ring: %lld bytes last frame, %d fence waits (%.3f ms)\n",
+            (long long)RingStats.BytesUsed, RingStats.FenceWaits, RingStats.FenceWaitMs);
+        FrameArena::LogStats();
+        GPUProfiler::LogStats();
+    }
+
+    return !Stats.bAllocFailed;
+}
+
+bool EngineInstanceBenchmark()
+{
+    const int InstanceCounts[] = { 1, 10, 100, 1000, 10000, 100000 };
+    const int WarmupFrames = 10;
+
+    LOGF("Instanced cubies: %d frames per step\n", GlobalState.BenchFrames);
+    LOGF("%10s %10s %12s %12s %12s %12s %12s\n", "Instances", "Visible", "CPU avg ms", "GPU avg ms", "GPU max ms",
+        "World avg ms", "World p99 ms");
+    for (int StepIdx = 0; StepIdx < (int)ARRAY_SIZE(InstanceCounts); StepIdx++)
+    {
+        Graphics::SetCubeInstanceCount(InstanceCounts[StepIdx]);
+        RunTimedFrames(WarmupFrames, false);
+        GPUProfiler::ResetStats();
+
+        FrameStats Stats = RunTimedFrames(GlobalState.BenchFrames, false);
+        if (Stats.bAllocFailed) { return false; }
+        const GPUPassStats WorldStats = GPUProfiler::GetPassStats(GPUPass_World);
+        LOGF("%10d %10d %12.3f %12.3f %12.3f %12.3f %12.3f\n", InstanceCounts[StepIdx], Graphics::GetVisibleCubeInstanceCount(),
+            Stats.AvgCPUMs(), Stats.AvgGPUMs(), Stats.MaxGPUMs, WorldStats.AvgMs, WorldStats.P99Ms);
+    }
+    Graphics::SetCubeInstanceCount(0);
+
+    return true;
+}
+
+bool EngineSpriteBenchmark()
+{
+    const int WarmupFrames = 10;
+
+    Graphics::SetSpriteCount(BenchSpriteCount);
+    RunTimedFrames(WarmupFrames, false);
+    GPUProfiler::ResetStats();
+
+    FrameStats Stats = RunTimedFrames(GlobalState.BenchFrames, false);
+    if (Stats.bAllocFailed) { return false; }
+    const SpriteBatchStats& BatchStats = SpriteBatch::GetStats();
+    LOGF("Sprites: %d per frame in %d batches, %d frames\n", BatchStats.NumSprites, BatchStats.NumBatches, Stats.NumFrames);
+    LOGF("    CPU avg %.3f ms, max %.3f ms\n", Stats.AvgCPUMs(), Stats.MaxCPUMs);
+    LOGF("    GPU avg %.3f ms, max %.3f ms\n", Stats.AvgGPUMs(), Stats.MaxGPUMs);
+    GPUProfiler::LogStats();
+    Graphics::SetSpriteCount(0);
 
     return true;
 }
 
+struct CullBenchScene
+{
+    Frustum View;
+    BoundingSpheres Spheres;
+    BoundingBoxes Boxes;
+    int Count;
+    float* Bounds; // Backs both Spheres and Boxes
+};
+
+CullBenchScene CreateCullBenchScene(int Count)
+{
+    // Objects scattered through a 200 unit cube around a camera at the origin looking down -Z,
+    //     roughly a tenth of them end up inside the 60 degree frustum
+    const float fFieldHalfSize = 100.0f;
+    float* Bounds = new float[Count * 6];
+    uint32_t Seed = 0x12345678u;
+    for (int ValueIdx = 0; ValueIdx < Count * 6; ValueIdx++)
+    {
+        Seed = Seed * 1664525u + 1013904223u; // LCG, the same scene every run
+        const float fUnit = (float)(Seed >> 8) / (float)(1 << 24);
+        const bool bSize = ValueIdx >= Count * 3;
+        Bounds[ValueIdx] = bSize ? 0.25f + fUnit * 1.75f : (fUnit * 2.0f - 1.0f) * fFieldHalfSize;
+    }
+    const float fFOVRadians = 1.0471976f; // 60 degrees
+    const m4f ViewProj = HMM_Perspective_RH_NO(fFOVRadians, 4.0f / 3.0f, 0.1f, fFieldHalfSize) *
+        HMM_LookAt_RH(v3f{ 0.0f, 0.0f, 0.0f }, v3f{ 0.0f, 0.0f, -1.0f }, v3f{ 0.0f, 1.0f, 0.0f });
+    CullBenchScene Result;
+    Result.View = Culling::ExtractFrustum(ViewProj);
+    // Spheres and boxes share centers, the boxes' extents start at the sphere radii
+    Result.Spheres = BoundingSpheres{ Bounds, Bounds + Count, Bounds + Count * 2, Bounds + Count * 3 };
+    Result.Boxes = BoundingBoxes{ Bounds, Bounds + Count, Bounds + Count * 2, Bounds + Count * 3, Bounds + Count * 4, Bounds + Count * 5 };
+    Result.Count = Count;
+    Result.Bounds = Bounds;
+    return Result;
+}
+
+// Best of NumRuns, in ms
+double TimeCulling(const CullBenchScene& Scene, bool bSpheres, bool bSIMD, int NumRuns, uint32_t* OutVisible, int& OutNumVisible)
+{
+    double BestMs = 0.0;
+    for (int RunIdx = 0; RunIdx < NumRuns; RunIdx++)
+    {
+        const double StartTime = glfwGetTime();
+        if (bSpheres)
+        {
+            OutNumVisible = bSIMD ? Culling::CullSpheres(Scene.View, Scene.Spheres, Scene.Count, OutVisible) :
+                Culling::CullSpheresScalar(Scene.View, Scene.Spheres, Scene.Count, OutVisible);
+        }
+        else
+        {
+            OutNumVisible = bSIMD ? Culling::CullBoxes(Scene.View, Scene.Boxes, Scene.Count, OutVisible) :
+                Culling::CullBoxesScalar(Scene.View, Scene.Boxes, Scene.Count, OutVisible);
+        }
+        const double RunMs = (glfwGetTime() - StartTime) * 1000.0;
+        if (RunIdx == 0 || RunMs < BestMs) { BestMs = RunMs; }
+    }
+    return BestMs;
+}
+
+bool EngineCullingBenchmark()
+{
+    const int Count = BenchCullCount;
+    CullBenchScene Scene = CreateCullBenchScene(Count);
+
+    uint32_t* ScalarVisible = new uint32_t[Count];
+    uint32_t* SIMDVisible = new uint32_t[Count];
+    const int NumRuns = GlobalState.BenchFrames;
+    LOGF("Frustum culling: %d objects, best of %d runs, %s path\n", Count, NumRuns, Culling::GetPathName());
+    LOGF("%8s %10s %12s %12s %10s %8s\n", "Bounds", "Visible", "Scalar ms", "SIMD ms", "Speedup", "Match");
+
+    for (int BoundsIdx = 0; BoundsIdx < 2; BoundsIdx++)
+    {
+        const bool bSpheres = BoundsIdx == 0;
+        int NumScalar = 0;
+        int NumSIMD = 0;
+        const double ScalarMs = TimeCulling(Scene, bSpheres, false, NumRuns, ScalarVisible, NumScalar);
+        const double SIMDMs = TimeCulling(Scene, bSpheres, true, NumRuns, SIMDVisible, NumSIMD);
+        const bool bMatch = NumScalar == NumSIMD && 0 == memcmp(ScalarVisible, SIMDVisible, sizeof(uint32_t) * NumScalar);
+        LOGF("%8s %10d %12.3f %12.3f %9.2fx %8s\n", bSpheres ? "Spheres" : "AABBs", NumSIMD, ScalarMs, SIMDMs,
+            SIMDMs > 0.0 ? ScalarMs / SIMDMs : 0.0, bMatch ? "yes" : "NO");
+    }
+
+    delete[] SIMDVisible;
+    delete[] ScalarVisible;
+    delete[] Scene.Bounds;
+    return true;
+}
+
+struct JobBenchCull
+{
+    const CullBenchScene* Scene;
+    uint32_t* Visible; // Each batch writes its indices, relative to its first object, from its first object on
+    int* BatchVisible; // Visible count per batch
+    int BatchSize;
+};
+
+// ParallelFor items are whole batches, so every batch knows where its output goes
+void CullBenchBatches(int Begin, int End, void* Context)
+{
+    const JobBenchCull& Bench = *(const JobBenchCull*)Context;
+    const BoundingSpheres& All = Bench.Scene->Spheres;
+    for (int BatchIdx = Begin; BatchIdx < End; BatchIdx++)
+    {
+        const int First = BatchIdx * Bench.BatchSize;
+        const int Count = HMM_MIN(Bench.BatchSize, Bench.Scene->Count - First);
+        const BoundingSpheres Batch = { All.center_x + First, All.center_y + First, All.center_z + First, All.radius + First };
+        Bench.BatchVisible[BatchIdx] = Culling::CullSpheres(Bench.Scene->View, Batch, Count, Bench.Visible + First);
+    }
+}
+
+void EmptyBenchBatch(int Begin, int End, void* Context)
+{
+    (void)Begin; (void)End; (void)Context;
+}
+
+bool EngineJobBenchmark()
+{
+    const int Count = BenchCullCount;
+    const int BatchSize = BenchJobBatchSize;
+    const int NumBatches = (Count + BatchSize - 1) / BatchSize;
+    CullBenchScene Scene = CreateCullBenchScene(Count);
+    uint32_t* Visible = new uint32_t[Count];
+    int* BatchVisible = new int[NumBatches];
+    const JobBenchCull Bench = { &Scene, Visible, BatchVisible, BatchSize };
+    const int ExpectedVisible = Culling::CullSpheres(Scene.View, Scene.Spheres, Count, Visible);
+
+    const int MaxThreads = Jobs::GetNumThreads();
+    const int NumRuns = GlobalState.BenchFrames;
+    LOGF("Job system: %d hardware threads, best of %d runs\n", MaxThreads, NumRuns);
+    LOGF("    Cull: %d spheres in batches of %d; Empty: %d single-item ParallelFor jobs\n", Count, BatchSize, BenchEmptyJobCount);
+    LOGF("%8s %12s %10s %8s %14s\n", "Threads", "Cull ms", "Speedup", "Match", "Empty Mjobs/s");
+
+    double SingleThreadMs = 0.0;
+    int NumThreads = 1;
+    for (;;)
+    {
+        Jobs::Terminate();
+        Jobs::Init(NumThreads);
+
+        double CullMs = 0.0;
+        double EmptyMs = 0.0;
+        for (int RunIdx = 0; RunIdx < NumRuns; RunIdx++)
+        {
+            const double CullStart = glfwGetTime();
+            Jobs::ParallelFor(NumBatches, 1, CullBenchBatches, (void*)&Bench);
+            const double RunCullMs = (glfwGetTime() - CullStart) * 1000.0;
+            if (RunIdx == 0 || RunCullMs < CullMs) { CullMs = RunCullMs; }
+
+            const double EmptyStart = glfwGetTime();
+            Jobs::ParallelFor(BenchEmptyJobCount, 1, EmptyBenchBatch, nullptr);
+            const double RunEmptyMs = (glfwGetTime() - EmptyStart) * 1000.0;
+            if (RunIdx == 0 || RunEmptyMs < EmptyMs) { EmptyMs = RunEmptyMs; }
+        }
+        int NumVisible = 0;
+        for (int BatchIdx = 0; BatchIdx < NumBatches; BatchIdx++) { NumVisible += BatchVisible[BatchIdx]; }
+        if (NumThreads == 1) { SingleThreadMs = CullMs; }
+
+        // Splitting down to single items makes about twice as many jobs as items
+        const double EmptyJobsPerSec = EmptyMs > 0.0 ? (BenchEmptyJobCount * 2.0 - 1.0) / (EmptyMs / 1000.0) : 0.0;
+        LOGF("%8d %12.3f %9.2fx %8s %14.2f\n", NumThreads, CullMs, CullMs > 0.0 ? SingleThreadMs / CullMs : 0.0,
+            NumVisible == ExpectedVisible ? "yes" : "NO", EmptyJobsPerSec / 1000000.0);
+
+        if (NumThreads == MaxThreads) { break; }
+        NumThreads = HMM_MIN(NumThreads * 2, MaxThreads);
+    }
+
+    delete[] BatchVisible;
+    delete[] Visible;
+    delete[] Scene.Bounds;
+    return true;
+}
+
+// The same three components side by side in one struct per entity, what the ECS is measured against
+struct BenchEntityAoS
+{
+    transform_component transform;
+    spin_component spin;
+    render_component render;
+};
+
+void SpinAoS(BenchEntityAoS* Entries, int Count, float DeltaTime)
+{
+    const float TwoPi = 2.0f * HMM_PI32;
+    for (int EntryIdx = 0; EntryIdx < Count; EntryIdx++)
+    {
+        float Yaw = Entries[EntryIdx].transform.yaw + Entries[EntryIdx].spin.yaw_speed * DeltaTime;
+        if (Yaw >= TwoPi) { Yaw -= TwoPi; }
+        else if (Yaw < 0.0f) { Yaw += TwoPi; }
+        Entries[EntryIdx].transform.yaw = Yaw;
+    }
+}
+
+void SumYaw(const EntityChunk& Chunk, void* Context)
+{
+    double& Sum = *(double*)Context;
+    const transform_component* Transforms = GetChunkComponents<transform_component>(Chunk, Component_Transform);
+    for (int Row = 0; Row < Chunk.count; Row++) { Sum += Transforms[Row].yaw; }
+}
+
+bool EngineECSBenchmark()
+{
+    const int Count = BenchEntityCount;
+    const int NumRuns = GlobalState.BenchFrames;
+    const float DeltaTime = (float)SimTimestep;
+    const ComponentMask Mask = Component_Transform | Component_Spin | Component_Render;
+
+    Entity* Handles = new Entity[Count];
+    BenchEntityAoS* AoS = new BenchEntityAoS[Count];
+    const double CreateStart = glfwGetTime();
+    for (int EntityIdx = 0; EntityIdx < Count; EntityIdx++)
+    {
+        Handles[EntityIdx] = Entities::Create(Mask);
+        transform_component* Transform = (transform_component*)Entities::Get(Handles[EntityIdx], Component_Transform);
+        spin_component* Spin = (spin_component*)Entities::Get(Handles[EntityIdx], Component_Spin);
+        if (!Transform || !Spin)
+        {
+            LOGF("ECS benchmark: out of memory after %d entities\n", EntityIdx);
+            delete[] AoS;
+            delete[] Handles;
+            return false;
+        }
+        Transform->position = v3f{ (float)(EntityIdx % 1000), 0.0f, (float)(EntityIdx / 1000) };
+        Transform->scale = 1.0f;
+        Spin->yaw_speed = 0.5f + (EntityIdx % 7) * 0.25f;
+        AoS[EntityIdx] = {};
+        AoS[EntityIdx].transform = *Transform;
+        AoS[EntityIdx].spin = *Spin;
+    }
+    const double CreateMs = (glfwGetTime() - CreateStart) * 1000.0;
+
+    const EntityStats Stats = Entities::GetStats();
+    LOGF("ECS: %d entities (Transform + Spin + Render) in %d chunks of %d bytes, created in %.1f ms; best of %d runs on %d threads\n",
+        Stats.NumEntities, Stats.NumChunks, EntityChunkBytes, CreateMs, NumRuns, Jobs::GetNumThreads());
+    LOGF("%12s %12s %14s\n", "Spin", "ms", "M entities/s");
+
+    double BestMs[3] = {};
+    const char* const Names[3] = { "ECS serial", "ECS jobs", "AoS array" };
+    for (int RunIdx = 0; RunIdx < NumRuns; RunIdx++)
+    {
+        for (int ModeIdx = 0; ModeIdx < 3; ModeIdx++)
+        {
+            const double Start = glfwGetTime();
+            if (ModeIdx == 2) { SpinAoS(AoS, Count, DeltaTime); }
+            else { Entities::UpdateSpin(DeltaTime, ModeIdx == 1); }
+            const double RunMs = (glfwGetTime() - Start) * 1000.0;
+            if (RunIdx == 0 || RunMs < BestMs[ModeIdx]) { BestMs[ModeIdx] = RunMs; }
+        }
+    }
+    for (int ModeIdx = 0; ModeIdx < 3; ModeIdx++)
+    {
+        LOGF("%12s %12.3f %14.1f\n", Names[ModeIdx], BestMs[ModeIdx], BestMs[ModeIdx] > 0.0 ? Count / (BestMs[ModeIdx] * 1000.0) : 0.0);
+    }
+
+    // Both ECS modes ran NumRuns * 2 steps on every entity, the array NumRuns; the array gets the rest to compare
+    double EntitySum = 0.0;
+    Entities::ForEachChunk(Component_Transform, SumYaw, &EntitySum);
+    for (int RunIdx = 0; RunIdx < NumRuns; RunIdx++) { SpinAoS(AoS, Count, DeltaTime); }
+    double AoSSum = 0.0;
+    for (int EntryIdx = 0; EntryIdx < Count; EntryIdx++) { AoSSum += AoS[EntryIdx].transform.yaw; }
+    LOGF("    Transforms match: %s\n", HMM_ABS(EntitySum - AoSSum) <= 1e-6 * Count ? "yes" : "NO");
+
+    const double DestroyStart = glfwGetTime();
+    for (int EntityIdx = 0; EntityIdx < Count; EntityIdx++) { Entities::Destroy(Handles[EntityIdx]); }
+    LOGF("    Destroyed in %.1f ms\n", (glfwGetTime() - DestroyStart) * 1000.0);
+
+    delete[] AoS;
+    delete[] Handles;
+    return true;
+}
+
+bool EngineProfilerBenchmark()
+{
+    const double OverheadNs = Profiler::MeasureOverheadNs(BenchProfileZones);
+    LOGF("Profiler: %.1f ns per PROFILE_SCOPE (begin + end) over %d zones%s\n", OverheadNs, BenchProfileZones,
+        LOFI_PROFILE ? "" : ", compiled out");
+    return true;
+}
+
 bool EngineMainLoop()
 {
+    PROFILE_SCOPE("EngineMainLoop");
+    if (GlobalState.bBenchProfiler) { return EngineProfilerBenchmark(); }
+    if (GlobalState.bBenchJobs) { return EngineJobBenchmark(); }
+    if (GlobalState.bBenchECS) { return EngineECSBenchmark(); }
+    if (GlobalState.bBenchInstances) { return EngineInstanceBenchmark(); }
+    if (GlobalState.bBenchSprites) { return EngineSpriteBenchmark(); }
+    if (GlobalState.bBenchCulling) { return EngineCullingBenchmark(); }
+    if (GlobalState.bHeadless) { return EngineHeadlessLoop(); }
+
+    const double LoopStartTime = glfwGetTime();
+    double RateStartTime = LoopStartTime;
+    int RateFrames = 0;
+    int64_t TotalFrames = 0;
+
+    bool bResult = true;
     bool bRunning = true;
     while (bRunning)
     {
-        Graphics::Draw(GlobalState.AppWindow);
+        PROFILE_SCOPE("Frame");
+        BeginEngineFrame();
+        // The simulation thread runs fixed steps, rendering interpolates between the last two it published
+        Graphics::Draw(GlobalState.AppWindow, Simulation::GetRenderState(glfwGetTime()));
+        TotalFrames++;
 
-        glfwPollEvents();
+        {
+            ALLOC_EXEMPT_SCOPE("Platform");
+            glfwPollEvents();
+        }
         if (glfwWindowShouldClose(GlobalState.AppWindow))
         {
             bRunning = false;
         }
+        if (!EndEngineFrame())
+        {
+            bResult = false;
+            bRunning = false;
+        }
+
+        if (GlobalState.bUncapped)
+        {
+            RateFrames++;
+            const double CurrTime = glfwGetTime();
+            if (CurrTime - RateStartTime >= 1.0)
+            {
+                const double Seconds = CurrTime - RateStartTime;
+                LOGF("Uncapped: %.1f fps (%.3f ms/frame)\n", RateFrames / Seconds, Seconds * 1000.0 / RateFrames);
+                RateStartTime = CurrTime;
+                RateFrames = 0;
+            }
+        }
     }
 
-    return true;
+    if (GlobalState.bUncapped && TotalFrames > 0)
+    {
+        const double Seconds = glfwGetTime() - LoopStartTime;
+        const SimStats& Stats = Simulation::GetStats();
+        LOGF("Uncapped: %lld frames in %.2f s, %.1f fps average, %llu simulation steps (%.2f s dropped)\n",
+            (long long)TotalFrames, Seconds, TotalFrames / Seconds, (unsigned long long)Stats.NumSteps, Stats.DroppedSeconds);
+    }
+
+    return bResult;
 }
 
 bool EngineTerminate()
 {
+    Simulation::Terminate();
+    Jobs::Terminate();
+    FrameArena::Terminate();
     if (GlobalState.AppWindow)
     {
+        Graphics::Terminate();
         glfwDestroyWindow(GlobalState.AppWindow);
     }
+    Entities::Terminate();
 
     glfwTerminate();
 
@@ -99,11 +752,36 @@ bool EngineTerminate()
 
 int Main(int argc, const char* argv[])
 {
-    bool Result = true;
-    Result &= HandleArgs(argc, argv);
-    Result &= EngineInit();
-    Result &= EngineMainLoop();
+    if (!HandleArgs(argc, argv)) { return ErrorRetval; }
+    AllocTracker::Init();
+    Profiler::Init();
+    Profiler::SetThreadName("Main");
+
+    bool Result = EngineInit();
+    if (Result)
+    {
+        Result &= EngineMainLoop();
+    }
+    if (Result && GlobalState.ZeroAllocWarmupFrames >= 0)
+    {
+        const int64_t NumChecked = GlobalState.NumFramesRun - GlobalState.ZeroAllocWarmupFrames;
+        if (NumChecked > 0)
+        {
+            const AllocCounts Exempt = AllocTracker::GetExemptTotal();
+            LOGF("Zero-alloc test passed: %lld frames after the warm-up, no heap allocations (%llu exempt driver/platform allocations)\n",
+                (long long)NumChecked, (unsigned long long)(Exempt.NumAllocs - GlobalState.ZeroAllocExemptStart.NumAllocs));
+        }
+        else
+        {
+            LOGF("Zero-alloc test FAILED: only %lld frames ran, none past the %d warm-up frames\n", (long long)GlobalState.NumFramesRun,
+                GlobalState.ZeroAllocWarmupFrames);
+            Result = false;
+        }
+        AllocTracker::LogTotals();
+    }
+    if (GlobalState.TraceFilename) { Profiler::DumpChromeTrace(GlobalState.TraceFilename); }
     Result &= EngineTerminate();
+    Profiler::Terminate();
     return Result ? SuccessRetval : ErrorRetval;
 }
 }
@@ -0,0 +1,401 @@
+#include "LofiEntities.h"
+#include "LofiAllocTracker.h"
+#include "LofiJobs.h"
+#include "LofiProfiler.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace Lofi
+{
+struct ComponentInfo
+{
+    int Size;
+};
+
+// By component bit index
+const ComponentInfo ComponentInfos[NumComponents] =
+{
+    { (int)sizeof(transform_component) },
+    { (int)sizeof(spin_component) },
+    { (int)sizeof(render_component) },
+};
+
+// EntityChunkBytes of component arrays; malloc doesn't promise cache line alignment, so the block is aligned by hand
+struct ArchetypeChunk
+{
+    void* Allocation = nullptr;
+    unsigned char* Data = nullptr;
+    int Count = 0;
+};
+
+struct Archetype
+{
+    bool bInitialized = false;
+    int Capacity = 0; // Rows per chunk
+    int ComponentOffsets[NumComponents]; // Byte offset of each component's array in a chunk, -1 when absent
+    int EntitiesOffset = 0;
+    // Only the last chunk has free rows
+    std::vector<ArchetypeChunk> Chunks;
+};
+
+struct EntityRecord
+{
+    uint32_t Generation = 0;
+    ComponentMask Mask = 0;
+    int Chunk = -1; // -1 while the index is free
+    int Row = 0;
+};
+
+struct EntitiesState_t
+{
+    Archetype Archetypes[MaxArchetypes];
+    std::vector<EntityRecord> Records;
+    std::vector<uint32_t> FreeIndices;
+    int NumEntities = 0;
+    // Reused by ParallelForEachChunk so steady-state queries don't allocate
+    std::vector<EntityChunk> QueryChunks;
+} EntitiesState;
+
+int AlignToCacheLine(int Offset)
+{
+    return (Offset + EntityCacheLine - 1) & ~(EntityCacheLine - 1);
+}
+
+// Every array starts on its own cache line: fit as many rows as the padding allows
+void InitArchetype(Archetype& Arch, ComponentMask Mask)
+{
+    int RowBytes = (int)sizeof(Entity);
+    int NumArrays = 1;
+    for (int CompIdx = 0; CompIdx < NumComponents; CompIdx++)
+    {
+        if (Mask & (1u << CompIdx))
+        {
+            RowBytes += ComponentInfos[CompIdx].Size;
+            NumArrays++;
+        }
+    }
+    int Capacity = (EntityChunkBytes - NumArrays * EntityCacheLine) / RowBytes;
+    for (;;)
+    {
+        int Offset = 0;
+        for (int CompIdx = 0; CompIdx < NumComponents; CompIdx++)
+        {
+            Arch.ComponentOffsets[CompIdx] = -1;
+            if (Mask & (1u << CompIdx))
+            {
+                Arch.ComponentOffsets[CompIdx] = Offset;
+                Offset = AlignToCacheLine(Offset + ComponentInfos[CompIdx].Size * Capacity);
+            }
+        }
+        Arch.EntitiesOffset = Offset;
+        Offset += (int)sizeof(Entity) * Capacity;
+        if (Offset <= EntityChunkBytes) { break; }
+        Capacity--;
+    }
+    Arch.Capacity = Capacity;
+    Arch.bInitialized = true;
+}
+
+Archetype& GetArchetype(ComponentMask Mask)
+{
+    Archetype& Arch = EntitiesState.Archetypes[Mask];
+    if (!Arch.bInitialized) { InitArchetype(Arch, Mask); }
+    return Arch;
+}
+
+void* GetComponentRow(const Archetype& Arch, const ArchetypeChunk& Chunk, int CompIdx, int Row)
+{
+    return Chunk.Data + Arch.ComponentOffsets[CompIdx] + ComponentInfos[CompIdx].Size * Row;
+}
+
+Entity* GetChunkEntities(const Archetype& Arch, const ArchetypeChunk& Chunk)
+{
+    return (Entity*)(Chunk.Data + Arch.EntitiesOffset);
+}
+
+// Zeroed row at the end of the archetype's last chunk; false when out of memory
+bool AddRow(Archetype& Arch, Entity InEntity, int& OutChunk, int& OutRow)
+{
+    if (Arch.Chunks.empty() || Arch.Chunks.back().Count == Arch.Capacity)
+    {
+        ALLOC_SCOPE("Entities");
+        ArchetypeChunk NewChunk;
+        NewChunk.Allocation = malloc(EntityChunkBytes + EntityCacheLine);
+        if (!NewChunk.Allocation) { return false; }
+        NewChunk.Data = (unsigned char*)(((uintptr_t)NewChunk.Allocation + EntityCacheLine - 1) & ~(uintptr_t)(EntityCacheLine - 1));
+        Arch.Chunks.push_back(NewChunk);
+    }
+    OutChunk = (int)Arch.Chunks.size() - 1;
+    ArchetypeChunk& Chunk = Arch.Chunks[OutChunk];
+    OutRow = Chunk.Count++;
+    for (int CompIdx = 0; CompIdx < NumComponents; CompIdx++)
+    {
+        if (Arch.ComponentOffsets[CompIdx] >= 0)
+        {
+            memset(GetComponentRow(Arch, Chunk, CompIdx, OutRow), 0, ComponentInfos[CompIdx].Size);
+        }
+    }
+    GetChunkEntities(Arch, Chunk)[OutRow] = InEntity;
+    return true;
+}
+
+// Fills the hole with the archetype's very last row so every chunk but the last stays full
+void RemoveRow(Archetype& Arch, int ChunkIdx, int Row)
+{
+    ArchetypeChunk& Chunk = Arch.Chunks[ChunkIdx];
+    ArchetypeChunk& Last = Arch.Chunks.back();
+    const int LastRow = Last.Count - 1;
+    if (&Chunk != &Last || Row != LastRow)
+    {
+        for (int CompIdx = 0; CompIdx < NumComponents; CompIdx++)
+        {
+            if (Arch.ComponentOffsets[CompIdx] >= 0)
+            {
+                memcpy(GetComponentRow(Arch, Chunk, CompIdx, Row), GetComponentRow(Arch, Last, CompIdx, LastRow),
+                    ComponentInfos[CompIdx].Size);
+            }
+        }
+        const Entity Moved = GetChunkEntities(Arch, Last)[LastRow];
+        GetChunkEntities(Arch, Chunk)[Row] = Moved;
+        EntityRecord& MovedRecord = EntitiesState.Records[Moved.index];
+        MovedRecord.Chunk = ChunkIdx;
+        MovedRecord.Row = Row;
+    }
+    Last.Count--;
+    if (Last.Count == 0)
+    {
+        free(Last.Allocation);
+        Arch.Chunks.pop_back();
+    }
+}
+
+void FreeArchetypes()
+{
+    for (Archetype& Arch : EntitiesState.Archetypes)
+    {
+        for (ArchetypeChunk& Chunk : Arch.Chunks) { free(Chunk.Allocation); }
+        Arch.Chunks.clear();
+    }
+}
+
+void Entities::Init()
+{
+    FreeArchetypes();
+    EntitiesState.Records.clear();
+    EntitiesState.FreeIndices.clear();
+    EntitiesState.NumEntities = 0;
+}
+
+void Entities::Terminate()
+{
+    FreeArchetypes();
+    EntitiesState.Records = std::vector<EntityRecord>();
+    EntitiesState.FreeIndices = std::vector<uint32_t>();
+    EntitiesState.QueryChunks = std::vector<EntityChunk>();
+    EntitiesState.NumEntities = 0;
+}
+
+Entity Entities::Create(ComponentMask Mask)
+{
+    ALLOC_SCOPE("Entities");
+    EntitiesState_t& State = EntitiesState;
+    if (Mask >= (ComponentMask)MaxArchetypes) { return InvalidEntity; }
+
+    uint32_t Index = 0;
+    if (!State.FreeIndices.empty())
+    {
+        Index = State.FreeIndices.back();
+        State.FreeIndices.pop_back();
+    }
+    else
+    {
+        Index = (uint32_t)State.Records.size();
+        State.Records.push_back(EntityRecord());
+    }
+
+    EntityRecord& Record = State.Records[Index];
+    const Entity Result = { Index, Record.Generation };
+    if (!AddRow(GetArchetype(Mask), Result, Record.Chunk, Record.Row))
+    {
+        State.FreeIndices.push_back(Index);
+        return InvalidEntity;
+    }
+    Record.Mask = Mask;
+    State.NumEntities++;
+    return Result;
+}
+
+bool Entities::IsAlive(Entity InEntity)
+{
+    const EntitiesState_t& State = EntitiesState;
+    return InEntity.index < State.Records.size() && State.Records[InEntity.index].Chunk >= 0 &&
+        State.Records[InEntity.index].Generation == InEntity.generation;
+}
+
+void Entities::Destroy(Entity InEntity)
+{
+    ALLOC_SCOPE("Entities");
+    if (!IsAlive(InEntity)) { return; }
+    EntitiesState_t& State = EntitiesState;
+    EntityRecord& Record = State.Records[InEntity.index];
+    RemoveRow(State.Archetypes[Record.Mask], Record.Chunk, Record.Row);
+    Record.Chunk = -1;
+    Record.Generation++;
+    State.FreeIndices.push_back(InEntity.index);
+    State.NumEntities--;
+}
+
+void Entities::SetMask(Entity InEntity, ComponentMask Mask)
+{
+    if (!IsAlive(InEntity) || Mask >= (ComponentMask)MaxArchetypes) { return; }
+    EntitiesState_t& State = EntitiesState;
+    EntityRecord& Record = State.Records[InEntity.index];
+    if (Record.Mask == Mask) { return; }
+
+    Archetype& From = State.Archetypes[Record.Mask];
+    Archetype& To = GetArchetype(Mask);
+    int ToChunk = 0;
+    int ToRow = 0;
+    if (!AddRow(To, InEntity, ToChunk, ToRow)) { return; }
+    const ComponentMask Kept = Record.Mask & Mask;
+    for (int CompIdx = 0; CompIdx < NumComponents; CompIdx++)
+    {
+        if (Kept & (1u << CompIdx))
+        {
+            memcpy(GetComponentRow(To, To.Chunks[ToChunk], CompIdx, ToRow),
+                GetComponentRow(From, From.Chunks[Record.Chunk], CompIdx, Record.Row), ComponentInfos[CompIdx].Size);
+        }
+    }
+    RemoveRow(From, Record.Chunk, Record.Row);
+    Record.Mask = Mask;
+    Record.Chunk = ToChunk;
+    Record.Row = ToRow;
+}
+
+ComponentMask Entities::GetMask(Entity InEntity)
+{
+    return IsAlive(InEntity) ? EntitiesState.Records[InEntity.index].Mask : 0;
+}
+
+void* Entities::Get(Entity InEntity, Component InComponent)
+{
+    if (!IsAlive(InEntity)) { return nullptr; }
+    const EntityRecord& Record = EntitiesState.Records[InEntity.index];
+    if (!(Record.Mask & InComponent)) { return nullptr; }
+    const Archetype& Arch = EntitiesState.Archetypes[Record.Mask];
+    return GetComponentRow(Arch, Arch.Chunks[Record.Chunk], GetComponentIndex(InComponent), Record.Row);
+}
+
+EntityChunk MakeEntityChunk(const Archetype& Arch, const ArchetypeChunk& Chunk)
+{
+    EntityChunk Result;
+    Result.count = Chunk.Count;
+    Result.entities = GetChunkEntities(Arch, Chunk);
+    for (int CompIdx = 0; CompIdx < NumComponents; CompIdx++)
+    {
+        Result.components[CompIdx] = Arch.ComponentOffsets[CompIdx] >= 0 ? Chunk.Data + Arch.ComponentOffsets[CompIdx] : nullptr;
+    }
+    return Result;
+}
+
+void Entities::ForEachChunk(ComponentMask Mask, EntityChunkFunction Function, void* Context)
+{
+    for (int ArchIdx = 0; ArchIdx < MaxArchetypes; ArchIdx++)
+    {
+        if ((ArchIdx & Mask) != Mask) { continue; }
+        const Archetype& Arch = EntitiesState.Archetypes[ArchIdx];
+        for (const ArchetypeChunk& Chunk : Arch.Chunks)
+        {
+            Function(MakeEntityChunk(Arch, Chunk), Context);
+        }
+    }
+}
+
+struct EntityQueryJob
+{
+    const EntityChunk* Chunks;
+    EntityChunkFunction Function;
+    void* Context;
+};
+
+void EntityQueryBatch(int Begin, int End, void* Context)
+{
+    const EntityQueryJob& Query = *(const EntityQueryJob*)Context;
+    for (int ChunkIdx = Begin; ChunkIdx < End; ChunkIdx++)
+    {
+        Query.Function(Query.Chunks[ChunkIdx], Query.Context);
+    }
+}
+
+void Entities::ParallelForEachChunk(ComponentMask Mask, EntityChunkFunction Function, void* Context)
+{
+    EntitiesState_t& State = EntitiesState;
+    State.QueryChunks.clear();
+    {
+        ALLOC_SCOPE("Entities");
+        for (int ArchIdx = 0; ArchIdx < MaxArchetypes; ArchIdx++)
+        {
+            if ((ArchIdx & Mask) != Mask) { continue; }
+            const Archetype& Arch = State.Archetypes[ArchIdx];
+            for (const ArchetypeChunk& Chunk : Arch.Chunks)
+            {
+                State.QueryChunks.push_back(MakeEntityChunk(Arch, Chunk));
+            }
+        }
+    }
+    if (State.QueryChunks.empty()) { return; }
+    const EntityQueryJob Query = { State.QueryChunks.data(), Function, Context };
+    Jobs::ParallelFor((int)State.QueryChunks.size(), 0, EntityQueryBatch, (void*)&Query);
+}
+
+int Entities::CountMatching(ComponentMask Mask)
+{
+    int Result = 0;
+    for (int ArchIdx = 0; ArchIdx < MaxArchetypes; ArchIdx++)
+    {
+        if ((ArchIdx & Mask) != Mask) { continue; }
+        for (const ArchetypeChunk& Chunk : EntitiesState.Archetypes[ArchIdx].Chunks) { Result += Chunk.Count; }
+    }
+    return Result;
+}
+
+void SpinChunk(const EntityChunk& Chunk, void* Context)
+{
+    const float DeltaTime = *(const float*)Context;
+    transform_component* Transforms = GetChunkComponents<transform_component>(Chunk, Component_Transform);
+    const spin_component* Spins = GetChunkComponents<spin_component>(Chunk, Component_Spin);
+    const float TwoPi = 2.0f * HMM_PI32;
+    for (int Row = 0; Row < Chunk.count; Row++)
+    {
+        float Yaw = Transforms[Row].yaw + Spins[Row].yaw_speed * DeltaTime;
+        // Keep it small so float precision holds up however long it spins
+        if (Yaw >= TwoPi) { Yaw -= TwoPi; }
+        else if (Yaw < 0.0f) { Yaw += TwoPi; }
+        Transforms[Row].yaw = Yaw;
+    }
+}
+
+void Entities::UpdateSpin(float DeltaTime, bool bParallel)
+{
+    PROFILE_SCOPE("Entities::UpdateSpin");
+    if (bParallel) { ParallelForEachChunk(Component_Transform | Component_Spin, SpinChunk, &DeltaTime); }
+    else { ForEachChunk(Component_Transform | Component_Spin, SpinChunk, &DeltaTime); }
+}
+
+EntityStats Entities::GetStats()
+{
+    EntityStats Result;
+    Result.NumEntities = EntitiesState.NumEntities;
+    for (const Archetype& Arch : EntitiesState.Archetypes)
+    {
+        if (!Arch.Chunks.empty())
+        {
+            Result.NumArchetypes++;
+            Result.NumChunks += (int)Arch.Chunks.size();
+        }
+    }
+    return Result;
+}
+}
@@ -0,0 +1,116 @@
+#ifndef LOFIENTITIES_H
+#define LOFIENTITIES_H
+
+#include "Common.h"
+#include "LofiGraphics.h"
+
+namespace Lofi
+{
+// One bit per component type, an entity's mask picks its archetype
+enum Component : uint32_t
+{
+    Component_Transform = 1 << 0,
+    Component_Spin = 1 << 1,
+    Component_Render = 1 << 2,
+};
+constexpr int NumComponents = 3;
+using ComponentMask = uint32_t;
+
+struct transform_component
+{
+    v3f position;
+    float yaw; // Radians around +Y
+    float scale;
+};
+
+struct spin_component
+{
+    float yaw_speed; // Radians per second
+};
+
+// Drawn as an instanced cubie; culled as a sphere of radius * transform scale around the position
+struct render_component
+{
+    uint32_t face_colors[6]; // RGBA8, same order as cube_instance
+    float radius;
+};
+
+// Index into the entity table plus a generation, so a handle to a destroyed entity stays invalid
+struct Entity
+{
+    uint32_t index;
+    uint32_t generation;
+};
+constexpr Entity InvalidEntity = { 0xFFFFFFFFu, 0 };
+
+constexpr int EntityChunkBytes = 16 * 1024;
+constexpr int EntityCacheLine = 64;
+constexpr int MaxArchetypes = 1 << NumComponents;
+
+// What a query hands to its function: one chunk's rows, each component as its own array
+struct EntityChunk
+{
+    int count;
+    const Entity* entities;
+    void* components[NumComponents]; // By component bit index, nullptr for components the archetype lacks
+};
+typedef void (*EntityChunkFunction)(const EntityChunk& Chunk, void* Context);
+
+struct EntityStats
+{
+    int NumEntities = 0;
+    int NumArchetypes = 0;
+    int NumChunks = 0;
+};
+
+/*
+    Archetype entity storage: entities with the same component mask live together in fixed-size
+        chunks, every component as its own cache-line-aligned array inside the chunk, so a query
+        walks plain arrays of exactly the components it asked for.
+    Rows are kept packed: destroying an entity (or moving it to another archetype when its mask
+        changes) moves the chunk's last row into the hole. Component pointers are therefore only
+        good until the next structural change.
+    Main thread only, apart from what a ParallelForEachChunk function does with its own chunk.
+*/
+struct Entities
+{
+    static void Init();
+    static void Terminate();
+
+    // Components start zeroed
+    static Entity Create(ComponentMask Mask);
+    static void Destroy(Entity InEntity);
+    static bool IsAlive(Entity InEntity);
+    // Moves the entity to the archetype of its new mask, keeping the components both have
+    static void SetMask(Entity InEntity, ComponentMask Mask);
+    static ComponentMask GetMask(Entity InEntity);
+    // nullptr if the entity is gone or doesn't have the component
+    static void* Get(Entity InEntity, Component InComponent);
+
+    // Every chunk whose archetype has at least the components in Mask
+    static void ForEachChunk(ComponentMask Mask, EntityChunkFunction Function, void* Context);
+    // Same, chunks spread over the job system; Function must only touch its own chunk's rows
+    static void ParallelForEachChunk(ComponentMask Mask, EntityChunkFunction Function, void* Context);
+    static int CountMatching(ComponentMask Mask);
+
+    // Built-in systems
+    static void UpdateSpin(float DeltaTime, bool bParallel);
+
+    static EntityStats GetStats();
+};
+
+inline int GetComponentIndex(Component InComponent)
+{
+    int Result = 0;
+    while ((1u << Result) != (uint32_t)InComponent) { Result++; }
+    return Result;
+}
+
+template<typename T>
+T* GetChunkComponents(const EntityChunk& Chunk, Component InComponent)
+{
+    return (T*)Chunk.components[GetComponentIndex(InComponent)];
+}
+}
+
+#endif // LOFIENTITIES_H
@@ -0,0 +1,151 @@
+#include "LofiFrameArena.h"
+#include "LofiAllocTracker.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+namespace Lofi
+{
+// Heap block for an allocation that didn't fit, chained to its frame and freed with it
+struct FrameArenaOverflow
+{
+    FrameArenaOverflow* Next;
+};
+
+struct FrameArenaBuffer
+{
+    unsigned char* Base = nullptr;
+    std::atomic<size_t> Offset{ 0 };
+    std::atomic<int> NumAllocations{ 0 };
+    FrameArenaOverflow* Overflows = nullptr;
+    size_t OverflowBytes = 0;
+};
+
+struct FrameArenaState_t
+{
+    FrameArenaBuffer Frames[FrameArena_NumFrames];
+    int FrameIdx = 0;
+    size_t BytesPerFrame = 0;
+    std::mutex OverflowMutex;
+    FrameArenaStats Stats;
+} FrameArenaState;
+
+void FreeOverflows(FrameArenaBuffer& Frame)
+{
+    while (Frame.Overflows)
+    {
+        FrameArenaOverflow* Overflow = Frame.Overflows;
+        Frame.Overflows = Overflow->Next;
+        free(Overflow);
+    }
+    Frame.OverflowBytes = 0;
+}
+
+bool FrameArena::Init(size_t BytesPerFrame)
+{
+    FrameArenaState_t& State = FrameArenaState;
+    State.BytesPerFrame = BytesPerFrame;
+    for (FrameArenaBuffer& Frame : State.Frames)
+    {
+        Frame.Base = new unsigned char[BytesPerFrame];
+#if LOFI_FRAME_ARENA_DEBUG
+        memset(Frame.Base, FrameArenaPoison, BytesPerFrame);
+#endif
+        Frame.Offset.store(0, std::memory_order_relaxed);
+        Frame.NumAllocations.store(0, std::memory_order_relaxed);
+    }
+    State.FrameIdx = 0;
+    State.Stats = {};
+    return true;
+}
+
+void FrameArena::Terminate()
+{
+    FrameArenaState_t& State = FrameArenaState;
+    for (FrameArenaBuffer& Frame : State.Frames)
+    {
+        FreeOverflows(Frame);
+        delete[] Frame.Base;
+        Frame.Base = nullptr;
+    }
+    State.BytesPerFrame = 0;
+}
+
+void FrameArena::BeginFrame()
+{
+    FrameArenaState_t& State = FrameArenaState;
+    const FrameArenaBuffer& Finished = State.Frames[State.FrameIdx];
+    State.Stats.BytesUsed = Finished.Offset.load(std::memory_order_relaxed) + Finished.OverflowBytes;
+    State.Stats.NumAllocations = Finished.NumAllocations.load(std::memory_order_relaxed);
+    if (State.Stats.BytesUsed > State.Stats.HighWaterBytes) { State.Stats.HighWaterBytes = State.Stats.BytesUsed; }
+
+    // The frame before the one that just finished is done being read
+    State.FrameIdx = (State.FrameIdx + 1) % FrameArena_NumFrames;
+    FrameArenaBuffer& Frame = State.Frames[State.FrameIdx];
+#if LOFI_FRAME_ARENA_DEBUG
+    memset(Frame.Base, FrameArenaPoison, Frame.Offset.load(std::memory_order_relaxed));
+#endif
+    Frame.Offset.store(0, std::memory_order_relaxed);
+    Frame.NumAllocations.store(0, std::memory_order_relaxed);
+    FreeOverflows(Frame);
+}
+
+void* AllocOverflow(FrameArenaBuffer& Frame, size_t Size, size_t Alignment)
+{
+    ALLOC_SCOPE("FrameArena");
+    FrameArenaState_t& State = FrameArenaState;
+    const size_t HeaderSize = (sizeof(FrameArenaOverflow) + Alignment - 1) & ~(Alignment - 1);
+    // malloc only promises 16 byte alignment, leave room to align further
+    const size_t BlockSize = HeaderSize + Size + (Alignment > 16 ? Alignment : 0);
+    FrameArenaOverflow* Overflow = (FrameArenaOverflow*)malloc(BlockSize);
+    if (!Overflow) { return nullptr; }
+    {
+        std::lock_guard<std::mutex> Lock(State.OverflowMutex);
+        Overflow->Next = Frame.Overflows;
+        Frame.Overflows = Overflow;
+        Frame.OverflowBytes += Size;
+        if (State.Stats.NumOverflows++ == 0)
+        {
+            LOGF("FrameArena: frame outgrew its %lld bytes, overflowing to the heap\n", (long long)State.BytesPerFrame);
+        }
+    }
+    const uintptr_t Payload = ((uintptr_t)Overflow + HeaderSize + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
+    return (void*)Payload;
+}
+
+void* FrameArena::Alloc(size_t Size, size_t Alignment)
+{
+    FrameArenaState_t& State = FrameArenaState;
+    FrameArenaBuffer& Frame = State.Frames[State.FrameIdx];
+    Frame.NumAllocations.fetch_add(1, std::memory_order_relaxed);
+
+    // Align the address, not the offset, so alignments above new[]'s hold too
+    const uintptr_t Base = (uintptr_t)Frame.Base;
+    size_t Offset = Frame.Offset.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        const size_t Aligned = (size_t)(((Base + Offset + Alignment - 1) & ~(uintptr_t)(Alignment - 1)) - Base);
+        if (Aligned + Size > State.BytesPerFrame) { break; }
+        if (Frame.Offset.compare_exchange_weak(Offset, Aligned + Size, std::memory_order_relaxed))
+        {
+            return Frame.Base + Aligned;
+        }
+    }
+    return AllocOverflow(Frame, Size, Alignment);
+}
+
+const FrameArenaStats& FrameArena::GetStats()
+{
+    return FrameArenaState.Stats;
+}
+
+void FrameArena::LogStats()
+{
+    const FrameArenaStats& Stats = FrameArenaState.Stats;
+    LOGF("    Frame arena: %lld bytes in %d allocations last frame, high water %lld of %lld bytes, %d overflows%s\n",
+        (long long)Stats.BytesUsed, Stats.NumAllocations, (long long)Stats.HighWaterBytes, (long long)FrameArenaState.BytesPerFrame,
+        Stats.NumOverflows, LOFI_FRAME_ARENA_DEBUG ? ", poisoned on reset" : "");
+}
+}
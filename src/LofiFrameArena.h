@@ -0,0 +1,76 @@
+#ifndef LOFIFRAMEARENA_H
+#define LOFIFRAMEARENA_H
+
+#include "Common.h"
+
+#include <cstddef>
+
+// Debug builds poison memory as the arena takes it back, so reads of stale frame data stand out
+#if !defined(LOFI_FRAME_ARENA_DEBUG)
+#if !defined(NDEBUG)
+#define LOFI_FRAME_ARENA_DEBUG 1
+#else
+#define LOFI_FRAME_ARENA_DEBUG 0
+#endif
+#endif
+
+namespace Lofi
+{
+constexpr size_t FrameArenaBytesPerFrame = 16 * 1024 * 1024;
+constexpr int FrameArena_NumFrames = 2;
+constexpr unsigned char FrameArenaPoison = 0xDD;
+
+struct FrameArenaStats
+{
+    size_t BytesUsed = 0; // Last finished frame
+    size_t HighWaterBytes = 0; // Most any frame has used since Init, overflow included
+    int NumAllocations = 0; // Last finished frame
+    int NumOverflows = 0; // Allocations that didn't fit and went to the heap, since Init
+};
+
+/*
+    Per-frame scratch memory: Alloc bumps an offset, nothing is freed individually. BeginFrame
+        switches to the other of FrameArena_NumFrames buffers and resets it, so whatever was
+        allocated during frame N stays valid until frame N+2 begins; render code can read last
+        frame's data while this frame's is written.
+    Alloc is lock-free and may be called from job workers during the frame. Not for threads with
+        their own cadence (the simulation thread), their data wouldn't line up with frames.
+    When a frame outgrows its buffer, the rest of its allocations come from the heap and are freed
+        with the frame; NumOverflows says the buffers should be bigger.
+*/
+struct FrameArena
+{
+    static bool Init(size_t BytesPerFrame = FrameArenaBytesPerFrame);
+    static void Terminate();
+
+    static void BeginFrame();
+    // Alignment must be a power of two; nullptr only if an overflow can't get heap memory either
+    static void* Alloc(size_t Size, size_t Alignment = 16);
+    template<typename T>
+    static T* AllocArray(size_t Count) { return (T*)Alloc(sizeof(T) * Count, alignof(T)); }
+
+    static const FrameArenaStats& GetStats();
+    static void LogStats();
+};
+
+// STL allocator on top of FrameArena; deallocate does nothing, containers must not outlive the frame after next
+template<typename T>
+struct FrameAllocator
+{
+    typedef T value_type;
+
+    FrameAllocator() = default;
+    template<typename U>
+    FrameAllocator(const FrameAllocator<U>&) {}
+
+    T* allocate(size_t Count) { return FrameArena::AllocArray<T>(Count); }
+    void deallocate(T*, size_t) {}
+};
+
+template<typename T, typename U>
+bool operator==(const FrameAllocator<T>&, const FrameAllocator<U>&) { return true; }
+template<typename T, typename U>
+bool operator!=(const FrameAllocator<T>&, const FrameAllocator<U>&) { return false; }
+}
+
+#endif // LOFIFRAMEARENA_H
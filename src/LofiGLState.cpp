@@ -0,0 +1,107 @@
+#include "LofiGLState.h"
+
+namespace Lofi
+{
+constexpr int MaxTextureUnits = 16;
+// Never a valid GL name, forces the next bind through
+constexpr GLuint UnknownBinding = 0xFFFFFFFF;
+
+struct GLStateCache_t
+{
+    bool bHasDSA = false;
+
+    GLuint Program = UnknownBinding;
+    GLuint VertexArray = UnknownBinding;
+    GLuint ActiveTextureUnit = UnknownBinding;
+    GLuint Textures2D[MaxTextureUnits];
+
+    GLStateStats Stats;
+} GLStateCache;
+
+void GLState::Init()
+{
+    GLStateCache.bHasDSA = GLAD_GL_ARB_direct_state_access != 0;
+    LOGF("GLState: direct state access %s\n", GLStateCache.bHasDSA ? "enabled" : "unavailable");
+    Invalidate();
+}
+
+bool GLState::HasDSA()
+{
+    return GLStateCache.bHasDSA;
+}
+
+void GLState::UseProgram(GLuint Program)
+{
+    if (GLStateCache.Program == Program) { GLStateCache.Stats.Skipped++; return; }
+
+    glUseProgram(Program);
+    GLStateCache.Program = Program;
+    GLStateCache.Stats.Issued++;
+}
+
+void GLState::BindTexture2D(GLuint Unit, GLuint Texture)
+{
+    if (Unit >= MaxTextureUnits) { return; }
+    if (GLStateCache.Textures2D[Unit] == Texture) { GLStateCache.Stats.Skipped++; return; }
+
+    if (GLStateCache.bHasDSA)
+    {
+        // Doesn't touch the active texture unit
+        glBindTextureUnit(Unit, Texture);
+    }
+    else
+    {
+        if (GLStateCache.ActiveTextureUnit != Unit)
+        {
+            glActiveTexture(GL_TEXTURE0 + Unit);
+            GLStateCache.ActiveTextureUnit = Unit;
+        }
+        glBindTexture(GL_TEXTURE_2D, Texture);
+    }
+    GLStateCache.Textures2D[Unit] = Texture;
+    GLStateCache.Stats.Issued++;
+}
+
+void GLState::BindVertexArray(GLuint VertexArray)
+{
+    if (GLStateCache.VertexArray == VertexArray) { GLStateCache.Stats.Skipped++; return; }
+
+    glBindVertexArray(VertexArray);
+    GLStateCache.VertexArray = VertexArray;
+    GLStateCache.Stats.Issued++;
+}
+
+void GLState::Invalidate()
+{
+    GLStateCache.Program = UnknownBinding;
+    GLStateCache.VertexArray = UnknownBinding;
+    GLStateCache.ActiveTextureUnit = UnknownBinding;
+    for (int UnitIdx = 0; UnitIdx < MaxTextureUnits; UnitIdx++)
+    {
+        GLStateCache.Textures2D[UnitIdx] = UnknownBinding;
+    }
+}
+
+void GLState::ForgetTexture(GLuint Texture)
+{
+    for (int UnitIdx = 0; UnitIdx < MaxTextureUnits; UnitIdx++)
+    {
+        if (GLStateCache.Textures2D[UnitIdx] == Texture) { GLStateCache.Textures2D[UnitIdx] = UnknownBinding; }
+    }
+}
+
+void GLState::ForgetProgram(GLuint Program)
+{
+    if (GLStateCache.Program == Program) { GLStateCache.Program = UnknownBinding; }
+}
+
+void GLState::BeginFrame()
+{
+    GLStateCache.Stats = {};
+}
+
+const GLStateStats& GLState::GetStats()
+{
+    return GLStateCache.Stats;
+}
+}
@@ -0,0 +1,35 @@
+#ifndef LOFIGLSTATE_H
+#define LOFIGLSTATE_H
+
+#include "Common.h"
+
+namespace Lofi
+{
+struct GLStateStats
+{
+    int Issued = 0;
+    int Skipped = 0;
+};
+
+// Shadow copy of the binds we issue, so redundant ones never reach the driver
+//     NOTE: Anything that changes these bindings behind the cache's back must call Invalidate()
+struct GLState
+{
+    static void Init();
+    static bool HasDSA();
+
+    static void UseProgram(GLuint Program);
+    static void BindTexture2D(GLuint Unit, GLuint Texture);
+    static void BindVertexArray(GLuint VertexArray);
+
+    static void Invalidate();
+    // Call before deleting a texture / program: GL reuses freed names, a stale shadow copy would skip binding the new object
+    static void ForgetTexture(GLuint Texture);
+    static void ForgetProgram(GLuint Program);
+    // Resets the per-frame counters
+    static void BeginFrame();
+    static const GLStateStats& GetStats();
+};
+}
+
+#endif // LOFIGLSTATE_H
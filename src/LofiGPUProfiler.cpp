@@ -0,0 +1,191 @@
+#include "LofiGPUProfiler.h"
+
+#include <algorithm>
+
+namespace Lofi
+{
+const char* GPUPassNames[GPUPass_Count] = { "Frame", "Uploads", "World", "Screen" };
+
+struct GPUProfileFrame
+{
+    GLuint Queries[GPUPass_Count][2]; // Begin / end timestamps
+    bool bIssued[GPUPass_Count];
+    GLuint LastQuery; // Timestamps complete in order, once this one is available all of them are
+    bool bPending;
+};
+
+struct GPUPassHistory
+{
+    double SamplesMs[MaxGPUProfileSamples];
+    int NumSamples;
+    int NextSample;
+    double LastMs;
+};
+
+struct GPUProfilerState_t
+{
+    bool bEnabled = false;
+    GPUProfileFrame Frames[GPUProfile_NumFrames] = {};
+    int FrameIdx = 0;
+    bool bRecording = false; // The current frame's slot was free
+    GPUPassHistory History[GPUPass_Count] = {};
+    GPUProfilerStats Stats;
+} GPUProfilerState;
+
+void GPUProfiler::Init()
+{
+    GPUProfilerState.bEnabled = GLAD_GL_VERSION_3_3 || GLAD_GL_ARB_timer_query;
+    if (!GPUProfilerState.bEnabled)
+    {
+        LOGF("GPUProfiler: timer queries unavailable, GPU pass times disabled\n");
+        return;
+    }
+    for (GPUProfileFrame& Frame : GPUProfilerState.Frames)
+    {
+        glGenQueries(GPUPass_Count * 2, &Frame.Queries[0][0]);
+        Frame.bPending = false;
+    }
+    GPUProfilerState.FrameIdx = 0;
+    ResetStats();
+}
+
+void GPUProfiler::Terminate()
+{
+    if (!GPUProfilerState.bEnabled) { return; }
+    for (GPUProfileFrame& Frame : GPUProfilerState.Frames)
+    {
+        glDeleteQueries(GPUPass_Count * 2, &Frame.Queries[0][0]);
+        Frame = GPUProfileFrame{};
+    }
+    GPUProfilerState.bEnabled = false;
+}
+
+void AddSample(GPUPassHistory& History, double SampleMs)
+{
+    History.SamplesMs[History.NextSample] = SampleMs;
+    History.NextSample = (History.NextSample + 1) % MaxGPUProfileSamples;
+    if (History.NumSamples < MaxGPUProfileSamples) { History.NumSamples++; }
+    History.LastMs = SampleMs;
+}
+
+// Non-blocking: false if the GPU hasn't got that far yet
+bool ReadFrame(GPUProfileFrame& Frame)
+{
+    GLint bAvailable = GL_FALSE;
+    glGetQueryObjectiv(Frame.LastQuery, GL_QUERY_RESULT_AVAILABLE, &bAvailable);
+    if (bAvailable != GL_TRUE) { return false; }
+
+    for (int PassIdx = 0; PassIdx < GPUPass_Count; PassIdx++)
+    {
+        if (!Frame.bIssued[PassIdx]) { continue; }
+        GLuint64 BeginNs = 0;
+        GLuint64 EndNs = 0;
+        glGetQueryObjectui64v(Frame.Queries[PassIdx][0], GL_QUERY_RESULT, &BeginNs);
+        glGetQueryObjectui64v(Frame.Queries[PassIdx][1], GL_QUERY_RESULT, &EndNs);
+        AddSample(GPUProfilerState.History[PassIdx], EndNs > BeginNs ? (double)(EndNs - BeginNs) / 1000000.0 : 0.0);
+    }
+    Frame.bPending = false;
+    GPUProfilerState.Stats.NumFramesRead++;
+    return true;
+}
+
+void GPUProfiler::BeginFrame()
+{
+    GPUProfilerState_t& State = GPUProfilerState;
+    if (!State.bEnabled) { return; }
+
+    // Oldest first, stop at the first one still in flight so samples stay in frame order
+    for (int AgeIdx = 1; AgeIdx <= GPUProfile_NumFrames; AgeIdx++)
+    {
+        GPUProfileFrame& Frame = State.Frames[(State.FrameIdx + AgeIdx) % GPUProfile_NumFrames];
+        if (Frame.bPending && !ReadFrame(Frame)) { break; }
+    }
+
+    State.FrameIdx = (State.FrameIdx + 1) % GPUProfile_NumFrames;
+    GPUProfileFrame& Frame = State.Frames[State.FrameIdx];
+    State.bRecording = !Frame.bPending;
+    if (!State.bRecording)
+    {
+        State.Stats.NumFramesSkipped++;
+        return;
+    }
+    for (bool& bIssued : Frame.bIssued) { bIssued = false; }
+    Frame.LastQuery = 0;
+}
+
+void GPUProfiler::EndFrame()
+{
+    GPUProfilerState_t& State = GPUProfilerState;
+    if (!State.bEnabled || !State.bRecording) { return; }
+    GPUProfileFrame& Frame = State.Frames[State.FrameIdx];
+    Frame.bPending = Frame.LastQuery != 0;
+    State.bRecording = false;
+}
+
+void GPUProfiler::Begin(GPUPass Pass)
+{
+    if (!GPUProfilerState.bRecording) { return; }
+    GPUProfileFrame& Frame = GPUProfilerState.Frames[GPUProfilerState.FrameIdx];
+    glQueryCounter(Frame.Queries[Pass][0], GL_TIMESTAMP);
+    Frame.bIssued[Pass] = false; // Until its End
+}
+
+void GPUProfiler::End(GPUPass Pass)
+{
+    if (!GPUProfilerState.bRecording) { return; }
+    GPUProfileFrame& Frame = GPUProfilerState.Frames[GPUProfilerState.FrameIdx];
+    glQueryCounter(Frame.Queries[Pass][1], GL_TIMESTAMP);
+    Frame.bIssued[Pass] = true;
+    Frame.LastQuery = Frame.Queries[Pass][1];
+}
+
+GPUPassStats GPUProfiler::GetPassStats(GPUPass Pass)
+{
+    const GPUPassHistory& History = GPUProfilerState.History[Pass];
+    GPUPassStats Result;
+    Result.Name = GPUPassNames[Pass];
+    Result.NumSamples = History.NumSamples;
+    Result.LastMs = History.LastMs;
+    if (History.NumSamples == 0) { return Result; }
+
+    double SortedMs[MaxGPUProfileSamples];
+    double TotalMs = 0.0;
+    for (int SampleIdx = 0; SampleIdx < History.NumSamples; SampleIdx++)
+    {
+        SortedMs[SampleIdx] = History.SamplesMs[SampleIdx];
+        TotalMs += History.SamplesMs[SampleIdx];
+    }
+    // Nearest rank: the smallest sample that at least 99% of the window is at or below
+    const int P99Idx = (History.NumSamples * 99 + 99) / 100 - 1;
+    std::nth_element(SortedMs, SortedMs + P99Idx, SortedMs + History.NumSamples);
+    Result.AvgMs = TotalMs / History.NumSamples;
+    Result.P99Ms = SortedMs[P99Idx];
+    return Result;
+}
+
+const GPUProfilerStats& GPUProfiler::GetStats()
+{
+    return GPUProfilerState.Stats;
+}
+
+void GPUProfiler::ResetStats()
+{
+    for (GPUPassHistory& History : GPUProfilerState.History)
+    {
+        History = GPUPassHistory{};
+    }
+    GPUProfilerState.Stats = {};
+}
+
+void GPUProfiler::LogStats()
+{
+    if (!GPUProfilerState.bEnabled) { return; }
+    LOGF("    GPU passes (%d frames read, %d skipped):\n", GPUProfilerState.Stats.NumFramesRead, GPUProfilerState.Stats.NumFramesSkipped);
+    LOGF("    %10s %8s %10s %10s %10s\n", "Pass", "Samples", "Avg ms", "p99 ms", "Last ms");
+    for (int PassIdx = 0; PassIdx < GPUPass_Count; PassIdx++)
+    {
+        const GPUPassStats PassStats = GetPassStats((GPUPass)PassIdx);
+        LOGF("    %10s %8d %10.3f %10.3f %10.3f\n", PassStats.Name, PassStats.NumSamples, PassStats.AvgMs, PassStats.P99Ms, PassStats.LastMs);
+    }
+}
+}
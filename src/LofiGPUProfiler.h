@@ -0,0 +1,64 @@
+#ifndef LOFIGPUPROFILER_H
+#define LOFIGPUPROFILER_H
+
+#include "Common.h"
+
+namespace Lofi
+{
+enum GPUPass : int
+{
+    GPUPass_Frame = 0, // Everything Graphics::Draw issues, clear to last draw
+    GPUPass_Uploads, // TextureStream PBO -> texture copies
+    GPUPass_World, // RenderQueue packets of Camera_World
+    GPUPass_Screen, // RenderQueue packets of Camera_Screen (sprites, HUD)
+    GPUPass_Count,
+};
+
+struct GPUPassStats
+{
+    const char* Name = nullptr;
+    int NumSamples = 0; // In the rolling window, at most MaxGPUProfileSamples
+    double LastMs = 0.0;
+    double AvgMs = 0.0;
+    double P99Ms = 0.0;
+};
+
+struct GPUProfilerStats
+{
+    int NumFramesRead = 0;
+    // Frames not profiled because their query slot still hadn't been read back, rather than waiting on the GPU
+    int NumFramesSkipped = 0;
+};
+
+// Query slots in flight; results are read GPUProfile_NumFrames - 1 frames late at the earliest
+constexpr int GPUProfile_NumFrames = 4;
+// Rolling window of the per-pass averages / p99
+constexpr int MaxGPUProfileSamples = 256;
+
+/*
+    Per-pass GPU times from GL_TIMESTAMP queries (glQueryCounter) at the start and end of every pass.
+        Timestamps rather than GL_TIME_ELAPSED so passes may nest (Frame contains all the others).
+    Every frame records into its own slot of a ring; BeginFrame only reads slots whose results are
+        already available, so nothing ever waits for the GPU. A pass that isn't begun in a frame
+        simply gets no sample for it.
+*/
+struct GPUProfiler
+{
+    static void Init();
+    static void Terminate();
+
+    // Reads back finished frames and starts recording the next one
+    static void BeginFrame();
+    static void EndFrame();
+    static void Begin(GPUPass Pass);
+    static void End(GPUPass Pass);
+
+    static GPUPassStats GetPassStats(GPUPass Pass);
+    static const GPUProfilerStats& GetStats();
+    // Clears every pass' rolling window, e.g. between benchmark steps
+    static void ResetStats();
+    static void LogStats();
+};
+}
+
+#endif // LOFIGPUPROFILER_H
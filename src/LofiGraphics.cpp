@@ -1,5 +1,26 @@
 #include "LofiGraphics.h"
 #include "Common.h"
+#include "LofiAllocTracker.h"
+#include "LofiCulling.h"
+#include "LofiDebugDraw.h"
+#include "LofiDynamicRing.h"
+#include "LofiEntities.h"
+#include "LofiFrameArena.h"
+#include "LofiGLState.h"
+#include "LofiGPUProfiler.h"
+#include "LofiMesh.h"
+#include "LofiProfiler.h"
+#include "LofiRenderQueue.h"
+#include "LofiShader.h"
+#include "LofiShaderCache.h"
+#include "LofiSimulation.h"
+#include "LofiSpriteBatch.h"
+#include "LofiTexture.h"
+#include "LofiTextureAtlas.h"
+#include "LofiTextureStream.h"
+
+#include <cmath>
+#include <cstring>
 
 namespace Lofi
 {
@@ -171,215 +192,327 @@ const GLuint TexCubeInds[] =
     22, 23, 21,
 };
 
-struct ShaderFileSource
+struct GraphicsState_t
 {
-    GLchar* Contents = nullptr;
+    MeshHandle tri_mesh = InvalidMesh;
+    MeshHandle cube_mesh = InvalidMesh;
+    MeshHandle texcube_mesh = InvalidMesh;
+    MeshHandle reftexcube_mesh = InvalidMesh;
+
+    StreamedTexture test_texture = InvalidStreamedTexture; // Placeholder until its upload lands
+
+    MeshHandle cubeinst_mesh = InvalidMesh;
+    int cubeinst_count = 0;
+    float cubeinst_extent = 1.0f;
+    // Transform + Render entities, culled every frame and only the visible ones streamed through the DynamicRing
+    Entity* cubeinst_entities = nullptr;
+    int cubeinst_visible_count = 0;
+
+    GLuint sprite_pipeline = 0;
+    GLuint white_texture = 0; // 1x1, untextured (solid color) sprites
+    int sprite_count = 0;
+    // Solid color sprites: the atlas' "white" region when an atlas is loaded so they batch with everything else
+    GLuint solid_sprite_texture = 0;
+    v4f solid_sprite_uv = { 0.0f, 0.0f, 1.0f, 1.0f };
+
+    GLuint offscreen_framebuffer = 0;
+    GLuint offscreen_color_renderbuffer = 0;
+    GLuint offscreen_depth_renderbuffer = 0;
+    int offscreen_width = 0;
+    int offscreen_height = 0;
+} GraphicsState;
 
-    operator GLchar* ()
-    {
-        return Contents;
-    }
-    GLchar** operator&()
-    {
-        return &Contents;
-    }
-    bool IsValid()
-    {
-        return nullptr != Contents;
+void Graphics::Init()
+{
+    PROFILE_SCOPE("Graphics::Init");
+    // Cameras + per-object models for MaxDrawPackets, with headroom for debug lines, MaxSprites
+    //     and the visible part of a 100k cubie grid
+    constexpr GLsizeiptr DynamicBytesPerFrame = 16 * 1024 * 1024;
+    DynamicRing::Init(DynamicBytesPerFrame);
+    RenderQueue::Init();
+    GPUProfiler::Init();
+
+    { // Init meshes
+        GraphicsState.tri_mesh = MeshRegistry::Create(VertexFormat::VxColor, TriangleVerts, ARRAY_SIZE(TriangleVerts));
+        GraphicsState.cube_mesh = MeshRegistry::Create(VertexFormat::VxColor, CubeVertices, ARRAY_SIZE(CubeVertices),
+            CubeInds, ARRAY_SIZE(CubeInds));
+        GraphicsState.reftexcube_mesh = MeshRegistry::Create(VertexFormat::VxTex, Reference_TexCubeVerts, ARRAY_SIZE(Reference_TexCubeVerts),
+            CubeInds, ARRAY_SIZE(CubeInds));
+        GraphicsState.texcube_mesh = MeshRegistry::Create(VertexFormat::VxTex, TexCubeVerts, ARRAY_SIZE(TexCubeVerts),
+            TexCubeInds, ARRAY_SIZE(TexCubeInds));
+
+        RenderQueue::AddModelStream(GraphicsState.tri_mesh);
+        RenderQueue::AddModelStream(GraphicsState.cube_mesh);
+        RenderQueue::AddModelStream(GraphicsState.reftexcube_mesh);
+        RenderQueue::AddModelStream(GraphicsState.texcube_mesh);
+
+        DebugDraw::Init();
+        SpriteBatch::Init();
     }
-    ShaderFileSource(const char* Filename)
-    {
-        GLchar* Result = nullptr;
 
-        FILE* ShaderFile = nullptr;
-        fopen_s(&ShaderFile, Filename, "rb");
-        if (ShaderFile)
+    { // Init pipelines, reloaded from src/glsl whenever their files change
+        PROFILE_SCOPE("Graphics::Init pipelines");
+        ShaderCache::Init("shadercache");
+        ShaderLibrary::Init("src/glsl");
+        ShaderLibrary::CreatePermutations("src/glsl/uber_v.glsl", "src/glsl/uber_f.glsl");
+        // Sprites expand a unit quad from per-instance rects, a layout of their own rather than an uber shader feature
+        struct PipelineDesc
+        {
+            GLuint* Program;
+            const char* VShaderFilename;
+            const char* FShaderFilename;
+        };
+        const PipelineDesc Pipelines[] = {
+            { &GraphicsState.sprite_pipeline, "src/glsl/sprite_v.glsl", "src/glsl/sprite_f.glsl" },
+        };
+        for (const PipelineDesc& Pipeline : Pipelines)
         {
-            fseek(ShaderFile, 0, SEEK_END);
-            size_t FileSize = ftell(ShaderFile);
-            fseek(ShaderFile, 0, SEEK_SET);
-
-            Result = new GLchar[FileSize + 1];
-            fread(Result, sizeof(GLchar), FileSize, ShaderFile);
-            Result[FileSize] = 0x00;
-            fclose(ShaderFile);
+            *Pipeline.Program = ShaderLibrary::CreateProgram(Pipeline.VShaderFilename, Pipeline.FShaderFilename);
+            ShaderLibrary::Watch(Pipeline.Program, Pipeline.VShaderFilename, Pipeline.FShaderFilename);
         }
-
-        if (Result) { Contents = Result; }
+        ShaderCache::LogStats();
     }
-    ~ShaderFileSource()
-    {
-        if (Contents) { delete[] Contents; }
+
+    { // Instanced cubies
+        GraphicsState.cubeinst_mesh = MeshRegistry::Create(VertexFormat::VxTex, TexCubeVerts, ARRAY_SIZE(TexCubeVerts),
+            TexCubeInds, ARRAY_SIZE(TexCubeInds));
+
+        // Per-instance: model matrix + face colors interleaved, written to the DynamicRing after culling
+        VertexAttribDesc InstanceAttribs[10] = {};
+        for (GLuint ColIdx = 0; ColIdx < 4; ColIdx++)
+        {
+            // mat4 attributes occupy 4 consecutive locations, one per column
+            InstanceAttribs[ColIdx] = { Attrib_InstModel + ColIdx, 4, GL_FLOAT, GL_FALSE,
+                (GLuint)(offsetof(cube_instance, model) + sizeof(v4f) * ColIdx) };
+        }
+        for (GLuint FaceIdx = 0; FaceIdx < 6; FaceIdx++)
+        {
+            InstanceAttribs[4 + FaceIdx] = { Attrib_InstFaceCol0 + FaceIdx, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+                (GLuint)(offsetof(cube_instance, face_colors) + sizeof(uint32_t) * FaceIdx) };
+        }
+        MeshRegistry::AddInstanceStream(GraphicsState.cubeinst_mesh, DynamicRing::GetBuffer(),
+            sizeof(cube_instance), InstanceAttribs, ARRAY_SIZE(InstanceAttribs));
     }
-};
 
-struct GraphicsState_t
-{
-    GLuint tri_vertex_buffer = 0;
-    GLuint tri_vertex_array = 0;
+    { // Stream test_texture: prebuilt BC7, then ETC2 where BPTC is missing, then lofi-cook'd RGB8 mips, then decode the source JPG
+        TextureStream::Init();
+        const char* TestTextureFiles[] = { "assets/feels.ktx2", "assets/feels.dds", "assets/feels_etc2.ktx2", "assets/feels.cooked.ktx2",
+            "assets/feels.jpg" };
+        GraphicsState.test_texture = TextureStream::Request(TestTextureFiles, ARRAY_SIZE(TestTextureFiles));
+    }
 
-    GLuint cube_vertex_buffer = 0;
-    GLuint cube_vertex_array = 0;
+    GraphicsState.white_texture = TextureLoader::CreateSolid(0xFFFFFFFF);
 
-    GLuint vxcolor_vertex_shader = 0;
-    GLuint vxcolor_fragment_shader = 0;
-    GLuint vxcolor_gfx_pipeline = 0;
-    GLint vxcolor_mvp_location = 0;
-    GLint vxcolor_vpos_location = 0;
-    GLint vxcolor_vcol_location = 0;
+    { // Sticker/UI atlas, built offline with tools/LofiAtlas
+        GraphicsState.solid_sprite_texture = GraphicsState.white_texture;
+        if (TextureAtlas::Load("assets/atlas/lofi_atlas.png", "assets/atlas/lofi_atlas.atlas"))
+        {
+            if (const AtlasRegion* WhiteRegion = TextureAtlas::GetRegion(TextureAtlas::FindRegion("white")))
+            {
+                GraphicsState.solid_sprite_texture = TextureAtlas::GetTexture();
+                GraphicsState.solid_sprite_uv = WhiteRegion->uv_rect;
+            }
+        }
+    }
 
-    GLuint texcube_vertex_buffer = 0;
-    GLuint texcube_vertex_array = 0;
+    TextureLoader::LogMemoryStats();
 
-    GLuint vxtex_vshader = 0;
-    GLuint vxtex_fshader = 0;
-    GLuint vxtex_pipeline = 0;
-    GLint vxtex_mvp_location = 0;
-    GLint vxtex_vpos_location = 0;
-    GLint vxtex_vuv_location = 0;
+    { // Global GL settings
+        glClearColor(0.2f, 0.1f, 0.2f, 1.0f);
 
-    GLuint reftexcube_vertex_buffer = 0;
-    GLuint reftexcube_vertex_array = 0;
+        // Depth testing:
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(GL_LESS); // default: GL_LESS
 
-    GLuint test_texture = 0;
-} GraphicsState;
+        // Face culling:
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_BACK);
+        glFrontFace(GL_CCW);
+    }
+}
 
-struct ImageState_t
+bool Graphics::InitOffscreenTarget(int Width, int Height)
 {
-    int Width = 0;
-    int Height = 0;
-    int nrChannels = 0;
-} ImageState;
+    GLenum Status = GL_FRAMEBUFFER_UNDEFINED;
+    if (GLState::HasDSA())
+    {
+        glCreateRenderbuffers(1, &GraphicsState.offscreen_color_renderbuffer);
+        glNamedRenderbufferStorage(GraphicsState.offscreen_color_renderbuffer, GL_RGBA8, Width, Height);
 
-void Graphics::Init()
-{
-    { // Init vertex buffers
-        { // Triangle
-            glGenBuffers(1, &GraphicsState.tri_vertex_buffer);
-            glBindBuffer(GL_ARRAY_BUFFER, GraphicsState.tri_vertex_buffer);
-            glBufferData(GL_ARRAY_BUFFER, sizeof(TriangleVerts), TriangleVerts, GL_STATIC_DRAW);
-
-            glGenVertexArrays(1, &GraphicsState.tri_vertex_array);
-            glBindVertexArray(GraphicsState.tri_vertex_array);
-        }
+        glCreateRenderbuffers(1, &GraphicsState.offscreen_depth_renderbuffer);
+        glNamedRenderbufferStorage(GraphicsState.offscreen_depth_renderbuffer, GL_DEPTH24_STENCIL8, Width, Height);
 
-        { // Cube
-            glGenBuffers(1, &GraphicsState.cube_vertex_buffer);
-            glBindBuffer(GL_ARRAY_BUFFER, GraphicsState.cube_vertex_buffer);
-            glBufferData(GL_ARRAY_BUFFER, sizeof(CubeVertices), CubeVertices, GL_STATIC_DRAW);
+        glCreateFramebuffers(1, &GraphicsState.offscreen_framebuffer);
+        const GLuint Framebuffer = GraphicsState.offscreen_framebuffer;
+        glNamedFramebufferRenderbuffer(Framebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, GraphicsState.offscreen_color_renderbuffer);
+        glNamedFramebufferRenderbuffer(Framebuffer, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, GraphicsState.offscreen_depth_renderbuffer);
+        Status = glCheckNamedFramebufferStatus(Framebuffer, GL_FRAMEBUFFER);
 
-            glGenVertexArrays(1, &GraphicsState.cube_vertex_array);
-            glBindVertexArray(GraphicsState.cube_vertex_array);
-        }
+        glBindFramebuffer(GL_FRAMEBUFFER, Framebuffer);
     }
-
-    ShaderFileSource vxcolor_vshader_src{ "src/glsl/vxcolor_v.glsl" };
-    ShaderFileSource vxcolor_fshader_src{ "src/glsl/vxcolor_f.glsl" };
-    if (!(vxcolor_vshader_src.IsValid() && vxcolor_fshader_src.IsValid())) { return; }
     else
     {
-        GraphicsState.vxcolor_vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(GraphicsState.vxcolor_vertex_shader, 1, &vxcolor_vshader_src, nullptr);
-        glCompileShader(GraphicsState.vxcolor_vertex_shader);
-
-        GraphicsState.vxcolor_fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(GraphicsState.vxcolor_fragment_shader, 1, &vxcolor_fshader_src, nullptr);
-        glCompileShader(GraphicsState.vxcolor_fragment_shader);
-
-        GraphicsState.vxcolor_gfx_pipeline = glCreateProgram();
-        glAttachShader(GraphicsState.vxcolor_gfx_pipeline, GraphicsState.vxcolor_vertex_shader);
-        glAttachShader(GraphicsState.vxcolor_gfx_pipeline, GraphicsState.vxcolor_fragment_shader);
-        glLinkProgram(GraphicsState.vxcolor_gfx_pipeline);
-
-        GraphicsState.vxcolor_mvp_location = glGetUniformLocation(GraphicsState.vxcolor_gfx_pipeline, "MVP");
-        GraphicsState.vxcolor_vpos_location = glGetAttribLocation(GraphicsState.vxcolor_gfx_pipeline, "vPos");
-        GraphicsState.vxcolor_vcol_location = glGetAttribLocation(GraphicsState.vxcolor_gfx_pipeline, "vCol");
-
-        glEnableVertexAttribArray(GraphicsState.vxcolor_vpos_location);
-        glVertexAttribPointer(GraphicsState.vxcolor_vpos_location, 3, GL_FLOAT, GL_FALSE, sizeof(vxcolor), (void*)offsetof(vxcolor, pos));
-        glEnableVertexAttribArray(GraphicsState.vxcolor_vcol_location);
-        glVertexAttribPointer(GraphicsState.vxcolor_vcol_location, 3, GL_FLOAT, GL_FALSE, sizeof(vxcolor), (void*)offsetof(vxcolor, col));
+        glGenRenderbuffers(1, &GraphicsState.offscreen_color_renderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, GraphicsState.offscreen_color_renderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, Width, Height);
+
+        glGenRenderbuffers(1, &GraphicsState.offscreen_depth_renderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, GraphicsState.offscreen_depth_renderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, Width, Height);
+
+        glGenFramebuffers(1, &GraphicsState.offscreen_framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, GraphicsState.offscreen_framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, GraphicsState.offscreen_color_renderbuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, GraphicsState.offscreen_depth_renderbuffer);
+        Status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
     }
 
+    if (Status != GL_FRAMEBUFFER_COMPLETE)
     {
-        { // RefTexCube
-            glGenBuffers(1, &GraphicsState.reftexcube_vertex_buffer);
-            glBindBuffer(GL_ARRAY_BUFFER, GraphicsState.reftexcube_vertex_buffer);
-            glBufferData(GL_ARRAY_BUFFER, sizeof(Reference_TexCubeVerts), Reference_TexCubeVerts, GL_STATIC_DRAW);
+        LOGF("Offscreen framebuffer incomplete!\n");
+        return false;
+    }
 
-            glGenVertexArrays(1, &GraphicsState.reftexcube_vertex_array);
-            glBindVertexArray(GraphicsState.reftexcube_vertex_array);
-        }
+    // DEV_NOTE: Left bound for the lifetime of the app, every draw targets it
+    GraphicsState.offscreen_width = Width;
+    GraphicsState.offscreen_height = Height;
+    return true;
+}
 
-        { // TexCube
-            glGenBuffers(1, &GraphicsState.texcube_vertex_buffer);
-            glBindBuffer(GL_ARRAY_BUFFER, GraphicsState.texcube_vertex_buffer);
-            glBufferData(GL_ARRAY_BUFFER, sizeof(TexCubeVerts), TexCubeVerts, GL_STATIC_DRAW);
+uint32_t PackRGBA8(v3f Color)
+{
+    uint32_t R = (uint32_t)(Color.R * 255.0f);
+    uint32_t G = (uint32_t)(Color.G * 255.0f);
+    uint32_t B = (uint32_t)(Color.B * 255.0f);
+    // Little-endian: R in the lowest byte matches GL_UNSIGNED_BYTE x4 attribute layout
+    return R | (G << 8) | (B << 16) | (0xFFu << 24);
+}
 
-            glGenVertexArrays(1, &GraphicsState.texcube_vertex_array);
-            glBindVertexArray(GraphicsState.texcube_vertex_array);
-        }
+const v3f CubieFaceColors[] =
+{
+    { 0.0f, 0.6f, 0.3f }, // Front: green
+    { 0.0f, 0.3f, 0.8f }, // Back: blue
+    { 1.0f, 1.0f, 1.0f }, // Top: white
+    { 1.0f, 0.85f, 0.0f }, // Bottom: yellow
+    { 1.0f, 0.35f, 0.0f }, // Left: orange
+    { 0.8f, 0.0f, 0.0f }, // Right: red
+};
+
+void Graphics::SetCubeInstanceCount(int Count)
+{
+    if (Count < 0) { Count = 0; }
+    for (int InstIdx = 0; InstIdx < GraphicsState.cubeinst_count; InstIdx++)
+    {
+        Entities::Destroy(GraphicsState.cubeinst_entities[InstIdx]);
+    }
+    delete[] GraphicsState.cubeinst_entities;
+    GraphicsState.cubeinst_entities = nullptr;
+    GraphicsState.cubeinst_count = Count;
+    GraphicsState.cubeinst_visible_count = 0;
+    if (Count == 0) { return; }
+
+    // Lay cubies out in the smallest NxNxN grid that fits Count, centered on the origin
+    int GridDim = 1;
+    while (GridDim * GridDim * GridDim < Count) { GridDim++; }
+    const float fSpacing = fCubeUnit * 2.0f * 1.1f;
+    const float fHalfExtent = (GridDim - 1) * fSpacing * 0.5f;
+    GraphicsState.cubeinst_extent = GridDim * fSpacing;
+
+    render_component Render = {};
+    for (int FaceIdx = 0; FaceIdx < (int)ARRAY_SIZE(CubieFaceColors); FaceIdx++)
+    {
+        Render.face_colors[FaceIdx] = PackRGBA8(CubieFaceColors[FaceIdx]);
     }
+    Render.radius = fCubeUnit * 1.7320508f; // Half diagonal
 
-    ShaderFileSource vxtex_vshader_src{ "src/glsl/vxtex_v.glsl" };
-    ShaderFileSource vxtex_fshader_src{ "src/glsl/vxtex_f.glsl" };
-    if (!(vxtex_vshader_src.IsValid() && vxtex_fshader_src.IsValid())) { return; }
-    else
+    Entity* CubieEntities = new Entity[Count];
+    for (int InstIdx = 0; InstIdx < Count; InstIdx++)
     {
-        GraphicsState.vxtex_vshader = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(GraphicsState.vxtex_vshader, 1, &vxtex_vshader_src, nullptr);
-        glCompileShader(GraphicsState.vxtex_vshader);
-
-        GraphicsState.vxtex_fshader = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(GraphicsState.vxtex_fshader, 1, &vxtex_fshader_src, nullptr);
-        glCompileShader(GraphicsState.vxtex_fshader);
-
-        GraphicsState.vxtex_pipeline = glCreateProgram();
-        glAttachShader(GraphicsState.vxtex_pipeline, GraphicsState.vxtex_vshader);
-        glAttachShader(GraphicsState.vxtex_pipeline, GraphicsState.vxtex_fshader);
-        glLinkProgram(GraphicsState.vxtex_pipeline);
-
-        GraphicsState.vxtex_mvp_location = glGetUniformLocation(GraphicsState.vxtex_pipeline, "MVP");
-        GraphicsState.vxtex_vpos_location = glGetAttribLocation(GraphicsState.vxtex_pipeline, "vPos");
-        GraphicsState.vxtex_vuv_location = glGetAttribLocation(GraphicsState.vxtex_pipeline, "vUV");
-
-        glEnableVertexAttribArray(GraphicsState.vxtex_vpos_location);
-        glVertexAttribPointer(GraphicsState.vxtex_vpos_location, 3, GL_FLOAT, GL_FALSE, sizeof(vxtex), (void*)offsetof(vxtex, pos));
-        glEnableVertexAttribArray(GraphicsState.vxtex_vuv_location);
-        glVertexAttribPointer(GraphicsState.vxtex_vuv_location, 2, GL_FLOAT, GL_FALSE, sizeof(vxtex), (void*)offsetof(vxtex, uv));
+        const int X = InstIdx % GridDim;
+        const int Y = (InstIdx / GridDim) % GridDim;
+        const int Z = InstIdx / (GridDim * GridDim);
+        const Entity Cubie = Entities::Create(Component_Transform | Component_Render);
+        CubieEntities[InstIdx] = Cubie;
+        transform_component* Transform = (transform_component*)Entities::Get(Cubie, Component_Transform);
+        render_component* CubieRender = (render_component*)Entities::Get(Cubie, Component_Render);
+        if (!Transform || !CubieRender) { continue; }
+        Transform->position = v3f{ X * fSpacing - fHalfExtent, Y * fSpacing - fHalfExtent, Z * fSpacing - fHalfExtent };
+        Transform->scale = 1.0f;
+        *CubieRender = Render;
     }
+    GraphicsState.cubeinst_entities = CubieEntities;
+}
 
-    { // Load test_texture
-        unsigned char* TestTextureData = stbi_load("assets/feels.jpg", &ImageState.Width, &ImageState.Height, &ImageState.nrChannels, 0);
-        if (TestTextureData)
-        {
-            glGenTextures(1, &GraphicsState.test_texture);
-            glBindTexture(GL_TEXTURE_2D, GraphicsState.test_texture);
+int Graphics::GetVisibleCubeInstanceCount()
+{
+    return GraphicsState.cubeinst_visible_count;
+}
 
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+void Graphics::SetSpriteCount(int Count)
+{
+    GraphicsState.sprite_count = Count < 0 ? 0 : Count;
+}
 
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, ImageState.Width, ImageState.Height, 0, GL_RGB, GL_UNSIGNED_BYTE, TestTextureData);
-            glGenerateMipmap(GL_TEXTURE_2D);
+// Shared by the two cubie passes over the Transform + Render entities
+struct CubieGather
+{
+    float* bounds; // SoA bounding spheres in query order: count each of center x, y, z, radius
+    int count;
+    uint32_t* visible;
+    int num_visible;
+    cube_instance* instances; // num_visible, filled by the second pass
+    int first; // Query index of the current chunk's first entity
+    int next_visible; // Next entry of visible the second pass hasn't written
+};
 
-            stbi_image_free(TestTextureData);
-        }
+void GatherCubieBounds(const EntityChunk& Chunk, void* Context)
+{
+    CubieGather& Gather = *(CubieGather*)Context;
+    const transform_component* Transforms = GetChunkComponents<transform_component>(Chunk, Component_Transform);
+    const render_component* Renders = GetChunkComponents<render_component>(Chunk, Component_Render);
+    float* CenterX = Gather.bounds + Gather.first;
+    float* CenterY = CenterX + Gather.count;
+    float* CenterZ = CenterY + Gather.count;
+    float* Radius = CenterZ + Gather.count;
+    for (int Row = 0; Row < Chunk.count; Row++)
+    {
+        CenterX[Row] = Transforms[Row].position.X;
+        CenterY[Row] = Transforms[Row].position.Y;
+        CenterZ[Row] = Transforms[Row].position.Z;
+        Radius[Row] = Renders[Row].radius * Transforms[Row].scale;
     }
+    Gather.first += Chunk.count;
+}
 
-    { // Global GL settings
-        glClearColor(0.2f, 0.1f, 0.2f, 1.0f);
-
-        // Depth testing:
-        glEnable(GL_DEPTH_TEST);
-        glDepthFunc(GL_LESS); // default: GL_LESS
+// Translate * rotate around +Y * uniform scale, built directly
+m4f GetTransformMatrix(const transform_component& Transform)
+{
+    const float Cos = HMM_CosF(Transform.yaw) * Transform.scale;
+    const float Sin = HMM_SinF(Transform.yaw) * Transform.scale;
+    m4f Result = HMM_M4D(1.0f);
+    Result.Columns[0] = v4f{ Cos, 0.0f, -Sin, 0.0f };
+    Result.Columns[1] = v4f{ 0.0f, Transform.scale, 0.0f, 0.0f };
+    Result.Columns[2] = v4f{ Sin, 0.0f, Cos, 0.0f };
+    Result.Columns[3] = v4f{ Transform.position.X, Transform.position.Y, Transform.position.Z, 1.0f };
+    return Result;
+}
 
-        // Face culling:
-        glEnable(GL_CULL_FACE);
-        glCullFace(GL_BACK);
-        glFrontFace(GL_CCW);
+// Visible indices are in increasing order, each chunk writes the run that falls inside it
+void WriteCubieInstances(const EntityChunk& Chunk, void* Context)
+{
+    CubieGather& Gather = *(CubieGather*)Context;
+    const transform_component* Transforms = GetChunkComponents<transform_component>(Chunk, Component_Transform);
+    const render_component* Renders = GetChunkComponents<render_component>(Chunk, Component_Render);
+    const uint32_t End = (uint32_t)(Gather.first + Chunk.count);
+    while (Gather.next_visible < Gather.num_visible && Gather.visible[Gather.next_visible] < End)
+    {
+        const int Row = (int)Gather.visible[Gather.next_visible] - Gather.first;
+        cube_instance& Instance = Gather.instances[Gather.next_visible];
+        Instance.model = GetTransformMatrix(Transforms[Row]);
+        memcpy(Instance.face_colors, Renders[Row].face_colors, sizeof(Instance.face_colors));
+        Gather.next_visible++;
     }
+    Gather.first += Chunk.count;
 }
 
 float GetAspectRatio(float Width, float Height)
@@ -392,12 +525,45 @@ float GetAspectRatio(float Width, float Height)
     return Result;
 }
 
-void Graphics::Draw(GLFWwindow* InWindow)
+// View depth of the model's origin as a fraction of the far plane, for front-to-back sorting
+float GetPacketDepth(const m4f& MVP, float FarPlane)
+{
+    const v4f ClipOrigin = MVP.Columns[3];
+    return FarPlane > 0.0f ? ClipOrigin.W / FarPlane : 0.0f;
+}
+
+void Graphics::Draw(GLFWwindow* InWindow, const SimState& State)
 {
     if (!InWindow) { return; }
+    PROFILE_SCOPE("Graphics::Draw");
+    ALLOC_SCOPE("Graphics");
+
+    GLState::BeginFrame();
+    GPUProfiler::BeginFrame();
+    GPUProfiler::Begin(GPUPass_Frame);
+    ShaderLibrary::Update();
+    DynamicRing::BeginFrame();
+    {
+        PROFILE_SCOPE("TextureStream::Update");
+        ALLOC_SCOPE("TextureStream");
+        GPUProfiler::Begin(GPUPass_Uploads);
+        TextureStream::Update();
+        GPUProfiler::End(GPUPass_Uploads);
+    }
 
+    const GLuint TestTexture = TextureStream::GetTexture(GraphicsState.test_texture);
+
+    const bool bOffscreen = GraphicsState.offscreen_framebuffer != 0;
     int Width = 0.0f, Height = 0.0f;
-    glfwGetFramebufferSize(InWindow, &Width, &Height);
+    if (bOffscreen)
+    {
+        Width = GraphicsState.offscreen_width;
+        Height = GraphicsState.offscreen_height;
+    }
+    else
+    {
+        glfwGetFramebufferSize(InWindow, &Width, &Height);
+    }
     float AspectRatio = GetAspectRatio(Width, Height);
 
     glViewport(0, 0, Width, Height);
@@ -408,63 +574,187 @@ void Graphics::Draw(GLFWwindow* InWindow)
     // HMM_Mat4 HMM_LookAt_RH(HMM_Vec3 Eye, HMM_Vec3 Center, HMM_Vec3 Up)
     const HMM_Vec3 GlobalUp{ 0.f, 1.f, 0.f };
     const HMM_Vec3 Origin{ 0.f, 0.f, 0.f };
-    const float fCamDist = 2.5;
+    const bool bUseInstancing = GraphicsState.cubeinst_count > 0 &&
+        GetPermutation<ShaderFeature_Texture | ShaderFeature_Instancing | ShaderFeature_Fog>();
+    // Pull the camera back far enough to frame the whole instance grid
+    const float fCamDist = bUseInstancing ? 2.5f * GraphicsState.cubeinst_extent : 2.5f;
     const float fFOVDegrees = 45.0f;
-    const float CurrTime = (float)glfwGetTime();
-    const HMM_Vec3 CameraPos{ fCamDist * HMM_CosF(CurrTime), fCamDist, -fCamDist * HMM_SinF(CurrTime) };
-    HMM_Mat4 mvp_persp_proj = HMM_Perspective_RH_NO(fFOVDegrees, AspectRatio, 0.1f, 1000.0f);
+    const float CurrTime = (float)State.time;
+    const HMM_Vec3 CameraPos{ fCamDist * HMM_CosF(State.camera_angle), fCamDist, -fCamDist * HMM_SinF(State.camera_angle) };
+    const float fFarPlane = 1000.0f;
+    HMM_Mat4 mvp_persp_proj = HMM_Perspective_RH_NO(fFOVDegrees, AspectRatio, 0.1f, fFarPlane);
     HMM_Mat4 mvp_persp_view = HMM_LookAt_RH(CameraPos, Origin, GlobalUp);
     HMM_Mat4 mvp_persp = mvp_persp_proj * mvp_persp_view;
 
-    const GLfloat* mvp = (const GLfloat*)&mvp_persp;
-    static bool bUseOrtho = false;
-    if (bUseOrtho) { mvp = (const GLfloat*)&mvp_ortho; }
+    // Fades into the clear color, thin enough that only the far side of the scene picks it up
+    const v4f WorldFog{ 0.2f, 0.1f, 0.2f, 0.4f / fCamDist };
+    frame_uniforms WorldCamera{ mvp_persp_view, mvp_persp_proj, v4f{ CurrTime, 0.0f, 0.0f, 0.0f }, WorldFog };
+    frame_uniforms ScreenCamera{ HMM_M4D(1.0f), mvp_ortho, v4f{ CurrTime, 0.0f, 0.0f, 0.0f }, v4f{} };
+    RenderQueue::SetCamera(Camera_World, WorldCamera);
+    RenderQueue::SetCamera(Camera_Screen, ScreenCamera);
 
-    if (bUseOrtho)
+    static bool bUseOrtho = false;
+    const m4f& mvp = bUseOrtho ? mvp_ortho : mvp_persp;
+
+    DrawPacket Packet;
+    Packet.camera = bUseOrtho ? Camera_Screen : Camera_World;
+    Packet.model = HMM_M4D(1.0f);
+    Packet.depth = GetPacketDepth(mvp, fFarPlane);
+    bool bSubmitPacket = true;
+    if (bUseInstancing)
     {
-        glUseProgram(GraphicsState.vxcolor_gfx_pipeline);
-        glUniformMatrix4fv(GraphicsState.vxcolor_mvp_location, 1, GL_FALSE, mvp);
-
-        //glBindBuffer(GL_ARRAY_BUFFER, GraphicsState.tri_vertex_buffer);
-        glBindVertexArray(GraphicsState.tri_vertex_array);
-        glDrawArrays(GL_TRIANGLES, 0, 3);
+        // Same query twice with nothing created or destroyed in between, so both passes see the entities in the same order
+        const ComponentMask CubieMask = Component_Transform | Component_Render;
+        const int Count = Entities::CountMatching(CubieMask);
+        PROFILE_SCOPE("Cull cubies");
+        CubieGather Gather = {};
+        Gather.bounds = FrameArena::AllocArray<float>(Count * 4);
+        Gather.count = Count;
+        Entities::ForEachChunk(CubieMask, GatherCubieBounds, &Gather);
+        const float* Bounds = Gather.bounds;
+        const BoundingSpheres CubieBounds{ Bounds, Bounds + Count, Bounds + Count * 2, Bounds + Count * 3 };
+        Gather.visible = FrameArena::AllocArray<uint32_t>(Count);
+        Gather.num_visible = Culling::CullSpheres(Culling::ExtractFrustum(mvp), CubieBounds, Count, Gather.visible);
+        const int NumVisible = Gather.num_visible;
+        GraphicsState.cubeinst_visible_count = NumVisible;
+
+        // Aligned to the instance size so the ring offset is a whole base instance
+        DynamicAlloc InstanceAlloc;
+        if (NumVisible > 0) { InstanceAlloc = DynamicRing::Alloc(sizeof(cube_instance) * NumVisible, sizeof(cube_instance)); }
+        if (InstanceAlloc.IsValid())
+        {
+            Gather.instances = (cube_instance*)InstanceAlloc.ptr;
+            Gather.first = 0;
+            Entities::ForEachChunk(CubieMask, WriteCubieInstances, &Gather);
+
+            Packet.program = GetPermutation<ShaderFeature_Texture | ShaderFeature_Instancing | ShaderFeature_Fog>();
+            Packet.texture = TestTexture;
+            Packet.mesh = GraphicsState.cubeinst_mesh;
+            Packet.num_instances = NumVisible;
+            Packet.base_instance = (GLuint)(InstanceAlloc.offset / sizeof(cube_instance));
+        }
+        else
+        {
+            if (NumVisible > 0) { LOGF("Graphics: dynamic ring full, %d cubies dropped!\n", NumVisible); }
+            bSubmitPacket = false;
+        }
+    }
+    else if (bUseOrtho)
+    {
+        Packet.program = GetPermutation<ShaderFeature_VertexColor>();
+        Packet.mesh = GraphicsState.tri_mesh;
+
+        // HUD: panel along the top edge with an icon on top of it
+        SpriteBatch::Draw(GraphicsState.solid_sprite_texture, v2f{ -AspectRatio, 0.85f }, v2f{ 2.0f * AspectRatio, 0.15f },
+            GraphicsState.solid_sprite_uv, PackRGBA8(Color_DarkGray), 0);
+        SpriteBatch::Draw(TestTexture, v2f{ -AspectRatio + 0.025f, 0.875f }, v2f{ 0.1f, 0.1f },
+            v4f{ 0.0f, 0.0f, 1.0f, 1.0f }, 0xFFFFFFFF, 1);
     }
     else
     {
         const bool bUseTexCube = true;
         if (bUseTexCube)
         {
-            glUseProgram(GraphicsState.vxtex_pipeline);
-            glUniformMatrix4fv(GraphicsState.vxtex_mvp_location, 1, GL_FALSE, mvp);
-
-            glBindTexture(GL_TEXTURE_2D, GraphicsState.test_texture);
             const bool bUseReference = false;
-            if (bUseReference)
+            Packet.program = GetPermutation<ShaderFeature_Texture | ShaderFeature_Fog>();
+            Packet.texture = TestTexture;
+            Packet.mesh = bUseReference ? GraphicsState.reftexcube_mesh : GraphicsState.texcube_mesh;
+        }
+        else
+        {
+            Packet.program = GetPermutation<ShaderFeature_VertexColor | ShaderFeature_Fog>();
+            Packet.mesh = GraphicsState.cube_mesh;
+        }
+    }
+    if (bSubmitPacket) { RenderQueue::Submit(Packet); }
+
+    static bool bDrawDebug = LOFI_DEBUG_DRAW;
+    if (bDrawDebug)
+    {
+        // World axes, plus the bounds of whatever cube(s) are being drawn
+        DebugAxes(HMM_M4D(1.0f), 1.0f);
+        // Pushed out slightly so the edges don't z-fight with the cube faces
+        const float fBoundsHalfExtent = (bUseInstancing ? GraphicsState.cubeinst_extent * 0.5f : fCubeUnit) * 1.01f;
+        DebugBox(v3f{ -fBoundsHalfExtent, -fBoundsHalfExtent, -fBoundsHalfExtent },
+            v3f{ fBoundsHalfExtent, fBoundsHalfExtent, fBoundsHalfExtent }, Color_LightGray);
+    }
+    DebugDraw::Flush(GetPermutation<ShaderFeature_VertexColor>());
+
+    if (GraphicsState.sprite_count > 0)
+    {
+        // Deterministic scatter drifting across the screen, textured and solid sprites interleaved so that
+        //     without an atlas the batcher has to sort them, with one they all share a single batch
+        const float fSpriteSize = 0.02f;
+        const int NumAtlasRegions = TextureAtlas::GetNumRegions();
+        for (int SpriteIdx = 0; SpriteIdx < GraphicsState.sprite_count; SpriteIdx++)
+        {
+            const float fU = fmodf(SpriteIdx * 0.6180339887f + State.sprite_scroll, 1.0f);
+            const float fV = fmodf(SpriteIdx * 0.7548776662f, 1.0f);
+            const v2f Pos{ (fU * 2.0f - 1.0f) * AspectRatio, fV * 2.0f - 1.0f };
+            const v2f Size{ fSpriteSize, fSpriteSize };
+            if ((SpriteIdx & 1) == 0)
+            {
+                SpriteBatch::Draw(GraphicsState.solid_sprite_texture, Pos, Size, GraphicsState.solid_sprite_uv,
+                    PackRGBA8(CubieFaceColors[SpriteIdx % ARRAY_SIZE(CubieFaceColors)]), SpriteIdx & 0xFF);
+            }
+            else if (NumAtlasRegions > 0)
             {
-                glBindVertexBuffer(GL_ARRAY_BUFFER, GraphicsState.texcube_vertex_buffer, 0, sizeof(vxtex));
-                glBindVertexArray(GraphicsState.reftexcube_vertex_array);
-                glDrawElements(GL_TRIANGLES, ARRAY_SIZE(CubeInds), GL_UNSIGNED_INT, CubeInds);
+                const AtlasRegion* Region = TextureAtlas::GetRegion((SpriteIdx / 2) % NumAtlasRegions);
+                SpriteBatch::Draw(TextureAtlas::GetTexture(), Pos, Size, Region->uv_rect, 0xFFFFFFFF, SpriteIdx & 0xFF);
             }
             else
             {
-                glBindVertexArray(GraphicsState.texcube_vertex_array);
-                glDrawElements(GL_TRIANGLES, ARRAY_SIZE(TexCubeInds), GL_UNSIGNED_INT, TexCubeInds);
+                SpriteBatch::Draw(TestTexture, Pos, Size, v4f{ 0.0f, 0.0f, 1.0f, 1.0f }, 0xFFFFFFFF, SpriteIdx & 0xFF);
             }
         }
-        else
-        {
-            glUseProgram(GraphicsState.vxcolor_gfx_pipeline);
-            glUniformMatrix4fv(GraphicsState.vxcolor_mvp_location, 1, GL_FALSE, mvp);
+    }
+    SpriteBatch::Flush(GraphicsState.sprite_pipeline);
 
-            glBindVertexArray(GraphicsState.cube_vertex_array);
-            glDrawElements(GL_TRIANGLES, ARRAY_SIZE(CubeInds), GL_UNSIGNED_INT, CubeInds);
-        }
+    {
+        PROFILE_SCOPE("RenderQueue::Execute");
+        ALLOC_SCOPE("RenderQueue");
+        RenderQueue::Execute();
     }
+    GPUProfiler::End(GPUPass_Frame);
+    GPUProfiler::EndFrame();
+    DynamicRing::EndFrame();
 
-    glfwSwapBuffers(InWindow);
+    if (!bOffscreen)
+    {
+        PROFILE_SCOPE("glfwSwapBuffers");
+        ALLOC_EXEMPT_SCOPE("Platform");
+        glfwSwapBuffers(InWindow);
+    }
 }
 
 void Graphics::Terminate()
 {
+    ShaderLibrary::Terminate();
+    // Programs we watch are still ours to delete, ShaderLibrary only swaps them on reload
+    if (GraphicsState.sprite_pipeline)
+    {
+        GLState::ForgetProgram(GraphicsState.sprite_pipeline);
+        glDeleteProgram(GraphicsState.sprite_pipeline);
+        GraphicsState.sprite_pipeline = 0;
+    }
+    GPUProfiler::Terminate();
+    MeshRegistry::Terminate();
+    DynamicRing::Terminate();
+    TextureAtlas::Terminate();
+    TextureLoader::Delete(GraphicsState.white_texture);
+    TextureStream::Terminate();
+    GraphicsState.test_texture = InvalidStreamedTexture;
+    SetCubeInstanceCount(0);
+
+    if (GraphicsState.offscreen_framebuffer)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &GraphicsState.offscreen_framebuffer);
+        glDeleteRenderbuffers(1, &GraphicsState.offscreen_color_renderbuffer);
+        glDeleteRenderbuffers(1, &GraphicsState.offscreen_depth_renderbuffer);
+        GraphicsState.offscreen_framebuffer = 0;
+        GraphicsState.offscreen_color_renderbuffer = 0;
+        GraphicsState.offscreen_depth_renderbuffer = 0;
+    }
 }
 }
\ No newline at end of file
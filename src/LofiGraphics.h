@@ -22,10 +22,56 @@ struct vxtex
     v2f uv;
 };
 
+// Fixed vertex attribute locations, bound by name before every program link so
+//     a mesh's VAO works with any program that consumes its vertex format
+enum VertexAttrib : GLuint
+{
+    Attrib_Pos = 0,
+    Attrib_Col = 1,
+    Attrib_UV = 2,
+    Attrib_InstModel = 3, // mat4: 3..6
+    Attrib_InstFaceCol0 = 7, // 6x vec4: 7..12
+    // Sprite instances alias the face color slots, no program consumes both
+    Attrib_InstSpriteRect = 7,
+    Attrib_InstSpriteUVRect = 8,
+    Attrib_InstSpriteColor = 9,
+    Attrib_InstSpriteDepth = 10,
+    Attrib_Count = 13,
+};
+
+// Uniform block binding point of FrameUniforms, shared by every program
+constexpr GLuint FrameUniformsBinding = 0;
+
+// std140 mirror of the FrameUniforms block
+struct frame_uniforms
+{
+    m4f view;
+    m4f proj;
+    v4f time; // x: seconds since init
+    v4f fog; // rgb: color, a: density (0: off)
+};
+
+struct cube_instance
+{
+    m4f model;
+    uint32_t face_colors[6]; // RGBA8 per face: Front, Back, Top, Bottom, Left, Right
+};
+
+struct SimState;
+
 struct Graphics
 {
     static void Init();
-    static void Draw(GLFWwindow* InWindow);
+    // Headless: render into an FBO instead of the window's default framebuffer
+    static bool InitOffscreenTarget(int Width, int Height);
+    // Instanced cubies laid out in a grid, drawn with a single call; 0 draws the single tex cube
+    static void SetCubeInstanceCount(int Count);
+    // Cubies that survived frustum culling last frame
+    static int GetVisibleCubeInstanceCount();
+    // Benchmark sprites scattered over the screen every frame, 0 disables them
+    static void SetSpriteCount(int Count);
+    // Renders State, normally Simulation::Interpolate between the last two fixed steps
+    static void Draw(GLFWwindow* InWindow, const SimState& State);
     static void Terminate();
 };
 }
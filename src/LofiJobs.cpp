@@ -0,0 +1,393 @@
+#include "LofiJobs.h"
+#include "LofiAllocTracker.h"
+#include "LofiProfiler.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+namespace Lofi
+{
+constexpr int MaxJobThreads = 64; // Workers plus the outside threads that create jobs
+constexpr int JobIdleSpins = 64; // Failed steal rounds before a worker goes to sleep
+constexpr int ParallelForBatchesPerThread = 4;
+
+struct Job
+{
+    JobFunction Function;
+    Job* Parent;
+    alignas(16) uint8_t Data[JobDataSize];
+    std::atomic<int32_t> NumUnfinished{ 0 }; // Itself plus its unfinished children, 0 once its slot is free
+};
+
+/*
+    Chase-Lev deque on a fixed ring, memory orders as in "Correct and Efficient Work-Stealing for
+        Weak Memory Models" (Le et al. 2013). Only the owner touches Bottom's end.
+*/
+struct JobDeque
+{
+    std::atomic<int64_t> Top{ 0 };
+    char TopPadding[64 - sizeof(std::atomic<int64_t>)]; // Thieves hammer Top, keep it off the owner's line
+    std::atomic<int64_t> Bottom{ 0 };
+    std::atomic<Job*> Entries[JobQueueSize];
+};
+
+struct JobThreadContext
+{
+    JobDeque Queue;
+    Job Pool[JobQueueSize];
+    uint32_t NextPoolIdx = 0;
+    uint32_t RandomSeed = 1;
+    JobThreadContext* NextAllocated = nullptr;
+};
+
+struct JobThreadLocal_t
+{
+    JobThreadContext* Context = nullptr;
+    uint32_t Generation = 0;
+};
+thread_local JobThreadLocal_t JobThreadLocal;
+
+struct JobsState_t
+{
+    std::thread Workers[MaxJobWorkers];
+    int NumWorkers = 0;
+    std::atomic<bool> bRunning{ false };
+
+    std::mutex ContextsMutex; // Registration and Terminate, stealing never takes it
+    JobThreadContext* Contexts[MaxJobThreads] = {};
+    std::atomic<int> NumContexts{ 0 };
+    JobThreadContext* AllocatedContexts = nullptr;
+    std::atomic<uint32_t> Generation{ 1 }; // Bumped by Terminate, every thread registers again
+
+    // Idle workers sleep until Run bumps WakeCount
+    std::mutex SleepMutex;
+    std::condition_variable SleepCondition;
+    std::atomic<uint32_t> WakeCount{ 0 };
+    std::atomic<int> NumSleeping{ 0 };
+} JobsState;
+
+JobThreadContext* GetThreadContext()
+{
+    JobsState_t& State = JobsState;
+    JobThreadLocal_t& Local = JobThreadLocal;
+    const uint32_t Generation = State.Generation.load(std::memory_order_acquire);
+    if (Local.Context && Local.Generation == Generation) { return Local.Context; }
+
+    JobThreadContext* Context = new JobThreadContext;
+    {
+        std::lock_guard<std::mutex> Lock(State.ContextsMutex);
+        Context->NextAllocated = State.AllocatedContexts;
+        State.AllocatedContexts = Context;
+        const int ContextIdx = State.NumContexts.load(std::memory_order_relaxed);
+        Context->RandomSeed = (uint32_t)ContextIdx * 2654435761u + 1u;
+        if (ContextIdx < MaxJobThreads)
+        {
+            State.Contexts[ContextIdx] = Context;
+            State.NumContexts.store(ContextIdx + 1, std::memory_order_release);
+        }
+        else { LOGF("Jobs: thread limit reached, this thread's jobs can't be stolen\n"); }
+    }
+    Local.Context = Context;
+    Local.Generation = Generation;
+    return Context;
+}
+
+bool PushJob(JobDeque& Queue, Job* InJob)
+{
+    const int64_t Bottom = Queue.Bottom.load(std::memory_order_relaxed);
+    const int64_t Top = Queue.Top.load(std::memory_order_acquire);
+    if (Bottom - Top >= JobQueueSize) { return false; }
+    Queue.Entries[Bottom & (JobQueueSize - 1)].store(InJob, std::memory_order_relaxed);
+    // Release: a thief that sees the new Bottom sees the job's contents too
+    Queue.Bottom.store(Bottom + 1, std::memory_order_release);
+    return true;
+}
+
+// Owner only, newest first
+Job* PopJob(JobDeque& Queue)
+{
+    const int64_t Bottom = Queue.Bottom.load(std::memory_order_relaxed) - 1;
+    Queue.Bottom.store(Bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t Top = Queue.Top.load(std::memory_order_relaxed);
+    if (Top > Bottom)
+    {
+        Queue.Bottom.store(Bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* Result = Queue.Entries[Bottom & (JobQueueSize - 1)].load(std::memory_order_relaxed);
+    if (Top == Bottom)
+    {
+        // The last one, thieves may be after it as well
+        if (!Queue.Top.compare_exchange_strong(Top, Top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            Result = nullptr;
+        }
+        Queue.Bottom.store(Bottom + 1, std::memory_order_relaxed);
+    }
+    return Result;
+}
+
+// Any thread, oldest first; nullptr when empty or another thread got there first
+Job* StealJob(JobDeque& Queue)
+{
+    int64_t Top = Queue.Top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t Bottom = Queue.Bottom.load(std::memory_order_acquire);
+    if (Top >= Bottom) { return nullptr; }
+
+    Job* Result = Queue.Entries[Top & (JobQueueSize - 1)].load(std::memory_order_relaxed);
+    if (!Queue.Top.compare_exchange_strong(Top, Top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+        return nullptr;
+    }
+    return Result;
+}
+
+// Own deque first, then one pass over everyone else's starting from a random victim
+Job* FindJob(JobThreadContext& Context)
+{
+    Job* Result = PopJob(Context.Queue);
+    if (Result) { return Result; }
+
+    const int NumContexts = JobsState.NumContexts.load(std::memory_order_acquire);
+    if (NumContexts == 0) { return nullptr; }
+    Context.RandomSeed = Context.RandomSeed * 1664525u + 1013904223u;
+    const int FirstVictim = (int)((Context.RandomSeed >> 8) % (uint32_t)NumContexts);
+    for (int VictimOffset = 0; VictimOffset < NumContexts; VictimOffset++)
+    {
+        JobThreadContext* Victim = JobsState.Contexts[(FirstVictim + VictimOffset) % NumContexts];
+        if (Victim == &Context) { continue; }
+        Result = StealJob(Victim->Queue);
+        if (Result) { return Result; }
+    }
+    return nullptr;
+}
+
+void FinishJob(Job* InJob)
+{
+    // Read before finishing, the slot may be handed out again right after
+    Job* Parent = InJob->Parent;
+    if (InJob->NumUnfinished.fetch_sub(1, std::memory_order_acq_rel) == 1 && Parent)
+    {
+        FinishJob(Parent);
+    }
+}
+
+void ExecuteJob(Job* InJob)
+{
+    InJob->Function(InJob, InJob->Data);
+    FinishJob(InJob);
+}
+
+void JobWorker(int WorkerIdx)
+{
+    char ThreadName[32];
+    snprintf(ThreadName, sizeof(ThreadName), "Job worker %d", WorkerIdx);
+    Profiler::SetThreadName(ThreadName);
+
+    JobsState_t& State = JobsState;
+    JobThreadContext* Context = GetThreadContext();
+    int NumIdleSpins = 0;
+    while (State.bRunning.load(std::memory_order_acquire))
+    {
+        Job* Next = FindJob(*Context);
+        if (!Next && ++NumIdleSpins < JobIdleSpins)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        if (!Next)
+        {
+            // WakeCount is read before the last look, a Run landing after it can't be slept through.
+            // DEV_NOTE: A missed wake-up would only cost parallelism, Wait always runs jobs itself.
+            const uint32_t SeenWakeCount = State.WakeCount.load(std::memory_order_seq_cst);
+            State.NumSleeping.fetch_add(1, std::memory_order_seq_cst);
+            Next = FindJob(*Context);
+            if (!Next)
+            {
+                std::unique_lock<std::mutex> Lock(State.SleepMutex);
+                State.SleepCondition.wait(Lock, [&State, SeenWakeCount]
+                {
+                    return State.WakeCount.load(std::memory_order_seq_cst) != SeenWakeCount || !State.bRunning.load(std::memory_order_acquire);
+                });
+            }
+            State.NumSleeping.fetch_sub(1, std::memory_order_seq_cst);
+        }
+        NumIdleSpins = 0;
+        if (Next) { ExecuteJob(Next); }
+    }
+}
+
+bool Jobs::Init(int NumThreads)
+{
+    JobsState_t& State = JobsState;
+    if (NumThreads <= 0) { NumThreads = (int)std::thread::hardware_concurrency(); }
+    State.NumWorkers = HMM_MIN(HMM_MAX(NumThreads - 1, 0), MaxJobWorkers);
+
+    // The calling thread takes the first slot
+    GetThreadContext();
+    State.bRunning.store(true, std::memory_order_release);
+    for (int WorkerIdx = 0; WorkerIdx < State.NumWorkers; WorkerIdx++)
+    {
+        State.Workers[WorkerIdx] = std::thread(JobWorker, WorkerIdx);
+    }
+    return true;
+}
+
+void Jobs::Terminate()
+{
+    // DEV_NOTE: Every job must be done (waited on) before this, and no other thread may use jobs meanwhile
+    JobsState_t& State = JobsState;
+    {
+        std::lock_guard<std::mutex> Lock(State.SleepMutex);
+        State.bRunning.store(false, std::memory_order_release);
+    }
+    State.SleepCondition.notify_all();
+    for (int WorkerIdx = 0; WorkerIdx < State.NumWorkers; WorkerIdx++)
+    {
+        State.Workers[WorkerIdx].join();
+    }
+    State.NumWorkers = 0;
+
+    std::lock_guard<std::mutex> Lock(State.ContextsMutex);
+    while (State.AllocatedContexts)
+    {
+        JobThreadContext* Context = State.AllocatedContexts;
+        State.AllocatedContexts = Context->NextAllocated;
+        delete Context;
+    }
+    for (JobThreadContext*& Context : State.Contexts) { Context = nullptr; }
+    State.NumContexts.store(0, std::memory_order_relaxed);
+    State.Generation.fetch_add(1, std::memory_order_release);
+}
+
+int Jobs::GetNumThreads()
+{
+    return JobsState.NumWorkers + 1;
+}
+
+Job* AllocateJob(Job* Parent, JobFunction Function, const void* Data, int DataSize)
+{
+    if (DataSize > JobDataSize)
+    {
+        LOGF("Jobs: %d bytes of job data, only %d fit\n", DataSize, JobDataSize);
+        return nullptr;
+    }
+    // Long-lived parents (a ParallelFor's root) hold their slots while the pool cycles around them
+    JobThreadContext* Context = GetThreadContext();
+    Job* Result = nullptr;
+    while (!Result)
+    {
+        for (int SlotOffset = 0; SlotOffset < JobQueueSize && !Result; SlotOffset++)
+        {
+            Job* Slot = &Context->Pool[Context->NextPoolIdx++ & (JobQueueSize - 1)];
+            if (Slot->NumUnfinished.load(std::memory_order_acquire) == 0) { Result = Slot; }
+        }
+        if (!Result)
+        {
+            // Every slot is taken, help finish some before trying again
+            Job* Next = FindJob(*Context);
+            if (Next) { ExecuteJob(Next); }
+            else { std::this_thread::yield(); }
+        }
+    }
+    Result->Function = Function;
+    Result->Parent = Parent;
+    Result->NumUnfinished.store(1, std::memory_order_relaxed);
+    if (Data && DataSize > 0) { memcpy(Result->Data, Data, DataSize); }
+    return Result;
+}
+
+Job* Jobs::Create(JobFunction Function, const void* Data, int DataSize)
+{
+    return AllocateJob(nullptr, Function, Data, DataSize);
+}
+
+Job* Jobs::CreateChild(Job* Parent, JobFunction Function, const void* Data, int DataSize)
+{
+    Job* Result = AllocateJob(Parent, Function, Data, DataSize);
+    if (Result) { Parent->NumUnfinished.fetch_add(1, std::memory_order_relaxed); }
+    return Result;
+}
+
+void Jobs::Run(Job* InJob)
+{
+    if (!InJob) { return; }
+    JobsState_t& State = JobsState;
+    JobThreadContext* Context = GetThreadContext();
+    if (!PushJob(Context->Queue, InJob))
+    {
+        ExecuteJob(InJob); // Deque full, nobody would get to it sooner than we do
+        return;
+    }
+
+    State.WakeCount.fetch_add(1, std::memory_order_seq_cst);
+    if (State.NumSleeping.load(std::memory_order_seq_cst) > 0)
+    {
+        std::lock_guard<std::mutex> Lock(State.SleepMutex);
+        State.SleepCondition.notify_one();
+    }
+}
+
+bool Jobs::IsDone(const Job* InJob)
+{
+    return InJob->NumUnfinished.load(std::memory_order_acquire) == 0;
+}
+
+void Jobs::Wait(const Job* InJob)
+{
+    if (!InJob) { return; }
+    JobThreadContext* Context = GetThreadContext();
+    while (!IsDone(InJob))
+    {
+        Job* Next = FindJob(*Context);
+        if (Next) { ExecuteJob(Next); }
+        else { std::this_thread::yield(); }
+    }
+}
+
+struct ParallelForRange
+{
+    ParallelForFunction Function;
+    void* Context;
+    int Begin;
+    int End;
+    int BatchSize;
+};
+
+void ParallelForJob(Job* InJob, const void* Data)
+{
+    const ParallelForRange& Range = *(const ParallelForRange*)Data;
+    if (Range.End - Range.Begin <= Range.BatchSize)
+    {
+        PROFILE_SCOPE("ParallelFor batch");
+        ALLOC_SCOPE("Jobs");
+        Range.Function(Range.Begin, Range.End, Range.Context);
+        return;
+    }
+
+    // Halves as children: the first one stays on this thread, the other is up for stealing
+    const int Middle = Range.Begin + (Range.End - Range.Begin) / 2;
+    ParallelForRange Halves[2] = { Range, Range };
+    Halves[0].End = Middle;
+    Halves[1].Begin = Middle;
+    Jobs::Run(Jobs::CreateChild(InJob, ParallelForJob, &Halves[1], sizeof(ParallelForRange)));
+    Jobs::Run(Jobs::CreateChild(InJob, ParallelForJob, &Halves[0], sizeof(ParallelForRange)));
+}
+
+void Jobs::ParallelFor(int Count, int BatchSize, ParallelForFunction Function, void* Context)
+{
+    if (Count <= 0) { return; }
+    if (BatchSize <= 0) { BatchSize = HMM_MAX(Count / (GetNumThreads() * ParallelForBatchesPerThread), 1); }
+
+    const ParallelForRange Range = { Function, Context, 0, Count, BatchSize };
+    Job* Root = Create(ParallelForJob, &Range, sizeof(Range));
+    Run(Root);
+    Wait(Root);
+}
+}
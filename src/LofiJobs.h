@@ -0,0 +1,52 @@
+#ifndef LOFIJOBS_H
+#define LOFIJOBS_H
+
+#include "Common.h"
+
+namespace Lofi
+{
+struct Job;
+typedef void (*JobFunction)(Job* InJob, const void* Data);
+// Handles the items in [Begin, End)
+typedef void (*ParallelForFunction)(int Begin, int End, void* Context);
+
+constexpr int MaxJobWorkers = 56;
+constexpr int JobDataSize = 96; // Bytes copied into every job for its function
+constexpr int JobQueueSize = 4096; // Per thread, power of two; also the most unfinished jobs one thread can have created
+
+/*
+    Work-stealing job system: every thread that creates jobs owns a Chase-Lev deque. It pushes and
+        pops its own jobs at the bottom (newest first, cache warm) while idle threads steal from the
+        top of the others (oldest first, usually the biggest pieces of work).
+    A job counts itself plus its unfinished children; it's done once that count reaches zero, and
+        finishing the last child finishes the parent. Wait runs other jobs until the one it waits
+        on is done, so waiting from inside a job doesn't tie up its thread.
+    Any thread may create, run and wait on jobs, the calling thread always helps out. Jobs are
+        created and must be Run on the same thread. A job's slot is recycled once it's done, so
+        keep a Job pointer only until waiting on it returns.
+*/
+struct Jobs
+{
+    // NumThreads counts the calling thread, 0 uses every hardware thread
+    static bool Init(int NumThreads = 0);
+    static void Terminate();
+    // Worker threads plus the calling thread
+    static int GetNumThreads();
+
+    // Data is copied into the job; nullptr when DataSize is over JobDataSize
+    static Job* Create(JobFunction Function, const void* Data = nullptr, int DataSize = 0);
+    // Parent isn't done until the child is; create children before the parent finishes
+    static Job* CreateChild(Job* Parent, JobFunction Function, const void* Data = nullptr, int DataSize = 0);
+    // Queues the job on the calling thread, an idle worker may steal it
+    static void Run(Job* InJob);
+    // Returns once the job and all its children are done
+    static void Wait(const Job* InJob);
+    static bool IsDone(const Job* InJob);
+
+    // Splits [0, Count) in halves until they're at most BatchSize items, runs them and waits.
+    //     BatchSize 0 picks one that gives every thread a few batches to balance with.
+    static void ParallelFor(int Count, int BatchSize, ParallelForFunction Function, void* Context);
+};
+}
+
+#endif // LOFIJOBS_H
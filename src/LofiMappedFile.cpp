@@ -0,0 +1,78 @@
+#include "LofiMappedFile.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Lofi
+{
+#if defined(_WIN32)
+bool MappedFile::Map(const char* Filename)
+{
+    Unmap();
+
+    HANDLE File = CreateFileA(Filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (File == INVALID_HANDLE_VALUE) { return false; }
+
+    LARGE_INTEGER FileSize = {};
+    if (!GetFileSizeEx(File, &FileSize) || FileSize.QuadPart == 0) { CloseHandle(File); return false; }
+
+    HANDLE Mapping = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!Mapping) { CloseHandle(File); return false; }
+
+    const void* View = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!View) { CloseHandle(Mapping); CloseHandle(File); return false; }
+
+    FileHandle = File;
+    MappingHandle = Mapping;
+    Data = (const unsigned char*)View;
+    Size = (size_t)FileSize.QuadPart;
+    return true;
+}
+
+void MappedFile::Unmap()
+{
+    if (Data) { UnmapViewOfFile(Data); }
+    if (MappingHandle) { CloseHandle((HANDLE)MappingHandle); }
+    if (FileHandle) { CloseHandle((HANDLE)FileHandle); }
+    Data = nullptr;
+    Size = 0;
+    FileHandle = nullptr;
+    MappingHandle = nullptr;
+}
+#else
+bool MappedFile::Map(const char* Filename)
+{
+    Unmap();
+
+    const int File = open(Filename, O_RDONLY);
+    if (File < 0) { return false; }
+
+    struct stat FileStat = {};
+    if (fstat(File, &FileStat) != 0 || FileStat.st_size == 0) { close(File); return false; }
+
+    void* View = mmap(nullptr, (size_t)FileStat.st_size, PROT_READ, MAP_PRIVATE, File, 0);
+    // The mapping keeps its own reference to the file
+    close(File);
+    if (View == MAP_FAILED) { return false; }
+
+    Data = (const unsigned char*)View;
+    Size = (size_t)FileStat.st_size;
+    return true;
+}
+
+void MappedFile::Unmap()
+{
+    if (Data) { munmap((void*)Data, Size); }
+    Data = nullptr;
+    Size = 0;
+}
+#endif
+}
@@ -0,0 +1,32 @@
+#ifndef LOFIMAPPEDFILE_H
+#define LOFIMAPPEDFILE_H
+
+#include <cstddef>
+
+namespace Lofi
+{
+// Read-only memory mapping of a whole file, unmapped on destruction
+// DEV_NOTE: Kept free of Common.h so windows.h never meets the GL headers
+struct MappedFile
+{
+    const unsigned char* Data = nullptr;
+    size_t Size = 0;
+
+    bool Map(const char* Filename);
+    void Unmap();
+    bool IsValid() const { return nullptr != Data; }
+
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { Unmap(); }
+
+private:
+#if defined(_WIN32)
+    void* FileHandle = nullptr;
+    void* MappingHandle = nullptr;
+#endif
+};
+}
+
+#endif // LOFIMAPPEDFILE_H
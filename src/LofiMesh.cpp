@@ -0,0 +1,307 @@
+#include "LofiMesh.h"
+#include "LofiAllocTracker.h"
+#include "LofiDynamicRing.h"
+#include "LofiGLState.h"
+
+#include <cstring>
+
+namespace Lofi
+{
+constexpr int MaxMeshes = 64;
+
+struct MeshRegistryState_t
+{
+    // Slot 0 is reserved so that InvalidMesh never aliases a real mesh
+    Mesh Meshes[MaxMeshes];
+    int NumMeshes = 1;
+} MeshRegistryState;
+
+const VertexAttribDesc VxColorAttribs[] =
+{
+    { Attrib_Pos, 3, GL_FLOAT, GL_FALSE, offsetof(vxcolor, pos) },
+    { Attrib_Col, 3, GL_FLOAT, GL_FALSE, offsetof(vxcolor, col) },
+};
+
+const VertexAttribDesc VxTexAttribs[] =
+{
+    { Attrib_Pos, 3, GL_FLOAT, GL_FALSE, offsetof(vxtex, pos) },
+    { Attrib_UV, 2, GL_FLOAT, GL_FALSE, offsetof(vxtex, uv) },
+};
+
+void GetVertexFormat(VertexFormat Format, const VertexAttribDesc*& OutAttribs, int& OutNumAttribs, GLsizei& OutStride)
+{
+    switch (Format)
+    {
+        case VertexFormat::VxColor:
+        {
+            OutAttribs = VxColorAttribs;
+            OutNumAttribs = ARRAY_SIZE(VxColorAttribs);
+            OutStride = sizeof(vxcolor);
+        } break;
+        case VertexFormat::VxTex:
+        {
+            OutAttribs = VxTexAttribs;
+            OutNumAttribs = ARRAY_SIZE(VxTexAttribs);
+            OutStride = sizeof(vxtex);
+        } break;
+    }
+}
+
+// Binds Buffer to the next free binding point of the mesh's VAO and points Attribs at it
+void AddVertexStream(Mesh& InMesh, GLuint Buffer, GLsizei Stride, GLuint Divisor,
+    const VertexAttribDesc* Attribs, int NumAttribs)
+{
+    const GLuint BindingIdx = InMesh.num_streams++;
+    if (GLState::HasDSA())
+    {
+        const GLuint VAO = InMesh.vertex_array;
+        glVertexArrayVertexBuffer(VAO, BindingIdx, Buffer, 0, Stride);
+        glVertexArrayBindingDivisor(VAO, BindingIdx, Divisor);
+        for (int AttribIdx = 0; AttribIdx < NumAttribs; AttribIdx++)
+        {
+            const VertexAttribDesc& Attrib = Attribs[AttribIdx];
+            glEnableVertexArrayAttrib(VAO, Attrib.location);
+            glVertexArrayAttribFormat(VAO, Attrib.location, Attrib.size, Attrib.type, Attrib.normalized, Attrib.offset);
+            glVertexArrayAttribBinding(VAO, Attrib.location, BindingIdx);
+        }
+    }
+    else
+    {
+        GLState::BindVertexArray(InMesh.vertex_array);
+        glBindBuffer(GL_ARRAY_BUFFER, Buffer);
+        for (int AttribIdx = 0; AttribIdx < NumAttribs; AttribIdx++)
+        {
+            const VertexAttribDesc& Attrib = Attribs[AttribIdx];
+            glEnableVertexAttribArray(Attrib.location);
+            glVertexAttribPointer(Attrib.location, Attrib.size, Attrib.type, Attrib.normalized, Stride, (void*)(size_t)Attrib.offset);
+            glVertexAttribDivisor(Attrib.location, Divisor);
+        }
+    }
+}
+
+MeshHandle MeshRegistry::Create(VertexFormat Format, const void* Verts, GLsizei NumVerts,
+    const GLuint* Inds, GLsizei NumInds, GLenum Primitive)
+{
+    if (MeshRegistryState.NumMeshes >= MaxMeshes) { LOGF("MeshRegistry: out of mesh slots!\n"); return InvalidMesh; }
+
+    MeshHandle Handle = (MeshHandle)MeshRegistryState.NumMeshes++;
+    Mesh& NewMesh = MeshRegistryState.Meshes[Handle];
+    NewMesh.primitive = Primitive;
+    NewMesh.num_verts = NumVerts;
+    NewMesh.num_inds = Inds ? NumInds : 0;
+
+    const VertexAttribDesc* Attribs = nullptr;
+    int NumAttribs = 0;
+    GLsizei Stride = 0;
+    GetVertexFormat(Format, Attribs, NumAttribs, Stride);
+    const GLsizeiptr VertsSize = (GLsizeiptr)Stride * NumVerts;
+    const GLsizeiptr IndsSize = (GLsizeiptr)sizeof(GLuint) * NewMesh.num_inds;
+
+    // The VAO captures both the attribute layout and the element buffer binding
+    if (GLState::HasDSA())
+    {
+        // Immutable storage, nothing gets bound
+        glCreateVertexArrays(1, &NewMesh.vertex_array);
+        glCreateBuffers(1, &NewMesh.vertex_buffer);
+        glNamedBufferStorage(NewMesh.vertex_buffer, VertsSize, Verts, 0);
+        if (NewMesh.num_inds > 0)
+        {
+            glCreateBuffers(1, &NewMesh.index_buffer);
+            glNamedBufferStorage(NewMesh.index_buffer, IndsSize, Inds, 0);
+            glVertexArrayElementBuffer(NewMesh.vertex_array, NewMesh.index_buffer);
+        }
+    }
+    else
+    {
+        glGenVertexArrays(1, &NewMesh.vertex_array);
+        GLState::BindVertexArray(NewMesh.vertex_array);
+
+        glGenBuffers(1, &NewMesh.vertex_buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, NewMesh.vertex_buffer);
+        glBufferData(GL_ARRAY_BUFFER, VertsSize, Verts, GL_STATIC_DRAW);
+        if (NewMesh.num_inds > 0)
+        {
+            glGenBuffers(1, &NewMesh.index_buffer);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, NewMesh.index_buffer);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, IndsSize, Inds, GL_STATIC_DRAW);
+        }
+    }
+    AddVertexStream(NewMesh, NewMesh.vertex_buffer, Stride, 0, Attribs, NumAttribs);
+
+    return Handle;
+}
+
+MeshHandle MeshRegistry::CreateDynamic(VertexFormat Format, GLenum Primitive)
+{
+    if (MeshRegistryState.NumMeshes >= MaxMeshes) { LOGF("MeshRegistry: out of mesh slots!\n"); return InvalidMesh; }
+
+    MeshHandle Handle = (MeshHandle)MeshRegistryState.NumMeshes++;
+    Mesh& NewMesh = MeshRegistryState.Meshes[Handle];
+    NewMesh.primitive = Primitive;
+
+    const VertexAttribDesc* Attribs = nullptr;
+    int NumAttribs = 0;
+    GLsizei Stride = 0;
+    GetVertexFormat(Format, Attribs, NumAttribs, Stride);
+
+    // No buffers of its own: vertex_buffer stays 0, the ring is owned by DynamicRing
+    if (GLState::HasDSA()) { glCreateVertexArrays(1, &NewMesh.vertex_array); }
+    else { glGenVertexArrays(1, &NewMesh.vertex_array); }
+    AddVertexStream(NewMesh, DynamicRing::GetBuffer(), Stride, 0, Attribs, NumAttribs);
+
+    return Handle;
+}
+
+void MeshRegistry::SetDynamicRange(MeshHandle Handle, GLsizei FirstVert, GLsizei NumVerts)
+{
+    if (Handle == InvalidMesh || (int)Handle >= MeshRegistryState.NumMeshes) { return; }
+    MeshRegistryState.Meshes[Handle].first_vert = FirstVert;
+    MeshRegistryState.Meshes[Handle].num_verts = NumVerts;
+}
+
+void MeshRegistry::AddInstanceStream(MeshHandle Handle, GLuint Buffer, GLsizei Stride,
+    const VertexAttribDesc* Attribs, int NumAttribs)
+{
+    if (Handle == InvalidMesh || (int)Handle >= MeshRegistryState.NumMeshes) { return; }
+    Mesh& StreamMesh = MeshRegistryState.Meshes[Handle];
+    if (StreamMesh.num_instance_streams >= MaxMeshInstanceStreams || NumAttribs > MaxInstanceStreamAttribs)
+    {
+        LOGF("MeshRegistry: too many instance streams or attributes on mesh %u!\n", Handle);
+        return;
+    }
+
+    MeshInstanceStream& Stream = StreamMesh.instance_streams[StreamMesh.num_instance_streams++];
+    Stream.binding = StreamMesh.num_streams;
+    Stream.buffer = Buffer;
+    Stream.stride = Stride;
+    Stream.num_attribs = NumAttribs;
+    memcpy(Stream.attribs, Attribs, sizeof(VertexAttribDesc) * NumAttribs);
+    AddVertexStream(StreamMesh, Buffer, Stride, 1, Attribs, NumAttribs);
+}
+
+// DEV_NOTE: The bundled glad stops at GL 4.0, 4.2+ contexts report base instance through the extension,
+//     which is also what loads the entry points
+bool HasBaseInstance()
+{
+    return GLAD_GL_ARB_base_instance != 0;
+}
+
+// Fallback for drivers without base instance draws: move every instance stream of the bound VAO so
+//     instance 0 reads BaseInstance; streams already there are left alone
+void SetInstanceStreamBase(Mesh& InMesh, GLuint BaseInstance)
+{
+    for (int StreamIdx = 0; StreamIdx < InMesh.num_instance_streams; StreamIdx++)
+    {
+        MeshInstanceStream& Stream = InMesh.instance_streams[StreamIdx];
+        if (Stream.base_instance == BaseInstance) { continue; }
+        Stream.base_instance = BaseInstance;
+
+        const GLintptr BaseOffset = (GLintptr)BaseInstance * Stream.stride;
+        if (GLState::HasDSA())
+        {
+            glVertexArrayVertexBuffer(InMesh.vertex_array, Stream.binding, Stream.buffer, BaseOffset, Stream.stride);
+        }
+        else
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, Stream.buffer);
+            for (int AttribIdx = 0; AttribIdx < Stream.num_attribs; AttribIdx++)
+            {
+                const VertexAttribDesc& Attrib = Stream.attribs[AttribIdx];
+                glVertexAttribPointer(Attrib.location, Attrib.size, Attrib.type, Attrib.normalized, Stream.stride,
+                    (void*)(size_t)(BaseOffset + Attrib.offset));
+            }
+        }
+    }
+}
+
+const Mesh* MeshRegistry::Get(MeshHandle Handle)
+{
+    const Mesh* Result = nullptr;
+    if (Handle != InvalidMesh && (int)Handle < MeshRegistryState.NumMeshes)
+    {
+        Result = &MeshRegistryState.Meshes[Handle];
+    }
+    return Result;
+}
+
+void MeshRegistry::Bind(MeshHandle Handle)
+{
+    const Mesh* BindMesh = Get(Handle);
+    GLState::BindVertexArray(BindMesh ? BindMesh->vertex_array : 0);
+}
+
+void MeshRegistry::DrawBound(MeshHandle Handle, GLsizei NumInstances, GLuint BaseInstance)
+{
+    if (Handle == InvalidMesh || (int)Handle >= MeshRegistryState.NumMeshes) { return; }
+    Mesh* DrawMesh = &MeshRegistryState.Meshes[Handle];
+
+    const bool bBaseInstanceDraw = BaseInstance > 0 && HasBaseInstance();
+    if (!HasBaseInstance())
+    {
+        // A non-instanced draw still reads instance 0 of any instance stream
+        SetInstanceStreamBase(*DrawMesh, BaseInstance);
+    }
+
+    // Only draw calls from here on, drivers may allocate while recording them (llvmpipe does)
+    ALLOC_EXEMPT_SCOPE("MeshRegistry GL");
+    if (bBaseInstanceDraw)
+    {
+        const GLsizei NumDrawInstances = NumInstances > 0 ? NumInstances : 1;
+        if (DrawMesh->num_inds > 0)
+        {
+            glDrawElementsInstancedBaseInstance(DrawMesh->primitive, DrawMesh->num_inds, GL_UNSIGNED_INT, nullptr,
+                NumDrawInstances, BaseInstance);
+        }
+        else
+        {
+            glDrawArraysInstancedBaseInstance(DrawMesh->primitive, DrawMesh->first_vert, DrawMesh->num_verts, NumDrawInstances, BaseInstance);
+        }
+    }
+    else if (NumInstances > 0)
+    {
+        if (DrawMesh->num_inds > 0)
+        {
+            glDrawElementsInstanced(DrawMesh->primitive, DrawMesh->num_inds, GL_UNSIGNED_INT, nullptr, NumInstances);
+        }
+        else
+        {
+            glDrawArraysInstanced(DrawMesh->primitive, DrawMesh->first_vert, DrawMesh->num_verts, NumInstances);
+        }
+    }
+    else if (DrawMesh->num_inds > 0)
+    {
+        glDrawElements(DrawMesh->primitive, DrawMesh->num_inds, GL_UNSIGNED_INT, nullptr);
+    }
+    else
+    {
+        glDrawArrays(DrawMesh->primitive, DrawMesh->first_vert, DrawMesh->num_verts);
+    }
+}
+
+void MeshRegistry::Draw(MeshHandle Handle)
+{
+    Bind(Handle);
+    DrawBound(Handle);
+}
+
+void MeshRegistry::DrawInstanced(MeshHandle Handle, GLsizei NumInstances)
+{
+    if (NumInstances <= 0) { return; }
+    Bind(Handle);
+    DrawBound(Handle, NumInstances);
+}
+
+void MeshRegistry::Terminate()
+{
+    GLState::BindVertexArray(0);
+    for (int MeshIdx = 1; MeshIdx < MeshRegistryState.NumMeshes; MeshIdx++)
+    {
+        Mesh& CurrMesh = MeshRegistryState.Meshes[MeshIdx];
+        glDeleteVertexArrays(1, &CurrMesh.vertex_array);
+        if (CurrMesh.vertex_buffer) { glDeleteBuffers(1, &CurrMesh.vertex_buffer); }
+        if (CurrMesh.index_buffer) { glDeleteBuffers(1, &CurrMesh.index_buffer); }
+        CurrMesh = {};
+    }
+    MeshRegistryState.NumMeshes = 1;
+}
+}
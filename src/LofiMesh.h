@@ -0,0 +1,79 @@
+#ifndef LOFIMESH_H
+#define LOFIMESH_H
+
+#include "Common.h"
+#include "LofiGraphics.h"
+
+namespace Lofi
+{
+// 0 is never a valid mesh
+using MeshHandle = uint32_t;
+constexpr MeshHandle InvalidMesh = 0;
+
+enum struct VertexFormat
+{
+    VxColor,
+    VxTex,
+};
+
+struct VertexAttribDesc
+{
+    GLuint location;
+    GLint size;
+    GLenum type;
+    GLboolean normalized;
+    GLuint offset;
+};
+
+constexpr int MaxMeshInstanceStreams = 2;
+constexpr int MaxInstanceStreamAttribs = 10;
+
+// Kept so the stream can be re-pointed at a base instance where the driver can't offset it
+struct MeshInstanceStream
+{
+    GLuint binding = 0;
+    GLuint buffer = 0;
+    GLsizei stride = 0;
+    GLuint base_instance = 0; // Instance the stream currently starts at
+    int num_attribs = 0;
+    VertexAttribDesc attribs[MaxInstanceStreamAttribs];
+};
+
+// GPU-resident geometry: VAO + VBO + (optional) EBO, all created once at init
+struct Mesh
+{
+    GLuint vertex_array = 0;
+    GLuint vertex_buffer = 0;
+    GLuint index_buffer = 0;
+    GLuint num_streams = 0; // Vertex buffer binding points in use
+    GLenum primitive = GL_TRIANGLES;
+    GLsizei first_vert = 0;
+    GLsizei num_verts = 0;
+    GLsizei num_inds = 0;
+    MeshInstanceStream instance_streams[MaxMeshInstanceStreams];
+    int num_instance_streams = 0;
+};
+
+struct MeshRegistry
+{
+    static MeshHandle Create(VertexFormat Format, const void* Verts, GLsizei NumVerts,
+        const GLuint* Inds = nullptr, GLsizei NumInds = 0, GLenum Primitive = GL_TRIANGLES);
+    // Non-indexed mesh whose vertices live in the DynamicRing, re-pointed every frame with SetDynamicRange
+    static MeshHandle CreateDynamic(VertexFormat Format, GLenum Primitive);
+    static void SetDynamicRange(MeshHandle Handle, GLsizei FirstVert, GLsizei NumVerts);
+    // Adds a per-instance vertex stream (divisor 1) to the mesh's VAO, Buffer stays owned by the caller
+    static void AddInstanceStream(MeshHandle Handle, GLuint Buffer, GLsizei Stride,
+        const VertexAttribDesc* Attribs, int NumAttribs);
+    static const Mesh* Get(MeshHandle Handle);
+    static void Bind(MeshHandle Handle);
+    // Draws with whatever VAO is bound (the mesh's own); NumInstances == 0 issues a non-instanced draw
+    //     BaseInstance offsets per-instance streams: a base instance draw with ARB_base_instance,
+    //     otherwise the streams' attribute offsets are moved to the base instance before the draw
+    static void DrawBound(MeshHandle Handle, GLsizei NumInstances = 0, GLuint BaseInstance = 0);
+    static void Draw(MeshHandle Handle);
+    static void DrawInstanced(MeshHandle Handle, GLsizei NumInstances);
+    static void Terminate();
+};
+}
+
+#endif // LOFIMESH_H
@@ -0,0 +1,204 @@
+#include "LofiProfiler.h"
+#include "LofiAllocTracker.h"
+
+#if LOFI_PROFILE
+#include <chrono>
+#include <mutex>
+#endif
+
+namespace Lofi
+{
+#if LOFI_PROFILE
+thread_local ProfileThreadBuffer* ProfileThreadLocal = nullptr;
+
+struct ProfilerState_t
+{
+    std::mutex ThreadsMutex; // Thread registration and dumps, zones never take it
+    ProfileThreadBuffer* FirstThread = nullptr; // Every buffer handed out, in use or free
+    int NumThreads = 0;
+    int NextThreadIdx = 0;
+
+    // Ticks -> microseconds, calibrated against the steady clock at dump time
+    uint64_t StartTicks = 0;
+    std::chrono::steady_clock::time_point StartTime;
+} ProfilerState;
+
+// Hands the thread's buffer back when the thread exits; lives outside the header so zones keep a plain pointer
+struct ProfileThreadRelease
+{
+    bool bRegistered = false;
+
+    ~ProfileThreadRelease()
+    {
+        ProfileThreadBuffer* Buffer = ProfileThreadLocal;
+        if (!Buffer) { return; } // Never registered, or Terminate already freed it
+        std::lock_guard<std::mutex> Lock(ProfilerState.ThreadsMutex);
+        Buffer->bInUse = false;
+        ProfileThreadLocal = nullptr;
+    }
+};
+thread_local ProfileThreadRelease ProfileThreadReleaseLocal;
+
+ProfileThreadBuffer* ProfileRegisterThread()
+{
+    ALLOC_SCOPE("Profiler");
+    ProfileThreadBuffer* Buffer = nullptr;
+    {
+        std::lock_guard<std::mutex> Lock(ProfilerState.ThreadsMutex);
+        for (ProfileThreadBuffer* Free = ProfilerState.FirstThread; Free; Free = Free->Next)
+        {
+            if (!Free->bInUse) { Buffer = Free; break; }
+        }
+        if (Buffer)
+        {
+            // The previous owner's events would show up under the new thread's track, drop them
+            Buffer->Head.store(0, std::memory_order_relaxed);
+        }
+        else
+        {
+            Buffer = new ProfileThreadBuffer;
+            Buffer->Next = ProfilerState.FirstThread;
+            ProfilerState.FirstThread = Buffer;
+            ProfilerState.NumThreads++;
+        }
+        Buffer->bInUse = true;
+        Buffer->ThreadIdx = ProfilerState.NextThreadIdx++;
+        snprintf(Buffer->Name, MaxProfileNameLength, "Thread %d", Buffer->ThreadIdx);
+    }
+    ProfileThreadReleaseLocal.bRegistered = true; // Constructs this thread's release guard
+    ProfileThreadLocal = Buffer;
+    return Buffer;
+}
+
+void Profiler::Init()
+{
+    ProfilerState.StartTicks = ProfileTicks();
+    ProfilerState.StartTime = std::chrono::steady_clock::now();
+}
+
+void Profiler::Terminate()
+{
+    // DEV_NOTE: Every thread that recorded zones must have exited (or stopped recording) by now
+    std::lock_guard<std::mutex> Lock(ProfilerState.ThreadsMutex);
+    ProfileThreadBuffer* Buffer = ProfilerState.FirstThread;
+    while (Buffer)
+    {
+        ProfileThreadBuffer* Next = Buffer->Next;
+        delete Buffer;
+        Buffer = Next;
+    }
+    ProfilerState.FirstThread = nullptr;
+    ProfilerState.NumThreads = 0;
+    ProfileThreadLocal = nullptr;
+}
+
+void Profiler::SetThreadName(const char* Name)
+{
+    ProfileThreadBuffer* Buffer = ProfileThreadLocal ? ProfileThreadLocal : ProfileRegisterThread();
+    snprintf(Buffer->Name, MaxProfileNameLength, "%s", Name);
+    AllocTracker::SetThreadName(Name);
+}
+
+void WriteJSONString(FILE* File, const char* String)
+{
+    fputc('"', File);
+    for (const char* Char = String; *Char; Char++)
+    {
+        if (*Char == '"' || *Char == '\\') { fputc('\\', File); fputc(*Char, File); }
+        else if ((unsigned char)*Char < 0x20) { fprintf(File, "\\u%04x", (unsigned)*Char); }
+        else { fputc(*Char, File); }
+    }
+    fputc('"', File);
+}
+
+bool Profiler::DumpChromeTrace(const char* Filename)
+{
+    FILE* TraceFile = FileOpen(Filename, "wb");
+    if (!TraceFile) { LOGF("Profiler: can't write %s\n", Filename); return false; }
+
+    const uint64_t NowTicks = ProfileTicks();
+    const double ElapsedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - ProfilerState.StartTime).count();
+    const double TicksPerUs = ElapsedUs > 0.0 ? (double)(NowTicks - ProfilerState.StartTicks) / ElapsedUs : 1.0;
+
+    ProfileEvent* Events = new ProfileEvent[ProfileRingSize];
+    int NumEvents = 0;
+    fprintf(TraceFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    std::lock_guard<std::mutex> Lock(ProfilerState.ThreadsMutex);
+    int NumDumpedThreads = 0;
+    for (const ProfileThreadBuffer* Thread = ProfilerState.FirstThread; Thread; Thread = Thread->Next)
+    {
+        // A free buffer still holds its exited thread's events, until the next thread takes it over
+        const ProfileThreadBuffer& Buffer = *Thread;
+        fprintf(TraceFile, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":",
+            NumDumpedThreads > 0 ? ",\n" : "", Buffer.ThreadIdx);
+        NumDumpedThreads++;
+        WriteJSONString(TraceFile, Buffer.Name);
+        fprintf(TraceFile, "}}");
+
+        const uint64_t Head = Buffer.Head.load(std::memory_order_acquire);
+        const uint64_t CopyFirst = Head > ProfileRingSize ? Head - ProfileRingSize : 0;
+        for (uint64_t EventIdx = CopyFirst; EventIdx < Head; EventIdx++)
+        {
+            Events[EventIdx - CopyFirst] = Buffer.Events[EventIdx & (ProfileRingSize - 1)];
+        }
+        // DEV_NOTE: The owning thread keeps recording during the copy, whatever it may have overwritten is dropped
+        const uint64_t HeadAfter = Buffer.Head.load(std::memory_order_acquire);
+        uint64_t First = CopyFirst;
+        if (HeadAfter > ProfileRingSize && HeadAfter - ProfileRingSize > First) { First = HeadAfter - ProfileRingSize; }
+
+        // The oldest begins may have been overwritten, skip ends that would close zones the trace never opened
+        int Depth = 0;
+        for (uint64_t EventIdx = First; EventIdx < Head; EventIdx++)
+        {
+            const ProfileEvent& Event = Events[EventIdx - CopyFirst];
+            if (!Event.Name && Depth == 0) { continue; }
+            Depth += Event.Name ? 1 : -1;
+
+            const int64_t SinceStart = (int64_t)(Event.Ticks - ProfilerState.StartTicks);
+            const double TimestampUs = SinceStart > 0 ? (double)SinceStart / TicksPerUs : 0.0;
+            fprintf(TraceFile, ",\n{\"ph\":\"%c\",\"pid\":0,\"tid\":%d,\"ts\":%.3f", Event.Name ? 'B' : 'E', Buffer.ThreadIdx, TimestampUs);
+            if (Event.Name)
+            {
+                fprintf(TraceFile, ",\"name\":");
+                WriteJSONString(TraceFile, Event.Name);
+            }
+            fputc('}', TraceFile);
+            NumEvents++;
+        }
+    }
+    fprintf(TraceFile, "\n]}\n");
+    fclose(TraceFile);
+    delete[] Events;
+
+    LOGF("Profiler: %d events from %d threads written to %s\n", NumEvents, NumDumpedThreads, Filename);
+    return true;
+}
+
+double Profiler::MeasureOverheadNs(int NumZones)
+{
+    const std::chrono::steady_clock::time_point StartTime = std::chrono::steady_clock::now();
+    for (int ZoneIdx = 0; ZoneIdx < NumZones; ZoneIdx++)
+    {
+        PROFILE_SCOPE("Profiler::MeasureOverhead");
+    }
+    const double ElapsedNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - StartTime).count();
+    return NumZones > 0 ? ElapsedNs / NumZones : 0.0;
+}
+#else
+void Profiler::Init() {}
+void Profiler::Terminate() {}
+void Profiler::SetThreadName(const char* Name) { AllocTracker::SetThreadName(Name); }
+
+bool Profiler::DumpChromeTrace(const char* Filename)
+{
+    LOGF("Profiler: compiled out (LOFI_PROFILE=0), %s not written\n", Filename);
+    return false;
+}
+
+double Profiler::MeasureOverheadNs(int NumZones)
+{
+    (void)NumZones;
+    return 0.0;
+}
+#endif
+}
@@ -0,0 +1,110 @@
+#ifndef LOFIPROFILER_H
+#define LOFIPROFILER_H
+
+#include "Common.h"
+
+// Build with LOFI_PROFILE=0 to compile every PROFILE_SCOPE out; the Profiler calls then do nothing
+#if !defined(LOFI_PROFILE)
+#define LOFI_PROFILE 1
+#endif
+
+#if LOFI_PROFILE
+#include <atomic>
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define LOFI_PROFILE_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define LOFI_PROFILE_RDTSC 1
+#else
+#include <chrono>
+#define LOFI_PROFILE_RDTSC 0
+#endif
+#endif
+
+namespace Lofi
+{
+/*
+    CPU zones: PROFILE_SCOPE("Name") records a begin event where it's declared and an end event when
+        the scope exits. Names must be string literals (or otherwise outlive the profiler), only the
+        pointer is stored.
+    Every thread writes into its own ring of the last ProfileRingSize events, no locks and no
+        allocations after a thread's first zone; old events are overwritten. DumpChromeTrace writes
+        whatever the rings hold as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+    A thread's ring goes back to the profiler when the thread exits and the next new thread takes it
+        over, so respawned worker pools don't grow memory. An exited thread's events stay in the dump
+        until then.
+*/
+struct Profiler
+{
+    static void Init();
+    static void Terminate();
+
+    // Shown as the thread's track name in the trace, and in allocation reports
+    static void SetThreadName(const char* Name);
+    static bool DumpChromeTrace(const char* Filename);
+    // Average cost of one empty zone (begin + end), in ns
+    static double MeasureOverheadNs(int NumZones);
+};
+
+#if LOFI_PROFILE
+constexpr uint32_t ProfileRingSize = 1 << 16; // Events per thread, power of two
+constexpr int MaxProfileNameLength = 32;
+
+struct ProfileEvent
+{
+    uint64_t Ticks;
+    const char* Name; // nullptr: end of the innermost open zone
+};
+
+struct ProfileThreadBuffer
+{
+    ProfileEvent Events[ProfileRingSize];
+    // Only the owning thread writes; release so a dump that reads Head sees the events before it
+    std::atomic<uint64_t> Head{ 0 };
+    int ThreadIdx = 0;
+    char Name[MaxProfileNameLength] = {};
+
+    // Registration list, under the profiler's mutex; a buffer whose thread exited is reused by the next one
+    ProfileThreadBuffer* Next = nullptr;
+    bool bInUse = false;
+};
+
+extern thread_local ProfileThreadBuffer* ProfileThreadLocal;
+ProfileThreadBuffer* ProfileRegisterThread();
+
+inline uint64_t ProfileTicks()
+{
+#if LOFI_PROFILE_RDTSC
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+inline void ProfileRecord(const char* Name)
+{
+    ProfileThreadBuffer* Buffer = ProfileThreadLocal;
+    if (!Buffer) { Buffer = ProfileRegisterThread(); }
+    const uint64_t Head = Buffer->Head.load(std::memory_order_relaxed);
+    ProfileEvent& Event = Buffer->Events[Head & (ProfileRingSize - 1)];
+    Event.Ticks = ProfileTicks();
+    Event.Name = Name;
+    Buffer->Head.store(Head + 1, std::memory_order_release);
+}
+
+struct ProfileScope
+{
+    ProfileScope(const char* Name) { ProfileRecord(Name); }
+    ~ProfileScope() { ProfileRecord(nullptr); }
+};
+
+#define LOFI_PROFILE_JOIN2(A, B) A##B
+#define LOFI_PROFILE_JOIN(A, B) LOFI_PROFILE_JOIN2(A, B)
+#define PROFILE_SCOPE(Name) ::Lofi::ProfileScope LOFI_PROFILE_JOIN(ProfileScope_, __LINE__){ Name }
+#else
+#define PROFILE_SCOPE(Name) do {} while (0)
+#endif
+}
+
+#endif // LOFIPROFILER_H
@@ -0,0 +1,240 @@
+#include "LofiRenderQueue.h"
+#include "LofiDynamicRing.h"
+#include "LofiGLState.h"
+#include "LofiGPUProfiler.h"
+
+#include <cstring>
+
+namespace Lofi
+{
+constexpr int MaxDrawPackets = 16384;
+constexpr int MaxSortSlots = 1 << 10;
+
+struct SortEntry
+{
+    uint64_t Key;
+    uint32_t PacketIdx;
+};
+
+struct RenderQueueState_t
+{
+    DrawPacket Packets[MaxDrawPackets];
+    SortEntry Entries[MaxDrawPackets];
+    SortEntry Scratch[MaxDrawPackets];
+    int NumPackets = 0;
+
+    // GL object names -> dense slot indices, so keys stay small no matter what names GL hands out
+    GLuint ProgramSlots[MaxSortSlots];
+    int NumProgramSlots = 0;
+    GLuint TextureSlots[MaxSortSlots];
+    int NumTextureSlots = 0;
+
+    frame_uniforms Cameras[Camera_Count];
+    GLsizeiptr UBOAlignment = 256;
+
+    RenderQueueStats Stats;
+} RenderQueueState;
+
+void RenderQueue::Init()
+{
+    GLint UBOAlignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &UBOAlignment);
+    RenderQueueState.UBOAlignment = UBOAlignment;
+
+    for (uint32_t CameraIdx = 0; CameraIdx < Camera_Count; CameraIdx++)
+    {
+        RenderQueueState.Cameras[CameraIdx] = frame_uniforms{ HMM_M4D(1.0f), HMM_M4D(1.0f), v4f{}, v4f{} };
+    }
+
+    if (!GLAD_GL_ARB_base_instance)
+    {
+        LOGF("RenderQueue: no base instance draws, instance streams are re-pointed per draw\n");
+    }
+}
+
+void RenderQueue::AddModelStream(MeshHandle Handle)
+{
+    VertexAttribDesc ModelAttribs[4] = {};
+    for (GLuint ColIdx = 0; ColIdx < 4; ColIdx++)
+    {
+        // mat4 attributes occupy 4 consecutive locations, one per column
+        ModelAttribs[ColIdx] = { Attrib_InstModel + ColIdx, 4, GL_FLOAT, GL_FALSE, (GLuint)(sizeof(v4f) * ColIdx) };
+    }
+    // Models are streamed through the dynamic ring, packets index them by base instance
+    MeshRegistry::AddInstanceStream(Handle, DynamicRing::GetBuffer(), sizeof(m4f), ModelAttribs, ARRAY_SIZE(ModelAttribs));
+}
+
+void RenderQueue::SetCamera(RenderCamera Camera, const frame_uniforms& Uniforms)
+{
+    if (Camera >= Camera_Count) { return; }
+    RenderQueueState.Cameras[Camera] = Uniforms;
+}
+
+uint64_t GetSortSlot(GLuint Name, GLuint* Slots, int& NumSlots)
+{
+    for (int SlotIdx = 0; SlotIdx < NumSlots; SlotIdx++)
+    {
+        if (Slots[SlotIdx] == Name) { return (uint64_t)SlotIdx; }
+    }
+    if (NumSlots < MaxSortSlots)
+    {
+        Slots[NumSlots] = Name;
+        return (uint64_t)NumSlots++;
+    }
+    return MaxSortSlots - 1;
+}
+
+uint64_t MakeSortKey(const DrawPacket& Packet)
+{
+    const uint64_t CameraBits = Packet.camera & 0x3;
+    const uint64_t ProgramSlot = GetSortSlot(Packet.program, RenderQueueState.ProgramSlots, RenderQueueState.NumProgramSlots);
+    const uint64_t TextureSlot = GetSortSlot(Packet.texture, RenderQueueState.TextureSlots, RenderQueueState.NumTextureSlots);
+    const uint64_t MeshBits = Packet.mesh & 0xFFF;
+
+    float Depth = Packet.depth < 0.0f ? 0.0f : (Packet.depth > 1.0f ? 1.0f : Packet.depth);
+    const uint64_t DepthBits = (uint64_t)(Depth * (float)0xFFFFFF) & 0xFFFFFF;
+
+    return (CameraBits << 62) | (ProgramSlot << 52) | (TextureSlot << 42) | (MeshBits << 30) | (DepthBits << 6);
+}
+
+// LSD radix sort, 8 bits per pass; passes where every key shares the same digit are skipped
+void RadixSort(SortEntry* Entries, SortEntry* Scratch, int Count)
+{
+    SortEntry* Src = Entries;
+    SortEntry* Dst = Scratch;
+    for (int Shift = 0; Shift < 64; Shift += 8)
+    {
+        int Offsets[256] = {};
+        for (int EntryIdx = 0; EntryIdx < Count; EntryIdx++)
+        {
+            Offsets[(Src[EntryIdx].Key >> Shift) & 0xFF]++;
+        }
+        if (Offsets[(Src[0].Key >> Shift) & 0xFF] == Count) { continue; }
+
+        int Total = 0;
+        for (int Digit = 0; Digit < 256; Digit++)
+        {
+            int DigitCount = Offsets[Digit];
+            Offsets[Digit] = Total;
+            Total += DigitCount;
+        }
+        for (int EntryIdx = 0; EntryIdx < Count; EntryIdx++)
+        {
+            Dst[Offsets[(Src[EntryIdx].Key >> Shift) & 0xFF]++] = Src[EntryIdx];
+        }
+
+        SortEntry* Temp = Src;
+        Src = Dst;
+        Dst = Temp;
+    }
+
+    if (Src != Entries)
+    {
+        for (int EntryIdx = 0; EntryIdx < Count; EntryIdx++) { Entries[EntryIdx] = Src[EntryIdx]; }
+    }
+}
+
+int CountStateChanges(const DrawPacket& Prev, const DrawPacket& Curr)
+{
+    return (Prev.program != Curr.program) + (Prev.texture != Curr.texture) + (Prev.mesh != Curr.mesh);
+}
+
+void RenderQueue::Submit(const DrawPacket& Packet)
+{
+    if (RenderQueueState.NumPackets >= MaxDrawPackets) { LOGF("RenderQueue: packet limit reached!\n"); return; }
+
+    const int PacketIdx = RenderQueueState.NumPackets++;
+    RenderQueueState.Packets[PacketIdx] = Packet;
+    RenderQueueState.Entries[PacketIdx] = SortEntry{ MakeSortKey(Packet), (uint32_t)PacketIdx };
+}
+
+void RenderQueue::Execute()
+{
+    const int NumPackets = RenderQueueState.NumPackets;
+    // The keys are built, and only have to agree within a frame: start the name tables over so
+    //     reloaded programs and streamed textures never fill them up
+    RenderQueueState.NumProgramSlots = 0;
+    RenderQueueState.NumTextureSlots = 0;
+    RenderQueueStats& Stats = RenderQueueState.Stats;
+    Stats = {};
+    Stats.NumPackets = NumPackets;
+    if (NumPackets == 0) { return; }
+
+    // What binding everything in submission order would have cost
+    int UnsortedStateChanges = 3;
+    for (int PacketIdx = 1; PacketIdx < NumPackets; PacketIdx++)
+    {
+        UnsortedStateChanges += CountStateChanges(RenderQueueState.Packets[PacketIdx - 1], RenderQueueState.Packets[PacketIdx]);
+    }
+
+    RadixSort(RenderQueueState.Entries, RenderQueueState.Scratch, NumPackets);
+
+    // Once-per-frame uploads straight into the ring: every camera, then every model in sorted order
+    GLsizeiptr CameraOffsets[Camera_Count] = {};
+    for (uint32_t CameraIdx = 0; CameraIdx < Camera_Count; CameraIdx++)
+    {
+        DynamicAlloc CameraAlloc = DynamicRing::Alloc(sizeof(frame_uniforms), RenderQueueState.UBOAlignment);
+        if (!CameraAlloc.IsValid()) { RenderQueueState.NumPackets = 0; return; }
+        memcpy(CameraAlloc.ptr, &RenderQueueState.Cameras[CameraIdx], sizeof(frame_uniforms));
+        CameraOffsets[CameraIdx] = CameraAlloc.offset;
+    }
+    DynamicAlloc ModelAlloc = DynamicRing::Alloc(sizeof(m4f) * NumPackets, sizeof(m4f));
+    if (!ModelAlloc.IsValid()) { RenderQueueState.NumPackets = 0; return; }
+    m4f* Models = (m4f*)ModelAlloc.ptr;
+    for (int EntryIdx = 0; EntryIdx < NumPackets; EntryIdx++)
+    {
+        Models[EntryIdx] = RenderQueueState.Packets[RenderQueueState.Entries[EntryIdx].PacketIdx].model;
+    }
+    const GLuint ModelBaseInstance = (GLuint)(ModelAlloc.offset / sizeof(m4f));
+    DynamicRing::Flush();
+
+    // Sorted by camera first, so each camera's packets are one contiguous GPU pass
+    const GPUPass CameraPasses[Camera_Count] = { GPUPass_World, GPUPass_Screen };
+    const DrawPacket* Prev = nullptr;
+    for (int EntryIdx = 0; EntryIdx < NumPackets; EntryIdx++)
+    {
+        const DrawPacket& Packet = RenderQueueState.Packets[RenderQueueState.Entries[EntryIdx].PacketIdx];
+        if (!Prev || Prev->camera != Packet.camera)
+        {
+            if (Prev) { GPUProfiler::End(CameraPasses[Prev->camera]); }
+            GPUProfiler::Begin(CameraPasses[Packet.camera]);
+            glBindBufferRange(GL_UNIFORM_BUFFER, FrameUniformsBinding, DynamicRing::GetBuffer(),
+                CameraOffsets[Packet.camera], sizeof(frame_uniforms));
+        }
+        if (!Prev || Prev->program != Packet.program)
+        {
+            GLState::UseProgram(Packet.program);
+            Stats.StateChanges++;
+        }
+        if (!Prev || Prev->texture != Packet.texture)
+        {
+            GLState::BindTexture2D(0, Packet.texture);
+            Stats.StateChanges++;
+        }
+        if (!Prev || Prev->mesh != Packet.mesh)
+        {
+            MeshRegistry::Bind(Packet.mesh);
+            Stats.StateChanges++;
+        }
+
+        if (Packet.num_instances > 0)
+        {
+            MeshRegistry::DrawBound(Packet.mesh, Packet.num_instances, Packet.base_instance);
+        }
+        else
+        {
+            MeshRegistry::DrawBound(Packet.mesh, 1, ModelBaseInstance + (GLuint)EntryIdx);
+        }
+        Prev = &Packet;
+    }
+    GPUProfiler::End(CameraPasses[Prev->camera]);
+
+    Stats.SavedStateChanges = UnsortedStateChanges - Stats.StateChanges;
+    RenderQueueState.NumPackets = 0;
+}
+
+const RenderQueueStats& RenderQueue::GetStats()
+{
+    return RenderQueueState.Stats;
+}
+}
@@ -0,0 +1,66 @@
+#ifndef LOFIRENDERQUEUE_H
+#define LOFIRENDERQUEUE_H
+
+#include "Common.h"
+#include "LofiGraphics.h"
+#include "LofiMesh.h"
+
+namespace Lofi
+{
+enum RenderCamera : uint32_t
+{
+    Camera_World = 0, // Perspective, drawn first
+    Camera_Screen = 1, // Orthographic, drawn over the world
+    Camera_Count,
+};
+
+struct DrawPacket
+{
+    RenderCamera camera = Camera_World;
+    GLuint program = 0;
+    GLuint texture = 0;
+    MeshHandle mesh = InvalidMesh;
+    // 0: single draw, model is streamed through the shared per-object model buffer
+    // >0: instanced draw, the mesh supplies its own per-instance stream and model is ignored
+    GLsizei num_instances = 0;
+    GLuint base_instance = 0; // Instanced draws only: first instance read from the mesh's per-instance stream
+    float depth = 0.0f; // Normalized [0, 1], sorted front-to-back within equal state
+    m4f model;
+};
+
+struct RenderQueueStats
+{
+    int NumPackets = 0;
+    // Program + texture + VAO binds issued after sorting
+    int StateChanges = 0;
+    // Binds that submission order would have needed, minus StateChanges
+    int SavedStateChanges = 0;
+};
+
+/*
+    Sort key layout (MSB -> LSB):
+        [63..62] camera       (2 bits)
+        [61..52] program slot (10 bits)
+        [51..42] texture slot (10 bits)
+        [41..30] mesh handle  (12 bits)
+        [29..6 ] depth        (24 bits)
+        [ 5..0 ] unused
+*/
+struct RenderQueue
+{
+    // Requires DynamicRing to be initialized, per-frame cameras and models are streamed through it
+    static void Init();
+
+    // Attaches the shared per-object model buffer to a mesh that is drawn by single (non-instanced) packets
+    static void AddModelStream(MeshHandle Handle);
+
+    // Written once per frame on Execute, bound to FrameUniformsBinding
+    static void SetCamera(RenderCamera Camera, const frame_uniforms& Uniforms);
+    static void Submit(const DrawPacket& Packet);
+    // Sorts, draws and clears everything submitted since the last Execute
+    static void Execute();
+    static const RenderQueueStats& GetStats();
+};
+}
+
+#endif // LOFIRENDERQUEUE_H
@@ -0,0 +1,630 @@
+#include "LofiShader.h"
+#include "LofiAllocTracker.h"
+#include "LofiGLState.h"
+#include "LofiGraphics.h"
+#include "LofiProfiler.h"
+#include "LofiShaderCache.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#define LOFI_SHADER_INOTIFY 1
+#else
+#define LOFI_SHADER_INOTIFY 0
+#endif
+
+namespace Lofi
+{
+constexpr int MaxWatchedPrograms = 32;
+constexpr int MaxShaderPathLength = 256;
+constexpr int MaxShaderDefinesLength = 256;
+// Seconds between timestamp checks where there's no inotify
+constexpr double ShaderPollInterval = 0.5;
+
+struct ShaderFileSource
+{
+    GLchar* Contents = nullptr;
+
+    operator GLchar* ()
+    {
+        return Contents;
+    }
+    GLchar** operator&()
+    {
+        return &Contents;
+    }
+    bool IsValid()
+    {
+        return nullptr != Contents;
+    }
+    ShaderFileSource(const char* Filename)
+    {
+        GLchar* Result = nullptr;
+
+        FILE* ShaderFile = FileOpen(Filename, "rb");
+        if (ShaderFile)
+        {
+            fseek(ShaderFile, 0, SEEK_END);
+            size_t FileSize = ftell(ShaderFile);
+            fseek(ShaderFile, 0, SEEK_SET);
+
+            Result = new GLchar[FileSize + 1];
+            fread(Result, sizeof(GLchar), FileSize, ShaderFile);
+            Result[FileSize] = 0x00;
+            fclose(ShaderFile);
+        }
+
+        if (Result) { Contents = Result; }
+    }
+    ~ShaderFileSource()
+    {
+        if (Contents) { delete[] Contents; }
+    }
+};
+
+struct WatchedProgram
+{
+    GLuint* Program;
+    char VShaderFilename[MaxShaderPathLength];
+    char FShaderFilename[MaxShaderPathLength];
+    char Defines[MaxShaderDefinesLength];
+    int64_t VShaderTime; // Polled modification times
+    int64_t FShaderTime;
+    bool bDirty;
+
+    // Reload in flight
+    GLuint Pending;
+    uint64_t PendingKey;
+    bool bPendingFromCache;
+    bool bPendingOnWorker; // Pending arrives from the compile worker once it has linked
+    uint32_t PendingSerial; // Bumped by every reload, results of older ones are dropped
+    double ChangeTime;
+};
+
+// One reload handed to the compile worker, per watched program
+struct ShaderCompileRequest
+{
+    bool bQueued = false;
+    uint32_t Serial = 0;
+    GLchar* VShaderSrc = nullptr; // Owned by the request
+    GLchar* FShaderSrc = nullptr;
+    char Defines[MaxShaderDefinesLength] = {};
+
+    bool bResultReady = false;
+    uint32_t ResultSerial = 0;
+    GLuint Result = 0; // Linked or not, FinishProgram decides on the main thread
+};
+
+/*
+    Without KHR/ARB_parallel_shader_compile, glCompileShader / glLinkProgram do the work right there
+        on the calling thread. Reloads then compile on this worker instead, on a hidden context that
+        shares objects with the main one, so the render thread only ever sees finished programs.
+*/
+struct ShaderCompileWorker_t
+{
+    GLFWwindow* Context = nullptr;
+    std::thread Thread;
+    std::mutex Mutex; // Everything below
+    std::condition_variable Wake;
+    bool bQuit = false;
+    ShaderCompileRequest Requests[MaxWatchedPrograms];
+} ShaderCompileWorker;
+
+struct ShaderLibraryState_t
+{
+    WatchedProgram Watched[MaxWatchedPrograms];
+    int NumWatched = 0;
+    bool bParallelCompile = false;
+    GLuint Permutations[MaxShaderKeys] = {};
+
+    char WatchDirectory[MaxShaderPathLength] = {};
+    bool bWatching = false;
+    int NotifyFd = -1;
+    double LastPollTime = 0.0;
+
+    ShaderReloadStats Stats;
+} ShaderLibraryState;
+
+int64_t GetFileTime(const char* Filename)
+{
+#if defined(_WIN32)
+    struct _stat64 FileStat;
+    if (_stat64(Filename, &FileStat) != 0) { return 0; }
+#else
+    struct stat FileStat;
+    if (stat(Filename, &FileStat) != 0) { return 0; }
+#endif
+    return (int64_t)FileStat.st_mtime;
+}
+
+// Names match the ShaderFeature bit order
+const char* ShaderFeatureDefines[NumShaderFeatures] = { "LOFI_TEXTURE", "LOFI_VERTEX_COLOR", "LOFI_INSTANCING", "LOFI_FOG" };
+
+// Every feature is defined, to 0 or 1, so the uber shader can use #if and a typo'd name fails to compile
+void GetPermutationDefines(ShaderKey Key, char (&OutDefines)[MaxShaderDefinesLength])
+{
+    int Length = 0;
+    for (int FeatureIdx = 0; FeatureIdx < NumShaderFeatures; FeatureIdx++)
+    {
+        Length += snprintf(OutDefines + Length, MaxShaderDefinesLength - Length, "#define %s %d\n",
+            ShaderFeatureDefines[FeatureIdx], (int)((Key >> FeatureIdx) & 1));
+    }
+}
+
+// #version has to stay the first statement, Defines go in as a separate string right after its line
+void CompileShader(GLuint Shader, const GLchar* Source, const char* Defines)
+{
+    const GLchar* VersionEnd = strncmp(Source, "#version", 8) == 0 ? strchr(Source, '\n') : nullptr;
+    const GLint HeadLength = VersionEnd ? (GLint)(VersionEnd + 1 - Source) : 0;
+    const GLchar* Strings[] = { Source, Defines ? Defines : "", Source + HeadLength };
+    const GLint Lengths[] = { HeadLength, -1, -1 };
+    glShaderSource(Shader, ARRAY_SIZE(Strings), Strings, Lengths);
+    glCompileShader(Shader);
+}
+
+// Compiles and starts linking; with parallel shader compile the link may still be running on return
+GLuint BeginProgram(const GLchar* VShaderSrc, const GLchar* FShaderSrc, const char* Defines)
+{
+    GLuint VShader = glCreateShader(GL_VERTEX_SHADER);
+    CompileShader(VShader, VShaderSrc, Defines);
+
+    GLuint FShader = glCreateShader(GL_FRAGMENT_SHADER);
+    CompileShader(FShader, FShaderSrc, Defines);
+
+    GLuint Result = glCreateProgram();
+    ShaderCache::MarkRetrievable(Result);
+    glAttachShader(Result, VShader);
+    glAttachShader(Result, FShader);
+
+    // Unused names are ignored by the linker
+    glBindAttribLocation(Result, Attrib_Pos, "vPos");
+    glBindAttribLocation(Result, Attrib_Col, "vCol");
+    glBindAttribLocation(Result, Attrib_UV, "vUV");
+    glBindAttribLocation(Result, Attrib_InstModel, "iModel");
+    const char* FaceColNames[] = { "iFaceCol0", "iFaceCol1", "iFaceCol2", "iFaceCol3", "iFaceCol4", "iFaceCol5" };
+    for (GLuint FaceIdx = 0; FaceIdx < ARRAY_SIZE(FaceColNames); FaceIdx++)
+    {
+        glBindAttribLocation(Result, Attrib_InstFaceCol0 + FaceIdx, FaceColNames[FaceIdx]);
+    }
+    glBindAttribLocation(Result, Attrib_InstSpriteRect, "iRect");
+    glBindAttribLocation(Result, Attrib_InstSpriteUVRect, "iUVRect");
+    glBindAttribLocation(Result, Attrib_InstSpriteColor, "iColor");
+    glBindAttribLocation(Result, Attrib_InstSpriteDepth, "iDepth");
+
+    glLinkProgram(Result);
+
+    // Only flagged for deletion while attached, FinishProgram still wants their compile logs
+    glDeleteShader(VShader);
+    glDeleteShader(FShader);
+    return Result;
+}
+
+bool IsProgramDone(GLuint Program)
+{
+    if (!ShaderLibraryState.bParallelCompile) { return true; }
+    GLint bCompleted = GL_FALSE;
+    glGetProgramiv(Program, GL_COMPLETION_STATUS_KHR, &bCompleted);
+    return bCompleted == GL_TRUE;
+}
+
+// Blocks until the link is done; deletes the program and returns 0 if it failed
+GLuint FinishProgram(GLuint Program, const char* VShaderFilename, const char* FShaderFilename)
+{
+    GLint LinkStatus = GL_FALSE;
+    glGetProgramiv(Program, GL_LINK_STATUS, &LinkStatus);
+
+    GLuint Shaders[2] = {};
+    GLsizei NumShaders = 0;
+    glGetAttachedShaders(Program, ARRAY_SIZE(Shaders), &NumShaders, Shaders);
+    for (GLsizei ShaderIdx = 0; ShaderIdx < NumShaders; ShaderIdx++)
+    {
+        if (LinkStatus != GL_TRUE)
+        {
+            GLint ShaderType = 0;
+            glGetShaderiv(Shaders[ShaderIdx], GL_SHADER_TYPE, &ShaderType);
+            GLchar InfoLog[1024] = {};
+            glGetShaderInfoLog(Shaders[ShaderIdx], sizeof(InfoLog), nullptr, InfoLog);
+            if (InfoLog[0]) { LOGF("Compile FAILED (%s):\n%s\n", ShaderType == GL_VERTEX_SHADER ? VShaderFilename : FShaderFilename, InfoLog); }
+        }
+        // Shaders are no longer needed once linked into the program, detaching deletes them
+        glDetachShader(Program, Shaders[ShaderIdx]);
+    }
+
+    if (LinkStatus != GL_TRUE)
+    {
+        GLchar InfoLog[1024] = {};
+        glGetProgramInfoLog(Program, sizeof(InfoLog), nullptr, InfoLog);
+        LOGF("Link FAILED (%s, %s):\n%s\n", VShaderFilename, FShaderFilename, InfoLog);
+        glDeleteProgram(Program);
+        return 0;
+    }
+    return Program;
+}
+
+void BindFrameUniforms(GLuint Program)
+{
+    // GLSL 330 has no layout(binding), so every program's FrameUniforms block is pointed at the shared binding here
+    //     DEV_NOTE: Not part of the linked binary, cached programs need it too
+    GLuint FrameUniformsIdx = glGetUniformBlockIndex(Program, "FrameUniforms");
+    if (FrameUniformsIdx != GL_INVALID_INDEX)
+    {
+        glUniformBlockBinding(Program, FrameUniformsIdx, FrameUniformsBinding);
+    }
+}
+
+void ShaderCompileThread()
+{
+    Profiler::SetThreadName("Shader compile");
+    ShaderCompileWorker_t& Worker = ShaderCompileWorker;
+    glfwMakeContextCurrent(Worker.Context);
+    std::unique_lock<std::mutex> Lock(Worker.Mutex);
+    for (;;)
+    {
+        int WatchIdx = -1;
+        for (int RequestIdx = 0; RequestIdx < MaxWatchedPrograms && WatchIdx < 0; RequestIdx++)
+        {
+            if (Worker.Requests[RequestIdx].bQueued) { WatchIdx = RequestIdx; }
+        }
+        if (WatchIdx < 0)
+        {
+            if (Worker.bQuit) { break; }
+            Worker.Wake.wait(Lock);
+            continue;
+        }
+
+        ShaderCompileRequest& Request = Worker.Requests[WatchIdx];
+        Request.bQueued = false;
+        const uint32_t Serial = Request.Serial;
+        GLchar* VShaderSrc = Request.VShaderSrc;
+        GLchar* FShaderSrc = Request.FShaderSrc;
+        Request.VShaderSrc = nullptr;
+        Request.FShaderSrc = nullptr;
+        char Defines[MaxShaderDefinesLength];
+        memcpy(Defines, Request.Defines, sizeof(Defines));
+        Lock.unlock();
+
+        const GLuint Program = BeginProgram(VShaderSrc, FShaderSrc, Defines);
+        // Nothing about the program may still be in flight when the main context picks it up
+        glFinish();
+        delete[] VShaderSrc;
+        delete[] FShaderSrc;
+
+        Lock.lock();
+        // The main thread hasn't collected the previous result, it's stale by now
+        if (Request.bResultReady && Request.Result) { glDeleteProgram(Request.Result); }
+        Request.bResultReady = true;
+        Request.ResultSerial = Serial;
+        Request.Result = Program;
+    }
+    Lock.unlock();
+    glfwMakeContextCurrent(nullptr);
+}
+
+// Needs the main context current; no worker (and compiles on the render thread) if a shared context can't be made
+void StartCompileWorker()
+{
+    ShaderCompileWorker_t& Worker = ShaderCompileWorker;
+    GLFWwindow* MainWindow = glfwGetCurrentContext();
+    if (!MainWindow) { return; }
+    // Same context hints as the main window, which are still set
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    Worker.Context = glfwCreateWindow(1, 1, "LofiEngine shader compile", nullptr, MainWindow);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    if (!Worker.Context)
+    {
+        LOGF("ShaderLibrary: no shared context for the compile worker\n");
+        return;
+    }
+    Worker.bQuit = false;
+    Worker.Thread = std::thread(ShaderCompileThread);
+}
+
+void StopCompileWorker()
+{
+    ShaderCompileWorker_t& Worker = ShaderCompileWorker;
+    if (!Worker.Context) { return; }
+    {
+        std::lock_guard<std::mutex> Lock(Worker.Mutex);
+        Worker.bQuit = true;
+        // Whatever is queued is dropped, the one being compiled still finishes
+        for (ShaderCompileRequest& Request : Worker.Requests)
+        {
+            if (!Request.bQueued) { continue; }
+            delete[] Request.VShaderSrc;
+            delete[] Request.FShaderSrc;
+            Request = ShaderCompileRequest{};
+        }
+    }
+    Worker.Wake.notify_one();
+    Worker.Thread.join();
+    for (ShaderCompileRequest& Request : Worker.Requests)
+    {
+        if (Request.bResultReady && Request.Result) { glDeleteProgram(Request.Result); }
+        Request = ShaderCompileRequest{};
+    }
+    glfwDestroyWindow(Worker.Context);
+    Worker.Context = nullptr;
+}
+
+void ShaderLibrary::Init(const char* WatchDirectory)
+{
+    ShaderLibraryState.bParallelCompile = GLAD_GL_KHR_parallel_shader_compile || GLAD_GL_ARB_parallel_shader_compile;
+    if (GLAD_GL_KHR_parallel_shader_compile) { glMaxShaderCompilerThreadsKHR(0xFFFFFFFF); } // Driver's choice
+    else if (GLAD_GL_ARB_parallel_shader_compile) { glMaxShaderCompilerThreadsARB(0xFFFFFFFF); }
+
+#if LOFI_SHADER_HOT_RELOAD
+    snprintf(ShaderLibraryState.WatchDirectory, MaxShaderPathLength, "%s", WatchDirectory);
+    ShaderLibraryState.bWatching = true;
+#if LOFI_SHADER_INOTIFY
+    ShaderLibraryState.NotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    // Editors either rewrite the file in place or write a temp file and rename it over the original
+    if (ShaderLibraryState.NotifyFd < 0 || inotify_add_watch(ShaderLibraryState.NotifyFd, WatchDirectory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        LOGF("ShaderLibrary: can't watch %s, shader hot reload disabled\n", WatchDirectory);
+        if (ShaderLibraryState.NotifyFd >= 0) { close(ShaderLibraryState.NotifyFd); }
+        ShaderLibraryState.NotifyFd = -1;
+        ShaderLibraryState.bWatching = false;
+    }
+#endif
+    if (ShaderLibraryState.bWatching && !ShaderLibraryState.bParallelCompile) { StartCompileWorker(); }
+    if (ShaderLibraryState.bWatching)
+    {
+        LOGF("ShaderLibrary: watching %s (%s)\n", WatchDirectory, ShaderLibraryState.bParallelCompile ? "parallel compile" :
+            ShaderCompileWorker.Context ? "compile worker" : "compiles on the render thread");
+    }
+#else
+    (void)WatchDirectory;
+#endif
+}
+
+void ShaderLibrary::Terminate()
+{
+    StopCompileWorker();
+    for (int WatchIdx = 0; WatchIdx < ShaderLibraryState.NumWatched; WatchIdx++)
+    {
+        WatchedProgram& Watched = ShaderLibraryState.Watched[WatchIdx];
+        if (Watched.Pending) { glDeleteProgram(Watched.Pending); }
+    }
+    ShaderLibraryState.NumWatched = 0;
+    for (GLuint& Permutation : ShaderLibraryState.Permutations)
+    {
+        if (Permutation)
+        {
+            GLState::ForgetProgram(Permutation);
+            glDeleteProgram(Permutation);
+        }
+        Permutation = 0;
+    }
+#if LOFI_SHADER_INOTIFY
+    if (ShaderLibraryState.NotifyFd >= 0) { close(ShaderLibraryState.NotifyFd); }
+    ShaderLibraryState.NotifyFd = -1;
+#endif
+    ShaderLibraryState.bWatching = false;
+}
+
+GLuint ShaderLibrary::CreateProgram(const char* VShaderFilename, const char* FShaderFilename, const char* Defines)
+{
+    ShaderFileSource VShaderSrc{ VShaderFilename };
+    ShaderFileSource FShaderSrc{ FShaderFilename };
+    if (!(VShaderSrc.IsValid() && FShaderSrc.IsValid())) { return 0; }
+
+    const uint64_t CacheKey = ShaderCache::GetKey(VShaderSrc, FShaderSrc, Defines);
+    GLuint Result = ShaderCache::LoadProgram(CacheKey);
+    if (!Result)
+    {
+        const double CompileStart = glfwGetTime();
+        Result = FinishProgram(BeginProgram(VShaderSrc, FShaderSrc, Defines), VShaderFilename, FShaderFilename);
+        ShaderCache::StoreProgram(CacheKey, Result, (glfwGetTime() - CompileStart) * 1000.0);
+    }
+    if (!Result) { return 0; }
+
+    BindFrameUniforms(Result);
+    return Result;
+}
+
+void ShaderLibrary::Watch(GLuint* Program, const char* VShaderFilename, const char* FShaderFilename, const char* Defines)
+{
+    if (!ShaderLibraryState.bWatching || !Program) { return; }
+    if (ShaderLibraryState.NumWatched >= MaxWatchedPrograms) { LOGF("ShaderLibrary: watch limit reached!\n"); return; }
+
+    WatchedProgram& Watched = ShaderLibraryState.Watched[ShaderLibraryState.NumWatched++];
+    Watched = WatchedProgram{};
+    Watched.Program = Program;
+    snprintf(Watched.VShaderFilename, MaxShaderPathLength, "%s", VShaderFilename);
+    snprintf(Watched.FShaderFilename, MaxShaderPathLength, "%s", FShaderFilename);
+    snprintf(Watched.Defines, MaxShaderDefinesLength, "%s", Defines ? Defines : "");
+    Watched.VShaderTime = GetFileTime(VShaderFilename);
+    Watched.FShaderTime = GetFileTime(FShaderFilename);
+}
+
+void ShaderLibrary::CreatePermutations(const char* VShaderFilename, const char* FShaderFilename)
+{
+    for (ShaderKey Key : PrecompiledShaderKeys)
+    {
+        char Defines[MaxShaderDefinesLength];
+        GetPermutationDefines(Key, Defines);
+        GLuint& Permutation = ShaderLibraryState.Permutations[Key];
+        Permutation = CreateProgram(VShaderFilename, FShaderFilename, Defines);
+        if (!Permutation) { LOGF("ShaderLibrary: permutation 0x%X of %s + %s failed to build\n", Key, VShaderFilename, FShaderFilename); }
+        Watch(&Permutation, VShaderFilename, FShaderFilename, Defines);
+    }
+}
+
+GLuint ShaderLibrary::GetPermutation(ShaderKey Key)
+{
+    return Key < MaxShaderKeys ? ShaderLibraryState.Permutations[Key] : 0;
+}
+
+void MarkChangedFiles()
+{
+    ShaderLibraryState_t& State = ShaderLibraryState;
+#if LOFI_SHADER_INOTIFY
+    alignas(inotify_event) char Events[4096];
+    for (;;)
+    {
+        const ssize_t BytesRead = read(State.NotifyFd, Events, sizeof(Events));
+        if (BytesRead <= 0) { break; } // EAGAIN: nothing (more) changed
+
+        for (ssize_t Offset = 0; Offset < BytesRead;)
+        {
+            const inotify_event* Event = (const inotify_event*)(Events + Offset);
+            Offset += sizeof(inotify_event) + Event->len;
+            if (Event->len == 0) { continue; }
+
+            char Filename[2 * MaxShaderPathLength];
+            snprintf(Filename, sizeof(Filename), "%s/%s", State.WatchDirectory, Event->name);
+            for (int WatchIdx = 0; WatchIdx < State.NumWatched; WatchIdx++)
+            {
+                WatchedProgram& Watched = State.Watched[WatchIdx];
+                if (0 == strcmp(Filename, Watched.VShaderFilename) || 0 == strcmp(Filename, Watched.FShaderFilename))
+                {
+                    Watched.bDirty = true;
+                }
+            }
+        }
+    }
+#else
+    const double CurrTime = glfwGetTime();
+    if (CurrTime - State.LastPollTime < ShaderPollInterval) { return; }
+    State.LastPollTime = CurrTime;
+    for (int WatchIdx = 0; WatchIdx < State.NumWatched; WatchIdx++)
+    {
+        WatchedProgram& Watched = State.Watched[WatchIdx];
+        const int64_t VShaderTime = GetFileTime(Watched.VShaderFilename);
+        const int64_t FShaderTime = GetFileTime(Watched.FShaderFilename);
+        if (VShaderTime != Watched.VShaderTime || FShaderTime != Watched.FShaderTime)
+        {
+            Watched.VShaderTime = VShaderTime;
+            Watched.FShaderTime = FShaderTime;
+            Watched.bDirty = true;
+        }
+    }
+#endif
+}
+
+void StartReload(int WatchIdx)
+{
+    WatchedProgram& Watched = ShaderLibraryState.Watched[WatchIdx];
+    // A change that lands mid-reload restarts it, the newest source wins
+    if (Watched.Pending) { glDeleteProgram(Watched.Pending); }
+    Watched.Pending = 0;
+    Watched.bPendingOnWorker = false;
+    Watched.PendingSerial++;
+    Watched.ChangeTime = glfwGetTime();
+
+    ShaderFileSource VShaderSrc{ Watched.VShaderFilename };
+    ShaderFileSource FShaderSrc{ Watched.FShaderFilename };
+    if (!(VShaderSrc.IsValid() && FShaderSrc.IsValid())) { return; }
+
+    // Going back to an earlier version of a shader is a cache hit
+    Watched.PendingKey = ShaderCache::GetKey(VShaderSrc, FShaderSrc, Watched.Defines);
+    Watched.Pending = ShaderCache::LoadProgram(Watched.PendingKey);
+    Watched.bPendingFromCache = Watched.Pending != 0;
+    if (Watched.Pending) { return; }
+
+    ShaderCompileWorker_t& Worker = ShaderCompileWorker;
+    if (Worker.Context)
+    {
+        {
+            std::lock_guard<std::mutex> Lock(Worker.Mutex);
+            ShaderCompileRequest& Request = Worker.Requests[WatchIdx];
+            delete[] Request.VShaderSrc;
+            delete[] Request.FShaderSrc;
+            Request.bQueued = true;
+            Request.Serial = Watched.PendingSerial;
+            Request.VShaderSrc = VShaderSrc.Contents;
+            Request.FShaderSrc = FShaderSrc.Contents;
+            memcpy(Request.Defines, Watched.Defines, sizeof(Request.Defines));
+            VShaderSrc.Contents = nullptr;
+            FShaderSrc.Contents = nullptr;
+        }
+        Worker.Wake.notify_one();
+        Watched.bPendingOnWorker = true;
+        return;
+    }
+    Watched.Pending = BeginProgram(VShaderSrc, FShaderSrc, Watched.Defines);
+}
+
+// Hands finished worker compiles to their watched programs
+void CollectCompileResults()
+{
+    ShaderCompileWorker_t& Worker = ShaderCompileWorker;
+    if (!Worker.Context) { return; }
+    std::lock_guard<std::mutex> Lock(Worker.Mutex);
+    for (int WatchIdx = 0; WatchIdx < ShaderLibraryState.NumWatched; WatchIdx++)
+    {
+        ShaderCompileRequest& Request = Worker.Requests[WatchIdx];
+        if (!Request.bResultReady) { continue; }
+        WatchedProgram& Watched = ShaderLibraryState.Watched[WatchIdx];
+        if (Watched.bPendingOnWorker && Request.ResultSerial == Watched.PendingSerial)
+        {
+            Watched.Pending = Request.Result;
+            Watched.bPendingOnWorker = false;
+        }
+        else if (Request.Result)
+        {
+            glDeleteProgram(Request.Result);
+        }
+        Request.bResultReady = false;
+        Request.Result = 0;
+    }
+}
+
+void ShaderLibrary::Update()
+{
+    ALLOC_SCOPE("Shaders");
+    ShaderLibraryState_t& State = ShaderLibraryState;
+    if (!State.bWatching) { return; }
+
+    MarkChangedFiles();
+    CollectCompileResults();
+
+    for (int WatchIdx = 0; WatchIdx < State.NumWatched; WatchIdx++)
+    {
+        WatchedProgram& Watched = State.Watched[WatchIdx];
+        if (Watched.bDirty)
+        {
+            Watched.bDirty = false;
+            StartReload(WatchIdx);
+            // Never finished by the Update that started it: the link gets at least a frame of its own
+            continue;
+        }
+        if (!Watched.Pending || !IsProgramDone(Watched.Pending)) { continue; }
+
+        const GLuint NewProgram = FinishProgram(Watched.Pending, Watched.VShaderFilename, Watched.FShaderFilename);
+        Watched.Pending = 0;
+        const double ReloadMs = (glfwGetTime() - Watched.ChangeTime) * 1000.0;
+        if (!NewProgram)
+        {
+            State.Stats.NumFailed++;
+            LOGF("ShaderLibrary: keeping the previous %s + %s\n", Watched.VShaderFilename, Watched.FShaderFilename);
+            continue;
+        }
+        if (!Watched.bPendingFromCache) { ShaderCache::StoreProgram(Watched.PendingKey, NewProgram, ReloadMs); }
+        BindFrameUniforms(NewProgram);
+
+        if (*Watched.Program)
+        {
+            // A new program can reuse the deleted one's name, the bind cache must not skip its glUseProgram
+            GLState::ForgetProgram(*Watched.Program);
+            glDeleteProgram(*Watched.Program);
+        }
+        *Watched.Program = NewProgram;
+        State.Stats.NumReloads++;
+        State.Stats.LastReloadMs = ReloadMs;
+        LOGF("ShaderLibrary: reloaded %s + %s (%.1f ms)\n", Watched.VShaderFilename, Watched.FShaderFilename, ReloadMs);
+    }
+}
+
+const ShaderReloadStats& ShaderLibrary::GetReloadStats()
+{
+    return ShaderLibraryState.Stats;
+}
+}
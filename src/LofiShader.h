@@ -0,0 +1,93 @@
+#ifndef LOFISHADER_H
+#define LOFISHADER_H
+
+#include "Common.h"
+
+// Shader hot reload is a development feature, Release builds never watch the shader directory
+#if !defined(NDEBUG)
+#define LOFI_SHADER_HOT_RELOAD 1
+#else
+#define LOFI_SHADER_HOT_RELOAD 0
+#endif
+
+namespace Lofi
+{
+// Feature bits of the uber shader (src/glsl/uber_*.glsl), each one a LOFI_* define set to 0 or 1
+enum ShaderFeature : uint32_t
+{
+    ShaderFeature_Texture = 1 << 0, // LOFI_TEXTURE: vUV + baseTexture on unit 0
+    ShaderFeature_VertexColor = 1 << 1, // LOFI_VERTEX_COLOR: vCol
+    ShaderFeature_Instancing = 1 << 2, // LOFI_INSTANCING: per-instance face colors of the cubie grid
+    ShaderFeature_Fog = 1 << 3, // LOFI_FOG: exp2 fog from frame_uniforms::fog
+};
+constexpr int NumShaderFeatures = 4;
+
+using ShaderKey = uint32_t;
+constexpr int MaxShaderKeys = 1 << NumShaderFeatures;
+
+// Every permutation compiled up front by CreatePermutations, nothing else is ever compiled mid-frame
+constexpr ShaderKey PrecompiledShaderKeys[] = {
+    ShaderFeature_VertexColor, // Debug lines, screen-space geometry
+    ShaderFeature_VertexColor | ShaderFeature_Fog,
+    ShaderFeature_Texture | ShaderFeature_Fog,
+    ShaderFeature_Texture | ShaderFeature_Instancing | ShaderFeature_Fog,
+};
+
+constexpr bool IsPrecompiledShaderKey(ShaderKey Key)
+{
+    for (ShaderKey Precompiled : PrecompiledShaderKeys)
+    {
+        if (Precompiled == Key) { return true; }
+    }
+    return false;
+}
+
+struct ShaderReloadStats
+{
+    int NumReloads = 0;
+    int NumFailed = 0; // Reloads that didn't link, the previous program was kept
+    double LastReloadMs = 0.0; // File change noticed -> new program swapped in
+};
+
+/*
+    Programs are built from a vertex + fragment GLSL file pair, through the ShaderCache.
+        The uber shader pair is built once per precompiled ShaderKey, and draws pick a
+        permutation with an array lookup on the key.
+
+    Hot reload: Watch registers where a program's handle lives. When either of its files changes
+        (inotify on Linux, polled timestamps elsewhere), the pair is compiled again in the background:
+        with KHR/ARB_parallel_shader_compile the driver compiles on its own threads and Update only
+        polls for completion; without it a worker thread compiles on a shared context. Either way no
+        frame waits on the compiler. A program that links is swapped into the watched handle by a later
+        Update, between frames; one that doesn't logs why and the old one stays.
+*/
+struct ShaderLibrary
+{
+    static void Init(const char* WatchDirectory);
+    static void Terminate();
+
+    // 0 if a file is missing or the program doesn't link. Defines ("#define X 1\n"...) go right after the #version line.
+    static GLuint CreateProgram(const char* VShaderFilename, const char* FShaderFilename, const char* Defines = nullptr);
+    // Program must stay valid until Terminate and remains the caller's to delete after it; a program that
+    //     failed to build (0) is still watched
+    static void Watch(GLuint* Program, const char* VShaderFilename, const char* FShaderFilename, const char* Defines = nullptr);
+
+    // Builds (and watches) every PrecompiledShaderKeys permutation of the uber shader pair
+    static void CreatePermutations(const char* VShaderFilename, const char* FShaderFilename);
+    // Prefer GetPermutation<Key>(), which rejects keys missing from PrecompiledShaderKeys at compile time
+    static GLuint GetPermutation(ShaderKey Key);
+    // Once per frame before anything reads a watched handle
+    static void Update();
+
+    static const ShaderReloadStats& GetReloadStats();
+};
+
+template <ShaderKey Key>
+GLuint GetPermutation()
+{
+    static_assert(IsPrecompiledShaderKey(Key), "Shader permutation missing from PrecompiledShaderKeys");
+    return ShaderLibrary::GetPermutation(Key);
+}
+}
+
+#endif // LOFISHADER_H
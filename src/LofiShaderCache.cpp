@@ -0,0 +1,193 @@
+#include "LofiShaderCache.h"
+
+#include <cstring>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace Lofi
+{
+constexpr uint32_t ShaderCacheMagic = 0x4342504C; // "LPBC"
+// Bump when the link setup in CreateProgram (fixed attribute locations, ...) changes, the sources alone don't cover it
+constexpr uint32_t ShaderCacheVersion = 1;
+constexpr uint32_t MaxProgramBinarySize = 16 * 1024 * 1024;
+constexpr int MaxCachePathLength = 256;
+constexpr int MaxCacheDirectoryLength = MaxCachePathLength - 32; // Room for "/<key>.bin"
+
+struct ProgramBinaryHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint64_t Key;
+    uint32_t BinaryFormat;
+    uint32_t BinarySize;
+    float CompileMs; // What building it from source took, for the time-saved stats
+    uint32_t Reserved;
+};
+
+struct ShaderCacheState_t
+{
+    bool bEnabled = false;
+    char Directory[MaxCacheDirectoryLength] = {};
+    uint64_t DriverKey = 0;
+    ShaderCacheStats Stats;
+} ShaderCacheState;
+
+// FNV-1a
+constexpr uint64_t HashSeed = 0xCBF29CE484222325ull;
+
+uint64_t HashBytes(uint64_t Hash, const void* Data, size_t Size)
+{
+    const unsigned char* Bytes = (const unsigned char*)Data;
+    for (size_t Idx = 0; Idx < Size; Idx++)
+    {
+        Hash = (Hash ^ Bytes[Idx]) * 0x100000001B3ull;
+    }
+    return Hash;
+}
+
+// Length first, so ("ab", "c") and ("a", "bc") hash differently
+uint64_t HashString(uint64_t Hash, const char* String)
+{
+    const size_t Length = String ? strlen(String) : 0;
+    Hash = HashBytes(Hash, &Length, sizeof(Length));
+    return HashBytes(Hash, String, Length);
+}
+
+void GetCacheFilename(uint64_t Key, char (&OutFilename)[MaxCachePathLength])
+{
+    snprintf(OutFilename, MaxCachePathLength, "%s/%016llx.bin", ShaderCacheState.Directory, (unsigned long long)Key);
+}
+
+void ShaderCache::Init(const char* Directory)
+{
+    ShaderCacheState.bEnabled = false;
+    if (!GLAD_GL_ARB_get_program_binary)
+    {
+        LOGF("ShaderCache: ARB_get_program_binary unavailable, compiling every program from source\n");
+        return;
+    }
+    GLint NumFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &NumFormats);
+    if (NumFormats <= 0)
+    {
+        LOGF("ShaderCache: driver exposes no program binary formats, compiling every program from source\n");
+        return;
+    }
+
+    snprintf(ShaderCacheState.Directory, MaxCacheDirectoryLength, "%s", Directory);
+#if defined(_WIN32)
+    _mkdir(Directory);
+#else
+    mkdir(Directory, 0755);
+#endif
+
+    uint64_t DriverKey = HashBytes(HashSeed, &ShaderCacheVersion, sizeof(ShaderCacheVersion));
+    DriverKey = HashString(DriverKey, (const char*)glGetString(GL_VENDOR));
+    DriverKey = HashString(DriverKey, (const char*)glGetString(GL_RENDERER));
+    DriverKey = HashString(DriverKey, (const char*)glGetString(GL_VERSION));
+    ShaderCacheState.DriverKey = DriverKey;
+    ShaderCacheState.bEnabled = true;
+}
+
+uint64_t ShaderCache::GetKey(const char* VShaderSrc, const char* FShaderSrc, const char* Defines)
+{
+    uint64_t Key = HashString(ShaderCacheState.DriverKey, VShaderSrc);
+    Key = HashString(Key, FShaderSrc);
+    return HashString(Key, Defines);
+}
+
+GLuint ShaderCache::LoadProgram(uint64_t Key)
+{
+    ShaderCacheStats& Stats = ShaderCacheState.Stats;
+    if (!ShaderCacheState.bEnabled) { Stats.NumMisses++; return 0; }
+
+    const double StartTime = glfwGetTime();
+    char Filename[MaxCachePathLength];
+    GetCacheFilename(Key, Filename);
+    FILE* CacheFile = FileOpen(Filename, "rb");
+    if (!CacheFile) { Stats.NumMisses++; return 0; }
+
+    GLuint Result = 0;
+    ProgramBinaryHeader Header = {};
+    const bool bValidHeader = fread(&Header, sizeof(Header), 1, CacheFile) == 1 && Header.Magic == ShaderCacheMagic &&
+        Header.Version == ShaderCacheVersion && Header.Key == Key && Header.BinarySize > 0 && Header.BinarySize <= MaxProgramBinarySize;
+    if (bValidHeader)
+    {
+        unsigned char* Binary = new unsigned char[Header.BinarySize];
+        if (fread(Binary, 1, Header.BinarySize, CacheFile) == Header.BinarySize)
+        {
+            Result = glCreateProgram();
+            glProgramBinary(Result, Header.BinaryFormat, Binary, (GLsizei)Header.BinarySize);
+            GLint LinkStatus = GL_FALSE;
+            glGetProgramiv(Result, GL_LINK_STATUS, &LinkStatus);
+            if (LinkStatus != GL_TRUE)
+            {
+                LOGF("ShaderCache: %s rejected by the driver, recompiling\n", Filename);
+                glDeleteProgram(Result);
+                Result = 0;
+            }
+        }
+        delete[] Binary;
+    }
+    fclose(CacheFile);
+
+    if (!Result) { Stats.NumMisses++; return 0; }
+
+    const double LoadMs = (glfwGetTime() - StartTime) * 1000.0;
+    Stats.NumHits++;
+    Stats.LoadMs += LoadMs;
+    Stats.SavedMs += Header.CompileMs - LoadMs;
+    return Result;
+}
+
+void ShaderCache::MarkRetrievable(GLuint Program)
+{
+    if (ShaderCacheState.bEnabled) { glProgramParameteri(Program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE); }
+}
+
+void ShaderCache::StoreProgram(uint64_t Key, GLuint Program, double CompileMs)
+{
+    ShaderCacheState.Stats.CompileMs += CompileMs;
+    if (!ShaderCacheState.bEnabled || !Program) { return; }
+
+    GLint BinarySize = 0;
+    glGetProgramiv(Program, GL_PROGRAM_BINARY_LENGTH, &BinarySize);
+    if (BinarySize <= 0 || (uint32_t)BinarySize > MaxProgramBinarySize) { return; }
+
+    unsigned char* Binary = new unsigned char[BinarySize];
+    GLenum BinaryFormat = 0;
+    GLsizei Written = 0;
+    glGetProgramBinary(Program, BinarySize, &Written, &BinaryFormat, Binary);
+    if (Written > 0)
+    {
+        char Filename[MaxCachePathLength];
+        GetCacheFilename(Key, Filename);
+        FILE* CacheFile = FileOpen(Filename, "wb");
+        if (CacheFile)
+        {
+            const ProgramBinaryHeader Header{ ShaderCacheMagic, ShaderCacheVersion, Key, BinaryFormat, (uint32_t)Written, (float)CompileMs, 0 };
+            fwrite(&Header, sizeof(Header), 1, CacheFile);
+            fwrite(Binary, 1, Written, CacheFile);
+            fclose(CacheFile);
+        }
+        else { LOGF("ShaderCache: failed to write %s\n", Filename); }
+    }
+    delete[] Binary;
+}
+
+const ShaderCacheStats& ShaderCache::GetStats()
+{
+    return ShaderCacheState.Stats;
+}
+
+void ShaderCache::LogStats()
+{
+    const ShaderCacheStats& Stats = ShaderCacheState.Stats;
+    LOGF("ShaderCache: %d/%d programs from cache in %.2f ms (%.2f ms saved), %d compiled in %.2f ms\n",
+        Stats.NumHits, Stats.NumHits + Stats.NumMisses, Stats.LoadMs, Stats.SavedMs, Stats.NumMisses, Stats.CompileMs);
+}
+}
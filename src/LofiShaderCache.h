@@ -0,0 +1,41 @@
+#ifndef LOFISHADERCACHE_H
+#define LOFISHADERCACHE_H
+
+#include "Common.h"
+
+namespace Lofi
+{
+struct ShaderCacheStats
+{
+    int NumHits = 0;
+    int NumMisses = 0;
+    double LoadMs = 0.0; // Creating programs from cached binaries
+    double CompileMs = 0.0; // Compiling + linking the misses
+    double SavedMs = 0.0; // Recorded compile time of each hit, minus what loading it took
+};
+
+/*
+    Linked program binaries (ARB_get_program_binary) kept on disk, one file per program.
+        Keys hash the shader sources together with the driver's vendor/renderer/version, so an
+        edited shader or a driver update simply misses and the program gets compiled again.
+    Every failure (no extension, no binary formats, stale or corrupt file, rejected binary) is a
+        miss, callers always have the compile-from-source path to fall back on.
+*/
+struct ShaderCache
+{
+    static void Init(const char* Directory);
+
+    // Defines (may be null) are part of the key, each permutation of a shader pair is its own entry
+    static uint64_t GetKey(const char* VShaderSrc, const char* FShaderSrc, const char* Defines);
+    // Linked program, or 0 on a miss
+    static GLuint LoadProgram(uint64_t Key);
+    // Call before linking a program that will be stored
+    static void MarkRetrievable(GLuint Program);
+    static void StoreProgram(uint64_t Key, GLuint Program, double CompileMs);
+
+    static const ShaderCacheStats& GetStats();
+    static void LogStats();
+};
+}
+
+#endif // LOFISHADERCACHE_H
@@ -0,0 +1,181 @@
+#include "LofiSimulation.h"
+
+#include "LofiAllocTracker.h"
+#include "LofiProfiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+namespace Lofi
+{
+constexpr float TwoPi = 6.28318531f;
+constexpr float CameraOrbitSpeed = 1.0f; // Radians per second
+constexpr float SpriteScrollSpeed = 0.05f; // Screen widths per second
+
+// Or'ed into the middle slot index when it holds a packet the reader hasn't taken yet
+constexpr uint32_t FreshPacketBit = 4;
+
+struct SimulationState_t
+{
+    // Simulation thread only
+    SimState Previous;
+    SimState Current;
+    double LastRealTime = 0.0;
+    double Accumulator = 0.0;
+    SimStats Stats;
+    uint32_t WriteIdx = 0;
+
+    // Render thread only
+    uint32_t ReadIdx = 1;
+
+    FramePacket Packets[3];
+    std::atomic<uint32_t> MiddleIdx{ 2 };
+    std::atomic<bool> bRunning{ false };
+    std::thread Thread;
+} SimulationState;
+
+float WrapToPeriod(float Value, float Period)
+{
+    Value = fmodf(Value, Period);
+    return Value < 0.0f ? Value + Period : Value;
+}
+
+// Takes the short way around, so a value that just wrapped doesn't sweep back through the whole period
+float LerpWrapped(float From, float To, float Alpha, float Period)
+{
+    float Delta = To - From;
+    if (Delta > Period * 0.5f) { Delta -= Period; }
+    else if (Delta < -Period * 0.5f) { Delta += Period; }
+    return WrapToPeriod(From + Delta * Alpha, Period);
+}
+
+void StepSimulation(SimState& State)
+{
+    const float Dt = (float)SimTimestep;
+    State.tick++;
+    State.time = State.tick * SimTimestep;
+    State.camera_angle = WrapToPeriod(State.camera_angle + CameraOrbitSpeed * Dt, TwoPi);
+    State.sprite_scroll = WrapToPeriod(State.sprite_scroll + SpriteScrollSpeed * Dt, 1.0f);
+}
+
+// Runs every whole step the real time since the last call covers, returns how many
+int AdvanceSimulation(double RealTime)
+{
+    SimulationState_t& State = SimulationState;
+    State.Accumulator += RealTime - State.LastRealTime;
+    State.LastRealTime = RealTime;
+
+    int NumSteps = 0;
+    while (State.Accumulator >= SimTimestep)
+    {
+        if (NumSteps == MaxSimStepsPerFrame)
+        {
+            const double Kept = fmod(State.Accumulator, SimTimestep);
+            State.Stats.DroppedSeconds += State.Accumulator - Kept;
+            State.Accumulator = Kept;
+            break;
+        }
+        PROFILE_SCOPE("SimStep");
+        State.Previous = State.Current;
+        StepSimulation(State.Current);
+        State.Accumulator -= SimTimestep;
+        NumSteps++;
+    }
+    State.Stats.NumSteps += NumSteps;
+    State.Stats.LastFrameSteps = NumSteps;
+    return NumSteps;
+}
+
+// Simulation thread: fill the write slot, then swap it with the middle one
+void PublishPacket()
+{
+    SimulationState_t& State = SimulationState;
+    FramePacket& Packet = State.Packets[State.WriteIdx];
+    Packet.previous = State.Previous;
+    Packet.current = State.Current;
+    Packet.current_time = State.LastRealTime - State.Accumulator;
+    Packet.stats = State.Stats;
+    // Release: the reader's acquire exchange sees the packet contents along with the index
+    State.WriteIdx = State.MiddleIdx.exchange(State.WriteIdx | FreshPacketBit, std::memory_order_acq_rel) & ~FreshPacketBit;
+}
+
+// Render thread: swap the read slot for the middle one if that has been published since
+const FramePacket& AcquirePacket()
+{
+    SimulationState_t& State = SimulationState;
+    if (State.MiddleIdx.load(std::memory_order_relaxed) & FreshPacketBit)
+    {
+        State.ReadIdx = State.MiddleIdx.exchange(State.ReadIdx, std::memory_order_acq_rel) & ~FreshPacketBit;
+    }
+    return State.Packets[State.ReadIdx];
+}
+
+void SimulationThread()
+{
+    Profiler::SetThreadName("Simulation");
+    ALLOC_SCOPE("Simulation");
+    SimulationState_t& State = SimulationState;
+    while (State.bRunning.load(std::memory_order_acquire))
+    {
+        if (AdvanceSimulation(glfwGetTime()) > 0) { PublishPacket(); }
+
+        // DEV_NOTE: Windows' default timer resolution can oversleep by a few ms; the next
+        //     Advance catches up and the render side clamps its interpolation meanwhile
+        const double UntilNextStep = SimTimestep - State.Accumulator;
+        std::this_thread::sleep_for(std::chrono::duration<double>(UntilNextStep > 0.0 ? UntilNextStep : 0.0));
+    }
+}
+
+void Simulation::Init(double RealTime)
+{
+    SimulationState_t& State = SimulationState;
+    State.Previous = SimState{};
+    State.Current = SimState{};
+    State.LastRealTime = RealTime;
+    State.Accumulator = 0.0;
+    State.Stats = SimStats{};
+
+    // Every slot starts out as the initial state, so the reader has something before the first publish
+    for (FramePacket& Packet : State.Packets)
+    {
+        Packet = FramePacket{};
+        Packet.current_time = RealTime;
+    }
+    State.WriteIdx = 0;
+    State.ReadIdx = 1;
+    State.MiddleIdx.store(2, std::memory_order_relaxed);
+
+    State.bRunning.store(true, std::memory_order_release);
+    State.Thread = std::thread(SimulationThread);
+}
+
+void Simulation::Terminate()
+{
+    SimulationState_t& State = SimulationState;
+    State.bRunning.store(false, std::memory_order_release);
+    if (State.Thread.joinable()) { State.Thread.join(); }
+}
+
+SimState Simulation::GetRenderState(double RealTime)
+{
+    const FramePacket& Packet = AcquirePacket();
+    // Past 1 the simulation is late, hold the current step rather than extrapolate
+    float Alpha = (float)((RealTime - Packet.current_time) / SimTimestep);
+    Alpha = Alpha < 0.0f ? 0.0f : (Alpha > 1.0f ? 1.0f : Alpha);
+
+    const SimState& Previous = Packet.previous;
+    const SimState& Current = Packet.current;
+    SimState Result = Current;
+    Result.time = Previous.time + (Current.time - Previous.time) * Alpha;
+    Result.camera_angle = LerpWrapped(Previous.camera_angle, Current.camera_angle, Alpha, TwoPi);
+    Result.sprite_scroll = LerpWrapped(Previous.sprite_scroll, Current.sprite_scroll, Alpha, 1.0f);
+    return Result;
+}
+
+const SimStats& Simulation::GetStats()
+{
+    return SimulationState.Packets[SimulationState.ReadIdx].stats;
+}
+}
@@ -0,0 +1,60 @@
+#ifndef LOFISIMULATION_H
+#define LOFISIMULATION_H
+
+#include "Common.h"
+
+namespace Lofi
+{
+// Everything Graphics::Draw animates, only ever changed by whole simulation steps
+struct SimState
+{
+    uint64_t tick = 0;
+    double time = 0.0; // Simulated seconds, tick * SimTimestep
+    float camera_angle = 0.0f; // Orbit around the Y axis, radians in [0, 2pi)
+    float sprite_scroll = 0.0f; // Horizontal drift of the benchmark sprites, in screen widths [0, 1)
+};
+
+struct SimStats
+{
+    uint64_t NumSteps = 0;
+    int LastFrameSteps = 0;
+    // Real time thrown away because a frame needed more than MaxSimStepsPerFrame steps
+    double DroppedSeconds = 0.0;
+};
+
+// What the simulation thread hands the render thread, never modified once published
+struct FramePacket
+{
+    SimState previous;
+    SimState current;
+    double current_time = 0.0; // Real time the current step stands for
+    SimStats stats;
+};
+
+constexpr double SimTimestep = 1.0 / 60.0;
+// After a long stall (debugger, window drag) the simulation falls behind instead of spiraling into ever longer frames
+constexpr int MaxSimStepsPerFrame = 8;
+
+/*
+    Fixed-rate simulation: real time accumulates and is consumed in SimTimestep steps, so the
+        simulation behaves the same at any frame rate. Rendering sits between the last two steps
+        and interpolates them by how far real time has moved past the current one.
+    The steps run on their own thread. After each batch of steps it publishes a FramePacket into a
+        lock-free triple buffer: one slot being written, one being read, one holding the latest
+        publish. Neither side ever waits on the other, the render thread just draws from the
+        newest packet it has.
+*/
+struct Simulation
+{
+    // Starts the simulation thread; RealTime must come from the clock later passed to GetRenderState
+    static void Init(double RealTime);
+    static void Terminate();
+
+    // Render thread only: the latest packet, previous step blended towards current for RealTime
+    static SimState GetRenderState(double RealTime);
+    // Render thread only: as of the packet the last GetRenderState used
+    static const SimStats& GetStats();
+};
+}
+
+#endif // LOFISIMULATION_H
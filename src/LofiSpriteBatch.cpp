@@ -0,0 +1,174 @@
+#include "LofiSpriteBatch.h"
+#include "LofiAllocTracker.h"
+#include "LofiDynamicRing.h"
+#include "LofiMesh.h"
+#include "LofiRenderQueue.h"
+
+#include <cstring>
+
+namespace Lofi
+{
+constexpr int MaxSprites = 64 * 1024;
+constexpr int MaxSpriteTextures = 256;
+
+// Unit quad in the ortho camera's space (+Y up), UVs follow stb_image's top-down rows
+const vxtex SpriteQuadVerts[] =
+{
+    vxtex{{ 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f }},
+    vxtex{{ 1.0f, 0.0f, 0.0f }, { 1.0f, 1.0f }},
+    vxtex{{ 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f }},
+    vxtex{{ 1.0f, 1.0f, 0.0f }, { 1.0f, 0.0f }},
+};
+// DEV_NOTE: CCW is front-facing
+const GLuint SpriteQuadInds[] =
+{
+    0, 1, 3,
+    0, 3, 2,
+};
+
+struct SpriteBatchState_t
+{
+    sprite_instance Sprites[MaxSprites];
+    uint8_t TextureSlots[MaxSprites];
+    uint32_t Sorted[MaxSprites];
+    int NumSprites = 0;
+
+    // Texture names seen this frame -> dense slot, the sort key
+    GLuint Textures[MaxSpriteTextures];
+    int NumTextures = 0;
+    bool bOverflowLogged = false;
+    bool bTextureOverflowLogged = false;
+
+    MeshHandle quad_mesh = InvalidMesh;
+    SpriteBatchStats Stats;
+} SpriteBatchState;
+
+void SpriteBatch::Init()
+{
+    SpriteBatchState.quad_mesh = MeshRegistry::Create(VertexFormat::VxTex, SpriteQuadVerts, ARRAY_SIZE(SpriteQuadVerts),
+        SpriteQuadInds, ARRAY_SIZE(SpriteQuadInds));
+
+    // Instances are streamed through the dynamic ring, each batch indexes its run by base instance
+    const VertexAttribDesc SpriteAttribs[] =
+    {
+        { Attrib_InstSpriteRect, 4, GL_FLOAT, GL_FALSE, offsetof(sprite_instance, rect) },
+        { Attrib_InstSpriteUVRect, 4, GL_FLOAT, GL_FALSE, offsetof(sprite_instance, uv_rect) },
+        { Attrib_InstSpriteColor, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(sprite_instance, color) },
+        { Attrib_InstSpriteDepth, 1, GL_FLOAT, GL_FALSE, offsetof(sprite_instance, depth) },
+    };
+    MeshRegistry::AddInstanceStream(SpriteBatchState.quad_mesh, DynamicRing::GetBuffer(), sizeof(sprite_instance),
+        SpriteAttribs, ARRAY_SIZE(SpriteAttribs));
+}
+
+// -1 once MaxSpriteTextures distinct textures are in this frame's slots
+int GetSpriteTextureSlot(GLuint Texture)
+{
+    // Sprites tend to arrive in runs of the same texture, check the most recent slot first
+    const int NumTextures = SpriteBatchState.NumTextures;
+    if (NumTextures > 0 && SpriteBatchState.Textures[NumTextures - 1] == Texture) { return NumTextures - 1; }
+    for (int SlotIdx = 0; SlotIdx < NumTextures; SlotIdx++)
+    {
+        if (SpriteBatchState.Textures[SlotIdx] == Texture) { return SlotIdx; }
+    }
+    if (NumTextures < MaxSpriteTextures)
+    {
+        SpriteBatchState.Textures[NumTextures] = Texture;
+        SpriteBatchState.NumTextures++;
+        return NumTextures;
+    }
+    return -1;
+}
+
+void SpriteBatch::Draw(GLuint Texture, v2f Pos, v2f Size, v4f UVRect, uint32_t Color, int Layer)
+{
+    if (SpriteBatchState.NumSprites >= MaxSprites)
+    {
+        if (!SpriteBatchState.bOverflowLogged) { LOGF("SpriteBatch: sprite limit reached, dropping sprites!\n"); }
+        SpriteBatchState.bOverflowLogged = true;
+        return;
+    }
+    // Every slot is taken by another texture, sharing one would draw these sprites with the wrong texture
+    const int TextureSlot = GetSpriteTextureSlot(Texture);
+    if (TextureSlot < 0)
+    {
+        if (!SpriteBatchState.bTextureOverflowLogged)
+        {
+            LOGF("SpriteBatch: more than %d textures in a frame, dropping sprites!\n", MaxSpriteTextures);
+        }
+        SpriteBatchState.bTextureOverflowLogged = true;
+        return;
+    }
+
+    // Screen camera looks down -Z over [-1, 1]: keep every layer in front of the near half so HUD
+    //     sprites also win against whatever the world pass left in the depth buffer
+    if (Layer < 0) { Layer = 0; }
+    if (Layer >= MaxSpriteLayers) { Layer = MaxSpriteLayers - 1; }
+    const float Depth = 0.5f + 0.49f * ((float)Layer / (float)(MaxSpriteLayers - 1));
+
+    const int SpriteIdx = SpriteBatchState.NumSprites++;
+    SpriteBatchState.Sprites[SpriteIdx] = sprite_instance{ v4f{ Pos.X, Pos.Y, Size.X, Size.Y }, UVRect, Color, Depth };
+    SpriteBatchState.TextureSlots[SpriteIdx] = (uint8_t)TextureSlot;
+}
+
+void SpriteBatch::Flush(GLuint SpriteProgram)
+{
+    ALLOC_SCOPE("SpriteBatch");
+    const int NumSprites = SpriteBatchState.NumSprites;
+    const int NumTextures = SpriteBatchState.NumTextures;
+    SpriteBatchState.NumSprites = 0;
+    SpriteBatchState.NumTextures = 0;
+    SpriteBatchState.bOverflowLogged = false;
+    SpriteBatchState.bTextureOverflowLogged = false;
+    SpriteBatchState.Stats = {};
+    if (NumSprites == 0 || !SpriteProgram) { return; }
+
+    // Counting sort by texture slot, stable so submission order is kept within a batch
+    int Offsets[MaxSpriteTextures + 1] = {};
+    for (int SpriteIdx = 0; SpriteIdx < NumSprites; SpriteIdx++)
+    {
+        Offsets[SpriteBatchState.TextureSlots[SpriteIdx] + 1]++;
+    }
+    for (int SlotIdx = 0; SlotIdx < NumTextures; SlotIdx++)
+    {
+        Offsets[SlotIdx + 1] += Offsets[SlotIdx];
+    }
+    int BatchStarts[MaxSpriteTextures + 1];
+    memcpy(BatchStarts, Offsets, sizeof(BatchStarts));
+    for (int SpriteIdx = 0; SpriteIdx < NumSprites; SpriteIdx++)
+    {
+        SpriteBatchState.Sorted[Offsets[SpriteBatchState.TextureSlots[SpriteIdx]]++] = (uint32_t)SpriteIdx;
+    }
+
+    // Aligned to the instance size so the ring offset is a whole base instance
+    DynamicAlloc SpriteAlloc = DynamicRing::Alloc(sizeof(sprite_instance) * NumSprites, sizeof(sprite_instance));
+    if (!SpriteAlloc.IsValid()) { LOGF("SpriteBatch: dynamic ring full, %d sprites dropped!\n", NumSprites); return; }
+    sprite_instance* Instances = (sprite_instance*)SpriteAlloc.ptr;
+    for (int SortedIdx = 0; SortedIdx < NumSprites; SortedIdx++)
+    {
+        Instances[SortedIdx] = SpriteBatchState.Sprites[SpriteBatchState.Sorted[SortedIdx]];
+    }
+    const GLuint BaseInstance = (GLuint)(SpriteAlloc.offset / sizeof(sprite_instance));
+
+    for (int SlotIdx = 0; SlotIdx < NumTextures; SlotIdx++)
+    {
+        const int BatchSize = BatchStarts[SlotIdx + 1] - BatchStarts[SlotIdx];
+        if (BatchSize == 0) { continue; }
+
+        DrawPacket Packet;
+        Packet.camera = Camera_Screen;
+        Packet.program = SpriteProgram;
+        Packet.texture = SpriteBatchState.Textures[SlotIdx];
+        Packet.mesh = SpriteBatchState.quad_mesh;
+        Packet.num_instances = BatchSize;
+        Packet.base_instance = BaseInstance + (GLuint)BatchStarts[SlotIdx];
+        RenderQueue::Submit(Packet);
+        SpriteBatchState.Stats.NumBatches++;
+    }
+    SpriteBatchState.Stats.NumSprites = NumSprites;
+}
+
+const SpriteBatchStats& SpriteBatch::GetStats()
+{
+    return SpriteBatchState.Stats;
+}
+}
@@ -0,0 +1,45 @@
+#ifndef LOFISPRITEBATCH_H
+#define LOFISPRITEBATCH_H
+
+#include "Common.h"
+#include "LofiGraphics.h"
+
+namespace Lofi
+{
+// Per-instance data of the sprite pipeline, one per quad
+struct sprite_instance
+{
+    v4f rect; // xy: bottom-left, zw: size (screen camera units)
+    v4f uv_rect; // xy: UV of the top-left texel corner, zw: bottom-right (rows top-down, as loaded by stb_image)
+    uint32_t color; // RGBA8 tint
+    float depth;
+};
+
+struct SpriteBatchStats
+{
+    int NumSprites = 0;
+    int NumBatches = 0; // Draws issued, one per distinct texture
+};
+
+constexpr int MaxSpriteLayers = 256;
+
+/*
+    Immediate-mode quads for the Camera_Screen (orthographic) pass, e.g. HUD elements.
+        Sprites are accumulated on the CPU, stably sorted by texture on Flush, then streamed
+        through the DynamicRing and drawn as one instanced unit quad per texture.
+
+    Layer (0 = back) maps to depth rather than draw order and the pipeline is alpha-tested,
+        so overlapping sprites composite correctly no matter how the batches end up ordered.
+*/
+struct SpriteBatch
+{
+    static void Init();
+    static void Draw(GLuint Texture, v2f Pos, v2f Size, v4f UVRect = v4f{ 0.0f, 0.0f, 1.0f, 1.0f },
+        uint32_t Color = 0xFFFFFFFF, int Layer = 0);
+    // Submits this frame's sprites to the RenderQueue and clears them
+    static void Flush(GLuint SpriteProgram);
+    static const SpriteBatchStats& GetStats();
+};
+}
+
+#endif // LOFISPRITEBATCH_H
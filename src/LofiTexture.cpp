@@ -0,0 +1,475 @@
+#include "LofiTexture.h"
+#include "LofiAllocTracker.h"
+#include "LofiGLState.h"
+
+#include <cstring>
+
+namespace Lofi
+{
+constexpr int MaxTrackedTextures = 256;
+
+struct TrackedTexture
+{
+    GLuint Texture;
+    int64_t Bytes;
+    int64_t UncompressedBytes;
+};
+
+struct TextureState_t
+{
+    TrackedTexture Tracked[MaxTrackedTextures];
+    int NumTracked = 0;
+    TextureMemoryStats Stats;
+} TextureState;
+
+struct ContainerFormat
+{
+    GLenum InternalFormat;
+    GLenum PixelFormat; // 0 for block-compressed formats
+    int BlockDim; // 4x4 texel blocks, or 1 for plain texels
+    int BlockBytes;
+    bool bHasAlpha;
+    const char* Name;
+};
+
+const ContainerFormat Format_BC1{ GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 0, 4, 8, false, "BC1" };
+const ContainerFormat Format_BC3{ GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 0, 4, 16, true, "BC3" };
+const ContainerFormat Format_BC7{ GL_COMPRESSED_RGBA_BPTC_UNORM_ARB, 0, 4, 16, true, "BC7" };
+const ContainerFormat Format_ETC2_RGB{ GL_COMPRESSED_RGB8_ETC2, 0, 4, 8, false, "ETC2" };
+const ContainerFormat Format_ETC2_RGBA{ GL_COMPRESSED_RGBA8_ETC2_EAC, 0, 4, 16, true, "ETC2+EAC" };
+const ContainerFormat Format_RGB8{ GL_RGB8, GL_RGB, 1, 3, false, "RGB8" };
+const ContainerFormat Format_RGBA8{ GL_RGBA8, GL_RGBA, 1, 4, true, "RGBA8" };
+
+bool IsFormatSupported(const ContainerFormat& Format)
+{
+    switch (Format.InternalFormat)
+    {
+        case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: return GLAD_GL_EXT_texture_compression_s3tc != 0;
+        case GL_COMPRESSED_RGBA_BPTC_UNORM_ARB: return GLAD_GL_ARB_texture_compression_bptc != 0;
+        case GL_COMPRESSED_RGB8_ETC2:
+        case GL_COMPRESSED_RGBA8_ETC2_EAC: return GLAD_GL_ARB_ES3_compatibility != 0;
+        case GL_RGB8:
+        case GL_RGBA8: return true;
+    }
+    return false;
+}
+
+GLsizeiptr GetLevelSize(const ContainerFormat& Format, int Width, int Height)
+{
+    const int BlockDim = Format.BlockDim;
+    const GLsizeiptr BlocksX = (GLsizeiptr)HMM_MAX(1, (Width + BlockDim - 1) / BlockDim);
+    const GLsizeiptr BlocksY = (GLsizeiptr)HMM_MAX(1, (Height + BlockDim - 1) / BlockDim);
+    return BlocksX * BlocksY * Format.BlockBytes;
+}
+
+struct ContainerImage
+{
+    const ContainerFormat* Format = nullptr;
+    int Width = 0;
+    int Height = 0;
+    int NumLevels = 0;
+    const unsigned char* Levels[MaxTextureLevels] = {};
+    GLsizeiptr LevelSizes[MaxTextureLevels] = {};
+};
+
+uint32_t ReadU32(const unsigned char* Data)
+{
+    uint32_t Result = 0;
+    memcpy(&Result, Data, sizeof(Result));
+    return Result;
+}
+
+uint64_t ReadU64(const unsigned char* Data)
+{
+    uint64_t Result = 0;
+    memcpy(&Result, Data, sizeof(Result));
+    return Result;
+}
+
+constexpr uint32_t MakeFourCC(char A, char B, char C, char D)
+{
+    return (uint32_t)(unsigned char)A | ((uint32_t)(unsigned char)B << 8) | ((uint32_t)(unsigned char)C << 16) | ((uint32_t)(unsigned char)D << 24);
+}
+
+/*
+    DDS: "DDS " + 124 byte DDS_HEADER (+ 20 byte DDS_HEADER_DXT10 when FourCC is "DX10"),
+        then every mip level back to back, largest first
+*/
+// Sizes straight from a file header; level sizes are computed in ints and GL takes GLsizei dimensions
+bool IsValidTextureSize(uint32_t Width, uint32_t Height)
+{
+    return Width > 0 && Height > 0 && Width <= (uint32_t)MaxTextureDimension && Height <= (uint32_t)MaxTextureDimension;
+}
+
+bool ParseDDS(const unsigned char* Data, size_t Size, ContainerImage& OutImage)
+{
+    constexpr size_t HeaderSize = 4 + 124;
+    if (Size < HeaderSize || ReadU32(Data) != MakeFourCC('D', 'D', 'S', ' ') || ReadU32(Data + 4) != 124) { return false; }
+
+    if (!IsValidTextureSize(ReadU32(Data + 4 + 12), ReadU32(Data + 4 + 8))) { return false; }
+    const int Height = (int)ReadU32(Data + 4 + 8);
+    const int Width = (int)ReadU32(Data + 4 + 12);
+    const int MipCount = (int)ReadU32(Data + 4 + 24);
+    const uint32_t FourCC = ReadU32(Data + 4 + 72 + 8); // DDS_PIXELFORMAT starts at 72
+
+    size_t DataOffset = HeaderSize;
+    const ContainerFormat* Format = nullptr;
+    if (FourCC == MakeFourCC('D', 'X', 'T', '1')) { Format = &Format_BC1; }
+    else if (FourCC == MakeFourCC('D', 'X', 'T', '5')) { Format = &Format_BC3; }
+    else if (FourCC == MakeFourCC('D', 'X', '1', '0'))
+    {
+        if (Size < HeaderSize + 20) { return false; }
+        switch (ReadU32(Data + HeaderSize)) // DXGI_FORMAT
+        {
+            case 71: case 72: Format = &Format_BC1; break; // BC1_UNORM(_SRGB)
+            case 77: case 78: Format = &Format_BC3; break; // BC3_UNORM(_SRGB)
+            case 98: case 99: Format = &Format_BC7; break; // BC7_UNORM(_SRGB)
+        }
+        DataOffset += 20;
+    }
+    if (!Format) { return false; }
+
+    OutImage.Format = Format;
+    OutImage.Width = Width;
+    OutImage.Height = Height;
+    OutImage.NumLevels = HMM_MIN(HMM_MAX(MipCount, 1), MaxTextureLevels);
+    for (int LevelIdx = 0; LevelIdx < OutImage.NumLevels; LevelIdx++)
+    {
+        const GLsizeiptr LevelSize = GetLevelSize(*Format, HMM_MAX(1, Width >> LevelIdx), HMM_MAX(1, Height >> LevelIdx));
+        if (DataOffset + LevelSize > Size) { return false; }
+        OutImage.Levels[LevelIdx] = Data + DataOffset;
+        OutImage.LevelSizes[LevelIdx] = LevelSize;
+        DataOffset += LevelSize;
+    }
+    return true;
+}
+
+/*
+    KTX2: 12 byte identifier, 36 byte header, 32 byte index, then a level index of
+        { byteOffset, byteLength, uncompressedByteLength } per mip, level 0 (largest) first
+*/
+bool ParseKTX2(const unsigned char* Data, size_t Size, ContainerImage& OutImage)
+{
+    static const unsigned char KTX2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+    constexpr size_t LevelIndexOffset = 12 + 36 + 32;
+    if (Size < LevelIndexOffset || memcmp(Data, KTX2Identifier, sizeof(KTX2Identifier)) != 0) { return false; }
+
+    const uint32_t VkFormat = ReadU32(Data + 12);
+    const uint32_t PixelWidth = ReadU32(Data + 20);
+    const uint32_t PixelHeight = ReadU32(Data + 24);
+    const uint32_t LayerCount = ReadU32(Data + 32);
+    const uint32_t FaceCount = ReadU32(Data + 36);
+    const int LevelCount = (int)ReadU32(Data + 40);
+    const uint32_t Supercompression = ReadU32(Data + 44);
+    if (Supercompression != 0 || LayerCount > 1 || FaceCount != 1) { return false; }
+    if (!IsValidTextureSize(PixelWidth, PixelHeight)) { return false; }
+    const int Width = (int)PixelWidth;
+    const int Height = (int)PixelHeight;
+
+    const ContainerFormat* Format = nullptr;
+    switch (VkFormat)
+    {
+        case 131: case 132: case 133: case 134: Format = &Format_BC1; break; // VK_FORMAT_BC1_RGB(A)_UNORM/SRGB_BLOCK
+        case 137: case 138: Format = &Format_BC3; break; // VK_FORMAT_BC3_UNORM/SRGB_BLOCK
+        case 145: case 146: Format = &Format_BC7; break; // VK_FORMAT_BC7_UNORM/SRGB_BLOCK
+        case 147: case 148: Format = &Format_ETC2_RGB; break; // VK_FORMAT_ETC2_R8G8B8_UNORM/SRGB_BLOCK
+        case 151: case 152: Format = &Format_ETC2_RGBA; break; // VK_FORMAT_ETC2_R8G8B8A8_UNORM/SRGB_BLOCK
+        case 23: case 29: Format = &Format_RGB8; break; // VK_FORMAT_R8G8B8_UNORM/SRGB, cooked
+        case 37: case 43: Format = &Format_RGBA8; break; // VK_FORMAT_R8G8B8A8_UNORM/SRGB, cooked
+    }
+    if (!Format) { return false; }
+
+    OutImage.Format = Format;
+    OutImage.Width = Width;
+    OutImage.Height = Height;
+    OutImage.NumLevels = HMM_MIN(HMM_MAX(LevelCount, 1), MaxTextureLevels);
+    if (Size < LevelIndexOffset + 24 * (size_t)OutImage.NumLevels) { return false; }
+    for (int LevelIdx = 0; LevelIdx < OutImage.NumLevels; LevelIdx++)
+    {
+        const unsigned char* LevelEntry = Data + LevelIndexOffset + 24 * LevelIdx;
+        const uint64_t ByteOffset = ReadU64(LevelEntry);
+        const uint64_t ByteLength = ReadU64(LevelEntry + 8);
+        const GLsizeiptr ExpectedSize = GetLevelSize(*Format, HMM_MAX(1, Width >> LevelIdx), HMM_MAX(1, Height >> LevelIdx));
+        // Both come from the file, compare without adding so a huge offset can't wrap past the check
+        if (ByteOffset > Size || ByteLength > Size - ByteOffset || (GLsizeiptr)ByteLength != ExpectedSize) { return false; }
+        OutImage.Levels[LevelIdx] = Data + ByteOffset;
+        OutImage.LevelSizes[LevelIdx] = (GLsizeiptr)ByteLength;
+    }
+    return true;
+}
+
+void SetDefaultSampling(GLuint Texture, bool bMipmapped)
+{
+    const GLint MinFilter = bMipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR;
+    if (GLState::HasDSA())
+    {
+        glTextureParameteri(Texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTextureParameteri(Texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTextureParameteri(Texture, GL_TEXTURE_MIN_FILTER, MinFilter);
+        glTextureParameteri(Texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+    else
+    {
+        // Expects Texture to be bound to GL_TEXTURE_2D
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, MinFilter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+}
+
+TextureSource::~TextureSource()
+{
+    if (DecodedPixels) { stbi_image_free(DecodedPixels); }
+}
+
+bool TextureLoader::IsContainerFile(const char* Filename)
+{
+    const char* Extension = strrchr(Filename, '.');
+    if (!Extension) { return false; }
+    return 0 == strcmp(Extension, ".ktx2") || 0 == strcmp(Extension, ".KTX2") ||
+        0 == strcmp(Extension, ".dds") || 0 == strcmp(Extension, ".DDS");
+}
+
+bool TextureLoader::ReadContainer(const char* Filename, TextureSource& OutSource)
+{
+    // Levels point straight into the mapping, nothing is copied or decoded on the CPU
+    if (!OutSource.File.Map(Filename)) { return false; }
+
+    ContainerImage Image;
+    const unsigned char* Data = OutSource.File.Data;
+    const size_t Size = OutSource.File.Size;
+    const bool bParsed = ParseKTX2(Data, Size, Image) || ParseDDS(Data, Size, Image);
+    if (!bParsed || Image.Width <= 0 || Image.Height <= 0)
+    {
+        LOGF("TextureLoader: %s is not a supported DDS/KTX2 file\n", Filename);
+        return false;
+    }
+    const ContainerFormat& Format = *Image.Format;
+    if (!IsFormatSupported(Format))
+    {
+        LOGF("TextureLoader: %s is %s, unsupported by this driver\n", Filename, Format.Name);
+        return false;
+    }
+
+    OutSource.InternalFormat = Format.InternalFormat;
+    OutSource.PixelFormat = Format.PixelFormat;
+    OutSource.FormatName = Format.Name;
+    OutSource.Width = Image.Width;
+    OutSource.Height = Image.Height;
+    OutSource.NumLevels = Image.NumLevels;
+    OutSource.NumStorageLevels = Image.NumLevels;
+    OutSource.Bytes = 0;
+    OutSource.UncompressedBytes = 0;
+    const int UncompressedTexelBytes = Format.bHasAlpha ? 4 : 3;
+    for (int LevelIdx = 0; LevelIdx < Image.NumLevels; LevelIdx++)
+    {
+        OutSource.Levels[LevelIdx] = Image.Levels[LevelIdx];
+        OutSource.LevelSizes[LevelIdx] = Image.LevelSizes[LevelIdx];
+        OutSource.Bytes += Image.LevelSizes[LevelIdx];
+        OutSource.UncompressedBytes += (int64_t)HMM_MAX(1, Image.Width >> LevelIdx) * HMM_MAX(1, Image.Height >> LevelIdx) * UncompressedTexelBytes;
+    }
+    return true;
+}
+
+bool TextureLoader::ReadImage(const char* Filename, TextureSource& OutSource)
+{
+    // Grey(+alpha) files are expanded, so every decode is RGB8 or RGBA8
+    int Width = 0, Height = 0, Channels = 0;
+    if (!stbi_info(Filename, &Width, &Height, &Channels)) { return false; }
+    const bool bHasAlpha = Channels == 2 || Channels == 4;
+    const int TexelBytes = bHasAlpha ? 4 : 3;
+    OutSource.DecodedPixels = stbi_load(Filename, &Width, &Height, &Channels, TexelBytes);
+    if (!OutSource.DecodedPixels) { return false; }
+
+    OutSource.InternalFormat = bHasAlpha ? GL_RGBA8 : GL_RGB8;
+    OutSource.PixelFormat = bHasAlpha ? GL_RGBA : GL_RGB;
+    OutSource.FormatName = bHasAlpha ? "RGBA8" : "RGB8";
+    OutSource.Width = Width;
+    OutSource.Height = Height;
+    OutSource.NumLevels = 1;
+    OutSource.NumStorageLevels = 1;
+    for (int Dim = HMM_MAX(Width, Height); Dim > 1; Dim >>= 1) { OutSource.NumStorageLevels++; }
+    OutSource.NumStorageLevels = HMM_MIN(OutSource.NumStorageLevels, MaxTextureLevels);
+    OutSource.Levels[0] = OutSource.DecodedPixels;
+    OutSource.LevelSizes[0] = (GLsizeiptr)Width * Height * TexelBytes;
+    OutSource.Bytes = 0;
+    for (int LevelIdx = 0; LevelIdx < OutSource.NumStorageLevels; LevelIdx++)
+    {
+        OutSource.Bytes += (int64_t)HMM_MAX(1, Width >> LevelIdx) * HMM_MAX(1, Height >> LevelIdx) * TexelBytes;
+    }
+    OutSource.UncompressedBytes = OutSource.Bytes;
+    return true;
+}
+
+GLuint TextureLoader::CreateTexture(const TextureSource& Source)
+{
+    // GL calls only, texture storage is the driver's to allocate
+    ALLOC_EXEMPT_SCOPE("TextureLoader GL");
+    GLuint Result = 0;
+    if (GLState::HasDSA())
+    {
+        glCreateTextures(GL_TEXTURE_2D, 1, &Result);
+        glTextureStorage2D(Result, Source.NumStorageLevels, Source.InternalFormat, Source.Width, Source.Height);
+        glTextureParameteri(Result, GL_TEXTURE_MAX_LEVEL, Source.NumStorageLevels - 1);
+    }
+    else
+    {
+        // Levels are specified (and allocated) as they're uploaded
+        glGenTextures(1, &Result);
+        GLState::BindTexture2D(0, Result);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, Source.NumStorageLevels - 1);
+    }
+    SetDefaultSampling(Result, Source.NumStorageLevels > 1);
+    return Result;
+}
+
+void TextureLoader::UploadLevel(GLuint Texture, const TextureSource& Source, int LevelIdx, const void* Data)
+{
+    const GLsizei LevelWidth = HMM_MAX(1, Source.Width >> LevelIdx);
+    const GLsizei LevelHeight = HMM_MAX(1, Source.Height >> LevelIdx);
+    const GLsizei LevelSize = (GLsizei)Source.LevelSizes[LevelIdx];
+    ALLOC_EXEMPT_SCOPE("TextureLoader GL");
+
+    // DEV_NOTE: Rows of RGB8 images aren't necessarily 4-byte aligned
+    const bool bUnaligned = Source.PixelFormat == GL_RGB;
+    if (bUnaligned) { glPixelStorei(GL_UNPACK_ALIGNMENT, 1); }
+    if (GLState::HasDSA())
+    {
+        if (Source.PixelFormat)
+        {
+            glTextureSubImage2D(Texture, LevelIdx, 0, 0, LevelWidth, LevelHeight, Source.PixelFormat, GL_UNSIGNED_BYTE, Data);
+        }
+        else
+        {
+            glCompressedTextureSubImage2D(Texture, LevelIdx, 0, 0, LevelWidth, LevelHeight, Source.InternalFormat, LevelSize, Data);
+        }
+    }
+    else
+    {
+        GLState::BindTexture2D(0, Texture);
+        if (Source.PixelFormat)
+        {
+            glTexImage2D(GL_TEXTURE_2D, LevelIdx, Source.InternalFormat, LevelWidth, LevelHeight, 0,
+                Source.PixelFormat, GL_UNSIGNED_BYTE, Data);
+        }
+        else
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, LevelIdx, Source.InternalFormat, LevelWidth, LevelHeight, 0, LevelSize, Data);
+        }
+    }
+    if (bUnaligned) { glPixelStorei(GL_UNPACK_ALIGNMENT, 4); }
+}
+
+void TextureLoader::FinishTexture(GLuint Texture, const TextureSource& Source)
+{
+    if (Source.NumStorageLevels > Source.NumLevels)
+    {
+        ALLOC_EXEMPT_SCOPE("TextureLoader GL");
+        if (GLState::HasDSA()) { glGenerateTextureMipmap(Texture); }
+        else
+        {
+            GLState::BindTexture2D(0, Texture);
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
+    }
+    TrackMemory(Texture, Source.Bytes, Source.UncompressedBytes);
+}
+
+GLuint TextureLoader::CreateSolid(uint32_t Texel)
+{
+    GLuint Result = 0;
+    if (GLState::HasDSA())
+    {
+        glCreateTextures(GL_TEXTURE_2D, 1, &Result);
+        glTextureParameteri(Result, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTextureParameteri(Result, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTextureStorage2D(Result, 1, GL_RGBA8, 1, 1);
+        glTextureSubImage2D(Result, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, &Texel);
+    }
+    else
+    {
+        glGenTextures(1, &Result);
+        GLState::BindTexture2D(0, Result);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &Texel);
+    }
+    TrackMemory(Result, sizeof(Texel), sizeof(Texel));
+    return Result;
+}
+
+GLuint TextureLoader::LoadContainer(const char* Filename)
+{
+    TextureSource Source;
+    if (!ReadContainer(Filename, Source)) { return 0; }
+
+    const GLuint Result = CreateTexture(Source);
+    for (int LevelIdx = 0; LevelIdx < Source.NumLevels; LevelIdx++)
+    {
+        UploadLevel(Result, Source, LevelIdx, Source.Levels[LevelIdx]);
+    }
+    FinishTexture(Result, Source);
+
+    LOGF("TextureLoader: %s (%s, %dx%d, %d levels)\n", Filename, Source.FormatName, Source.Width, Source.Height, Source.NumLevels);
+    return Result;
+}
+
+GLuint TextureLoader::LoadImage(const char* Filename)
+{
+    TextureSource Source;
+    if (!ReadImage(Filename, Source)) { return 0; }
+
+    const GLuint Result = CreateTexture(Source);
+    UploadLevel(Result, Source, 0, Source.Levels[0]);
+    FinishTexture(Result, Source);
+
+    LOGF("TextureLoader: %s (%s, %dx%d, %d levels)\n", Filename, Source.FormatName, Source.Width, Source.Height, Source.NumStorageLevels);
+    return Result;
+}
+
+void TextureLoader::TrackMemory(GLuint Texture, int64_t Bytes, int64_t UncompressedBytes)
+{
+    if (!Texture) { return; }
+    if (TextureState.NumTracked >= MaxTrackedTextures) { LOGF("TextureLoader: tracking limit reached!\n"); return; }
+
+    TextureState.Tracked[TextureState.NumTracked++] = TrackedTexture{ Texture, Bytes, UncompressedBytes };
+    TextureState.Stats.NumTextures++;
+    TextureState.Stats.Bytes += Bytes;
+    TextureState.Stats.UncompressedBytes += UncompressedBytes;
+}
+
+void TextureLoader::Delete(GLuint& Texture)
+{
+    if (!Texture) { return; }
+    for (int TrackedIdx = 0; TrackedIdx < TextureState.NumTracked; TrackedIdx++)
+    {
+        const TrackedTexture& Tracked = TextureState.Tracked[TrackedIdx];
+        if (Tracked.Texture != Texture) { continue; }
+
+        TextureState.Stats.NumTextures--;
+        TextureState.Stats.Bytes -= Tracked.Bytes;
+        TextureState.Stats.UncompressedBytes -= Tracked.UncompressedBytes;
+        TextureState.Tracked[TrackedIdx] = TextureState.Tracked[--TextureState.NumTracked];
+        break;
+    }
+    GLState::ForgetTexture(Texture);
+    glDeleteTextures(1, &Texture);
+    Texture = 0;
+}
+
+const TextureMemoryStats& TextureLoader::GetMemoryStats()
+{
+    return TextureState.Stats;
+}
+
+void TextureLoader::LogMemoryStats()
+{
+    const TextureMemoryStats& Stats = TextureState.Stats;
+    const double KB = 1.0 / 1024.0;
+    const double Saved = Stats.UncompressedBytes > 0 ? 100.0 * (1.0 - (double)Stats.Bytes / (double)Stats.UncompressedBytes) : 0.0;
+    LOGF("Texture memory: %d textures, %.1f KB (uncompressed: %.1f KB, %.1f%% saved)\n",
+        Stats.NumTextures, Stats.Bytes * KB, Stats.UncompressedBytes * KB, Saved);
+}
+}
@@ -0,0 +1,83 @@
+#ifndef LOFITEXTURE_H
+#define LOFITEXTURE_H
+
+#include "Common.h"
+#include "LofiMappedFile.h"
+
+namespace Lofi
+{
+constexpr int MaxTextureLevels = 16;
+constexpr int MaxTextureDimension = 1 << (MaxTextureLevels - 1); // Containers claiming more are rejected
+
+struct TextureMemoryStats
+{
+    int NumTextures = 0;
+    int64_t Bytes = 0; // What the textures actually occupy
+    int64_t UncompressedBytes = 0; // What the same textures would take as RGB8/RGBA8
+};
+
+/*
+    CPU half of a texture load: a mapped DDS/KTX2 file or a stb_image decode, plus what the GL
+        texture needs to look like. Filled by the Read* functions on any thread, turned into a
+        texture with CreateTexture/UploadLevel/FinishTexture on the GL thread.
+*/
+struct TextureSource
+{
+    GLenum InternalFormat = 0;
+    GLenum PixelFormat = 0; // 0 for block-compressed formats
+    const char* FormatName = "";
+    int Width = 0;
+    int Height = 0;
+    int NumLevels = 0; // Levels held by the source
+    int NumStorageLevels = 0; // Levels of the texture, the ones past NumLevels are generated on the GPU
+    const unsigned char* Levels[MaxTextureLevels] = {};
+    GLsizeiptr LevelSizes[MaxTextureLevels] = {};
+    int64_t Bytes = 0; // Of the whole texture once created
+    int64_t UncompressedBytes = 0;
+
+    // Backing storage for Levels
+    MappedFile File;
+    unsigned char* DecodedPixels = nullptr;
+
+    TextureSource() = default;
+    TextureSource(const TextureSource&) = delete;
+    TextureSource& operator=(const TextureSource&) = delete;
+    ~TextureSource();
+};
+
+struct TextureLoader
+{
+    /*
+        Prebuilt textures, memory-mapped and uploaded level by level with every mip in the file:
+            DDS: DXT1/DXT5 FourCC, or DX10 header with BC1/BC3/BC7
+            KTX2: BC1/BC3/BC7/ETC2 vkFormats, or RGB8/RGBA8 as written by tools/LofiCook; no supercompression
+        Returns 0 if the file is missing/malformed or the driver can't sample its format,
+            so callers can fall through a list of candidates (e.g. BC7, then ETC2, then a JPG).
+    */
+    static GLuint LoadContainer(const char* Filename);
+    // stb_image decode, uploaded as RGB8/RGBA8 with a generated mip chain
+    static GLuint LoadImage(const char* Filename);
+
+    // Thread-safe halves of LoadContainer/LoadImage, no GL calls
+    static bool ReadContainer(const char* Filename, TextureSource& OutSource);
+    static bool ReadImage(const char* Filename, TextureSource& OutSource);
+    static bool IsContainerFile(const char* Filename);
+
+    // GL thread: storage + sampling state, then every source level, then the generated mips.
+    //     Data is a client pointer, or an offset while a GL_PIXEL_UNPACK_BUFFER is bound.
+    static GLuint CreateTexture(const TextureSource& Source);
+    static void UploadLevel(GLuint Texture, const TextureSource& Source, int LevelIdx, const void* Data);
+    static void FinishTexture(GLuint Texture, const TextureSource& Source);
+
+    // 1x1 RGBA8, nearest filtered, e.g. white for untextured sprites
+    static GLuint CreateSolid(uint32_t Texel);
+
+    // Textures created elsewhere can report their size here to show up in GetMemoryStats
+    static void TrackMemory(GLuint Texture, int64_t Bytes, int64_t UncompressedBytes);
+    static void Delete(GLuint& Texture);
+    static const TextureMemoryStats& GetMemoryStats();
+    static void LogMemoryStats();
+};
+}
+
+#endif // LOFITEXTURE_H
@@ -0,0 +1,169 @@
+#include "LofiTextureAtlas.h"
+#include "LofiGLState.h"
+#include "LofiTexture.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace Lofi
+{
+constexpr int MaxAtlasRegions = 1024;
+
+struct TextureAtlasState_t
+{
+    GLuint texture = 0;
+    int width = 0;
+    int height = 0;
+
+    AtlasRegion Regions[MaxAtlasRegions];
+    int NumRegions = 0;
+} TextureAtlasState;
+
+// Parses up to MaxInts whitespace-separated integers, returns how many were read
+// DEV_NOTE: strtol rather than sscanf, the latter is deprecated under MSVC's /sdl
+int ParseInts(const char* Str, int* OutInts, int MaxInts)
+{
+    int NumInts = 0;
+    while (NumInts < MaxInts)
+    {
+        char* End = nullptr;
+        const long Value = strtol(Str, &End, 10);
+        if (End == Str) { break; }
+        OutInts[NumInts++] = (int)Value;
+        Str = End;
+    }
+    return NumInts;
+}
+
+bool LoadAtlasTable(const char* TableFilename)
+{
+    FILE* TableFile = FileOpen(TableFilename, "rb");
+    if (!TableFile) { return false; }
+
+    bool bResult = false;
+    char Line[256] = {};
+    int ExpectedRegions = 0;
+    while (fgets(Line, sizeof(Line), TableFile))
+    {
+        if (Line[0] == '#' || Line[0] == '\n' || Line[0] == '\r') { continue; }
+        if (0 == strncmp(Line, "atlas ", 6))
+        {
+            int Header[3] = {};
+            bResult = ARRAY_SIZE(Header) == ParseInts(Line + 6, Header, ARRAY_SIZE(Header));
+            TextureAtlasState.width = Header[0];
+            TextureAtlasState.height = Header[1];
+            ExpectedRegions = Header[2];
+            continue;
+        }
+        if (!bResult || TextureAtlasState.width <= 0 || TextureAtlasState.height <= 0) { bResult = false; break; }
+        if (TextureAtlasState.NumRegions >= MaxAtlasRegions) { LOGF("TextureAtlas: region limit reached!\n"); break; }
+
+        // <name> <x> <y> <width> <height>
+        const size_t NameLength = strcspn(Line, " \t");
+        int Rect[4] = {};
+        if (NameLength == 0 || NameLength >= sizeof(AtlasRegion::name) ||
+            ARRAY_SIZE(Rect) != ParseInts(Line + NameLength, Rect, ARRAY_SIZE(Rect))) { continue; }
+
+        AtlasRegion& Region = TextureAtlasState.Regions[TextureAtlasState.NumRegions++];
+        memcpy(Region.name, Line, NameLength);
+        Region.name[NameLength] = 0;
+        Region.width = Rect[2];
+        Region.height = Rect[3];
+
+        const float InvWidth = 1.0f / (float)TextureAtlasState.width;
+        const float InvHeight = 1.0f / (float)TextureAtlasState.height;
+        Region.uv_rect = v4f{ Rect[0] * InvWidth, Rect[1] * InvHeight, (Rect[0] + Rect[2]) * InvWidth, (Rect[1] + Rect[3]) * InvHeight };
+    }
+    fclose(TableFile);
+
+    if (bResult && TextureAtlasState.NumRegions != ExpectedRegions)
+    {
+        LOGF("TextureAtlas: %s lists %d regions, read %d\n", TableFilename, ExpectedRegions, TextureAtlasState.NumRegions);
+    }
+    return bResult && TextureAtlasState.NumRegions > 0;
+}
+
+bool TextureAtlas::Load(const char* ImageFilename, const char* TableFilename)
+{
+    Terminate();
+    if (!LoadAtlasTable(TableFilename))
+    {
+        LOGF("TextureAtlas: no atlas table at %s\n", TableFilename);
+        TextureAtlasState.NumRegions = 0;
+        return false;
+    }
+
+    int Width = 0, Height = 0, Channels = 0;
+    unsigned char* AtlasData = stbi_load(ImageFilename, &Width, &Height, &Channels, 4);
+    if (!AtlasData || Width != TextureAtlasState.width || Height != TextureAtlasState.height)
+    {
+        LOGF("TextureAtlas: %s missing or doesn't match %s\n", ImageFilename, TableFilename);
+        if (AtlasData) { stbi_image_free(AtlasData); }
+        TextureAtlasState.NumRegions = 0;
+        return false;
+    }
+
+    // DEV_NOTE: No mips, regions are padded + edge-extruded by the packer for bilinear only
+    if (GLState::HasDSA())
+    {
+        glCreateTextures(GL_TEXTURE_2D, 1, &TextureAtlasState.texture);
+        const GLuint Texture = TextureAtlasState.texture;
+        glTextureParameteri(Texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(Texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(Texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTextureParameteri(Texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureStorage2D(Texture, 1, GL_RGBA8, Width, Height);
+        glTextureSubImage2D(Texture, 0, 0, 0, Width, Height, GL_RGBA, GL_UNSIGNED_BYTE, AtlasData);
+    }
+    else
+    {
+        glGenTextures(1, &TextureAtlasState.texture);
+        GLState::BindTexture2D(0, TextureAtlasState.texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, Width, Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, AtlasData);
+    }
+    stbi_image_free(AtlasData);
+    TextureLoader::TrackMemory(TextureAtlasState.texture, (int64_t)Width * Height * 4, (int64_t)Width * Height * 4);
+
+    LOGF("TextureAtlas: %d regions, %dx%d\n", TextureAtlasState.NumRegions, Width, Height);
+    return true;
+}
+
+void TextureAtlas::Terminate()
+{
+    TextureLoader::Delete(TextureAtlasState.texture);
+    TextureAtlasState.NumRegions = 0;
+}
+
+GLuint TextureAtlas::GetTexture()
+{
+    return TextureAtlasState.texture;
+}
+
+int TextureAtlas::FindRegion(const char* Name)
+{
+    for (int RegionIdx = 0; RegionIdx < TextureAtlasState.NumRegions; RegionIdx++)
+    {
+        if (0 == strcmp(TextureAtlasState.Regions[RegionIdx].name, Name)) { return RegionIdx; }
+    }
+    return InvalidAtlasRegion;
+}
+
+int TextureAtlas::GetNumRegions()
+{
+    return TextureAtlasState.texture ? TextureAtlasState.NumRegions : 0;
+}
+
+const AtlasRegion* TextureAtlas::GetRegion(int RegionIdx)
+{
+    const AtlasRegion* Result = nullptr;
+    if (TextureAtlasState.texture && RegionIdx >= 0 && RegionIdx < TextureAtlasState.NumRegions)
+    {
+        Result = &TextureAtlasState.Regions[RegionIdx];
+    }
+    return Result;
+}
+}
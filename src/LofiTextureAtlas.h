@@ -0,0 +1,36 @@
+#ifndef LOFITEXTUREATLAS_H
+#define LOFITEXTUREATLAS_H
+
+#include "Common.h"
+#include "LofiGraphics.h"
+
+namespace Lofi
+{
+struct AtlasRegion
+{
+    char name[64];
+    v4f uv_rect; // Same convention as sprite_instance::uv_rect
+    int width; // Texels
+    int height;
+};
+
+constexpr int InvalidAtlasRegion = -1;
+
+/*
+    Runtime side of tools/LofiAtlas: one RGBA8 texture holding every packed image, plus the table
+        of named sub-rects. Sprites drawn from it all share a texture, so they end up in one batch.
+    Resolve names with FindRegion once at init and keep the indices, lookups are linear.
+*/
+struct TextureAtlas
+{
+    static bool Load(const char* ImageFilename, const char* TableFilename);
+    static void Terminate();
+
+    static GLuint GetTexture();
+    static int FindRegion(const char* Name);
+    static int GetNumRegions();
+    static const AtlasRegion* GetRegion(int RegionIdx);
+};
+}
+
+#endif // LOFITEXTUREATLAS_H
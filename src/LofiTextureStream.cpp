@@ -0,0 +1,368 @@
+#include "LofiTextureStream.h"
+#include "LofiAllocTracker.h"
+#include "LofiProfiler.h"
+#include "LofiTexture.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+namespace Lofi
+{
+constexpr int MaxStreamWorkers = 4;
+constexpr int MaxStreamFilenameLength = 256;
+// Textures bigger than the whole ring are uploaded straight from their source instead
+constexpr GLsizeiptr StreamRingSize = 32 * 1024 * 1024;
+// Soft limit, the first upload of an Update always goes through
+constexpr GLsizeiptr StreamBytesPerUpdate = 8 * 1024 * 1024;
+constexpr GLsizeiptr StreamLevelAlignment = 16;
+constexpr uint32_t StreamPlaceholderTexel = 0xFF808080; // Opaque mid gray
+
+enum StreamStatus : int
+{
+    Stream_Free,
+    Stream_Queued, // Waiting for / owned by a worker
+    Stream_Decoded, // Source ready, waiting for ring space
+    Stream_Uploading,
+    Stream_Ready,
+    Stream_Failed,
+};
+
+struct StreamSlot
+{
+    std::atomic<int> Status{ Stream_Free };
+    char Filenames[MaxStreamCandidates][MaxStreamFilenameLength];
+    int NumFilenames = 0;
+    int LoadedIdx = -1; // Candidate that loaded
+
+    TextureSource* Source = nullptr; // Written by the worker before Status becomes Stream_Decoded
+    GLuint Texture = 0;
+    GLsync Fence = nullptr;
+    GLsizeiptr RingBytes = 0; // Ring space held until Fence signals, including any tail skipped to wrap
+};
+
+struct TextureStreamState_t
+{
+    // DEV_NOTE: Slots are never reused, so both queues below are plain arrays that never wrap
+    StreamSlot Slots[MaxStreamedTextures];
+    int NumSlots = 0;
+
+    std::thread Workers[MaxStreamWorkers];
+    int NumWorkers = 0;
+    std::mutex QueueMutex;
+    std::condition_variable QueueCondition;
+    int Queue[MaxStreamedTextures];
+    int QueueHead = 0;
+    int QueueTail = 0;
+    bool bQuit = false;
+
+    // Uploads in issue order, retired front to back as their fences signal
+    int Uploading[MaxStreamedTextures];
+    int UploadingHead = 0;
+    int UploadingTail = 0;
+
+    GLuint PlaceholderTexture = 0;
+    GLuint RingBuffer = 0;
+    unsigned char* RingMapped = nullptr; // Persistent mapping, nullptr when each upload maps its range
+    GLsizeiptr RingHead = 0;
+    GLsizeiptr RingUsed = 0;
+
+    double InitTime = 0.0;
+    TextureStreamStats Stats;
+} TextureStreamState;
+
+void StreamWorker(int WorkerIdx)
+{
+    TextureStreamState_t& State = TextureStreamState;
+    char ThreadName[32];
+    snprintf(ThreadName, sizeof(ThreadName), "TextureStream %d", WorkerIdx);
+    Profiler::SetThreadName(ThreadName);
+    ALLOC_SCOPE("TextureStream");
+    for (;;)
+    {
+        int SlotIdx = -1;
+        {
+            std::unique_lock<std::mutex> Lock(State.QueueMutex);
+            State.QueueCondition.wait(Lock, [&State] { return State.bQuit || State.QueueHead < State.QueueTail; });
+            if (State.bQuit) { return; }
+            SlotIdx = State.Queue[State.QueueHead++];
+        }
+
+        PROFILE_SCOPE("TextureStream decode");
+        StreamSlot& Slot = State.Slots[SlotIdx];
+        TextureSource* Source = nullptr;
+        for (int FileIdx = 0; FileIdx < Slot.NumFilenames && !Source; FileIdx++)
+        {
+            const char* Filename = Slot.Filenames[FileIdx];
+            Source = new TextureSource;
+            const bool bRead = TextureLoader::IsContainerFile(Filename) ?
+                TextureLoader::ReadContainer(Filename, *Source) :
+                TextureLoader::ReadImage(Filename, *Source);
+            if (bRead) { Slot.LoadedIdx = FileIdx; }
+            else
+            {
+                delete Source;
+                Source = nullptr;
+            }
+        }
+        if (!Source) { LOGF("TextureStream: no loadable candidate for %s\n", Slot.Filenames[0]); }
+
+        Slot.Source = Source;
+        Slot.Status.store(Source ? Stream_Decoded : Stream_Failed, std::memory_order_release);
+    }
+}
+
+bool TextureStream::Init()
+{
+    TextureStreamState_t& State = TextureStreamState;
+    State.InitTime = glfwGetTime();
+    State.PlaceholderTexture = TextureLoader::CreateSolid(StreamPlaceholderTexel);
+
+    glGenBuffers(1, &State.RingBuffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, State.RingBuffer);
+    if (GLAD_GL_ARB_buffer_storage)
+    {
+        const GLbitfield Flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, StreamRingSize, nullptr, Flags);
+        State.RingMapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, StreamRingSize, Flags);
+    }
+    else
+    {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, StreamRingSize, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    const int NumCores = (int)std::thread::hardware_concurrency();
+    State.NumWorkers = HMM_MIN(HMM_MAX(NumCores - 1, 1), MaxStreamWorkers);
+    State.bQuit = false;
+    for (int WorkerIdx = 0; WorkerIdx < State.NumWorkers; WorkerIdx++)
+    {
+        State.Workers[WorkerIdx] = std::thread(StreamWorker, WorkerIdx);
+    }
+    return true;
+}
+
+void TextureStream::Terminate()
+{
+    TextureStreamState_t& State = TextureStreamState;
+    {
+        std::lock_guard<std::mutex> Lock(State.QueueMutex);
+        State.bQuit = true;
+    }
+    State.QueueCondition.notify_all();
+    for (int WorkerIdx = 0; WorkerIdx < State.NumWorkers; WorkerIdx++)
+    {
+        State.Workers[WorkerIdx].join();
+    }
+    State.NumWorkers = 0;
+
+    for (int SlotIdx = 0; SlotIdx < State.NumSlots; SlotIdx++)
+    {
+        StreamSlot& Slot = State.Slots[SlotIdx];
+        delete Slot.Source;
+        Slot.Source = nullptr;
+        if (Slot.Fence) { glDeleteSync(Slot.Fence); }
+        Slot.Fence = nullptr;
+        TextureLoader::Delete(Slot.Texture);
+        Slot.Status.store(Stream_Free);
+    }
+    State.NumSlots = 0;
+    State.QueueHead = State.QueueTail = 0;
+    State.UploadingHead = State.UploadingTail = 0;
+
+    if (State.RingMapped)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, State.RingBuffer);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        State.RingMapped = nullptr;
+    }
+    glDeleteBuffers(1, &State.RingBuffer);
+    State.RingBuffer = 0;
+    State.RingHead = State.RingUsed = 0;
+    TextureLoader::Delete(State.PlaceholderTexture);
+}
+
+StreamedTexture TextureStream::Request(const char* const* Filenames, int NumFilenames)
+{
+    TextureStreamState_t& State = TextureStreamState;
+    if (State.NumWorkers == 0 || NumFilenames <= 0) { return InvalidStreamedTexture; }
+    if (State.NumSlots >= MaxStreamedTextures) { LOGF("TextureStream: texture limit reached!\n"); return InvalidStreamedTexture; }
+
+    const int SlotIdx = State.NumSlots++;
+    StreamSlot& Slot = State.Slots[SlotIdx];
+    Slot.NumFilenames = HMM_MIN(NumFilenames, MaxStreamCandidates);
+    for (int FileIdx = 0; FileIdx < Slot.NumFilenames; FileIdx++)
+    {
+        snprintf(Slot.Filenames[FileIdx], MaxStreamFilenameLength, "%s", Filenames[FileIdx]);
+    }
+    Slot.LoadedIdx = -1;
+    Slot.Status.store(Stream_Queued);
+
+    {
+        std::lock_guard<std::mutex> Lock(State.QueueMutex);
+        State.Queue[State.QueueTail++] = SlotIdx;
+    }
+    State.QueueCondition.notify_one();
+    return SlotIdx;
+}
+
+// Returns false if the ring has no room until earlier uploads retire
+bool StartUpload(int SlotIdx)
+{
+    TextureStreamState_t& State = TextureStreamState;
+    StreamSlot& Slot = State.Slots[SlotIdx];
+    const TextureSource& Source = *Slot.Source;
+
+    GLsizeiptr LevelOffsets[MaxTextureLevels] = {};
+    GLsizeiptr UploadSize = 0;
+    for (int LevelIdx = 0; LevelIdx < Source.NumLevels; LevelIdx++)
+    {
+        LevelOffsets[LevelIdx] = UploadSize;
+        UploadSize += (Source.LevelSizes[LevelIdx] + StreamLevelAlignment - 1) & ~(StreamLevelAlignment - 1);
+    }
+
+    // Each upload is contiguous in the ring, one that doesn't fit before the end skips the tail and wraps
+    const bool bUseRing = UploadSize <= StreamRingSize;
+    GLsizeiptr RingOffset = 0;
+    GLsizeiptr RingBytes = 0;
+    if (bUseRing)
+    {
+        if (State.RingUsed == 0) { State.RingHead = 0; }
+        RingOffset = State.RingHead;
+        RingBytes = UploadSize;
+        if (RingOffset + UploadSize > StreamRingSize)
+        {
+            RingBytes += StreamRingSize - RingOffset;
+            RingOffset = 0;
+        }
+        if (State.RingUsed + RingBytes > StreamRingSize) { return false; }
+        State.RingHead = RingOffset + UploadSize;
+        State.RingUsed += RingBytes;
+    }
+
+    Slot.Texture = TextureLoader::CreateTexture(Source);
+    unsigned char* RingData = nullptr;
+    if (bUseRing)
+    {
+        ALLOC_EXEMPT_SCOPE("TextureStream GL");
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, State.RingBuffer);
+        RingData = State.RingMapped ? State.RingMapped + RingOffset :
+            (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, RingOffset, UploadSize,
+                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    }
+    if (RingData)
+    {
+        for (int LevelIdx = 0; LevelIdx < Source.NumLevels; LevelIdx++)
+        {
+            memcpy(RingData + LevelOffsets[LevelIdx], Source.Levels[LevelIdx], Source.LevelSizes[LevelIdx]);
+        }
+        if (!State.RingMapped)
+        {
+            ALLOC_EXEMPT_SCOPE("TextureStream GL");
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        for (int LevelIdx = 0; LevelIdx < Source.NumLevels; LevelIdx++)
+        {
+            const void* Offset = (const void*)(uintptr_t)(RingOffset + LevelOffsets[LevelIdx]);
+            TextureLoader::UploadLevel(Slot.Texture, Source, LevelIdx, Offset);
+        }
+    }
+    if (bUseRing) { glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0); }
+    if (!RingData)
+    {
+        // Too big for the ring (or the map failed): the driver copies it out of client memory instead
+        for (int LevelIdx = 0; LevelIdx < Source.NumLevels; LevelIdx++)
+        {
+            TextureLoader::UploadLevel(Slot.Texture, Source, LevelIdx, Source.Levels[LevelIdx]);
+        }
+    }
+    TextureLoader::FinishTexture(Slot.Texture, Source);
+
+    {
+        ALLOC_EXEMPT_SCOPE("TextureStream GL");
+        Slot.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    Slot.RingBytes = RingBytes;
+    Slot.Status.store(Stream_Uploading);
+    State.Uploading[State.UploadingTail++] = SlotIdx;
+    State.Stats.BytesUploaded += UploadSize;
+
+    LOGF("TextureStream: %s (%s, %dx%d, %d levels)\n", Slot.Filenames[Slot.LoadedIdx], Source.FormatName,
+        Source.Width, Source.Height, Source.NumStorageLevels);
+    delete Slot.Source;
+    Slot.Source = nullptr;
+    return true;
+}
+
+void TextureStream::Update()
+{
+    TextureStreamState_t& State = TextureStreamState;
+    TextureStreamStats& Stats = State.Stats;
+    Stats.BytesUploaded = 0;
+
+    // Retire in issue order, which also frees ring space in the order it was handed out
+    bool bRetired = false;
+    while (State.UploadingHead < State.UploadingTail)
+    {
+        StreamSlot& Slot = State.Slots[State.Uploading[State.UploadingHead]];
+        {
+            ALLOC_EXEMPT_SCOPE("TextureStream GL");
+            if (glClientWaitSync(Slot.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED) { break; }
+            glDeleteSync(Slot.Fence);
+        }
+        Slot.Fence = nullptr;
+        State.RingUsed -= Slot.RingBytes;
+        Slot.RingBytes = 0;
+        Slot.Status.store(Stream_Ready);
+        State.UploadingHead++;
+        Stats.LastReadyMs = (glfwGetTime() - State.InitTime) * 1000.0;
+        bRetired = true;
+    }
+
+    // Request order, stopping at the first one the ring can't take yet
+    for (int SlotIdx = 0; SlotIdx < State.NumSlots && Stats.BytesUploaded < StreamBytesPerUpdate; SlotIdx++)
+    {
+        if (State.Slots[SlotIdx].Status.load(std::memory_order_acquire) != Stream_Decoded) { continue; }
+        if (!StartUpload(SlotIdx)) { break; }
+    }
+
+    Stats.NumPending = Stats.NumUploading = Stats.NumReady = Stats.NumFailed = 0;
+    for (int SlotIdx = 0; SlotIdx < State.NumSlots; SlotIdx++)
+    {
+        switch (State.Slots[SlotIdx].Status.load(std::memory_order_relaxed))
+        {
+            case Stream_Queued: case Stream_Decoded: Stats.NumPending++; break;
+            case Stream_Uploading: Stats.NumUploading++; break;
+            case Stream_Ready: Stats.NumReady++; break;
+            case Stream_Failed: Stats.NumFailed++; break;
+        }
+    }
+    if (bRetired && Stats.NumPending == 0 && Stats.NumUploading == 0)
+    {
+        LOGF("TextureStream: %d textures ready after %.1f ms\n", Stats.NumReady, Stats.LastReadyMs);
+        TextureLoader::LogMemoryStats();
+    }
+}
+
+GLuint TextureStream::GetTexture(StreamedTexture Handle)
+{
+    const TextureStreamState_t& State = TextureStreamState;
+    if (Handle < 0 || Handle >= State.NumSlots) { return State.PlaceholderTexture; }
+    const StreamSlot& Slot = State.Slots[Handle];
+    return Slot.Status.load(std::memory_order_relaxed) == Stream_Ready ? Slot.Texture : State.PlaceholderTexture;
+}
+
+bool TextureStream::IsReady(StreamedTexture Handle)
+{
+    const TextureStreamState_t& State = TextureStreamState;
+    return Handle >= 0 && Handle < State.NumSlots && State.Slots[Handle].Status.load(std::memory_order_relaxed) == Stream_Ready;
+}
+
+const TextureStreamStats& TextureStream::GetStats()
+{
+    return TextureStreamState.Stats;
+}
+}
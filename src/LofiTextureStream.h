@@ -0,0 +1,51 @@
+#ifndef LOFITEXTURESTREAM_H
+#define LOFITEXTURESTREAM_H
+
+#include "Common.h"
+
+namespace Lofi
+{
+using StreamedTexture = int;
+constexpr StreamedTexture InvalidStreamedTexture = -1;
+
+constexpr int MaxStreamedTextures = 128;
+constexpr int MaxStreamCandidates = 8;
+
+struct TextureStreamStats
+{
+    int NumPending = 0; // Waiting for a worker, or decoded and waiting for ring space
+    int NumUploading = 0; // Upload issued, fence not signalled yet
+    int NumReady = 0;
+    int NumFailed = 0;
+    GLsizeiptr BytesUploaded = 0; // Last Update
+    double LastReadyMs = 0.0; // Since Init, when the most recent texture became ready
+};
+
+/*
+    Textures loaded without stalling the GL thread:
+        - Worker threads map (DDS/KTX2) or decode (stb_image) the file into a TextureSource
+        - Update copies decoded levels into a ring of pixel unpack buffer memory and issues the
+            uploads from there, within a per-frame byte budget, then fences them
+        - GetTexture returns a 1x1 placeholder until the upload's fence signals, the real texture after
+    Call GetTexture every frame rather than caching its result.
+*/
+struct TextureStream
+{
+    static bool Init();
+    // Joins the workers and deletes every streamed texture
+    static void Terminate();
+
+    // The first candidate that loads wins, e.g. { "x.ktx2", "x.dds", "x.jpg" }
+    static StreamedTexture Request(const char* const* Filenames, int NumFilenames);
+    static StreamedTexture Request(const char* Filename) { return Request(&Filename, 1); }
+
+    // GL thread, once per frame before anything calls GetTexture
+    static void Update();
+
+    static GLuint GetTexture(StreamedTexture Handle);
+    static bool IsReady(StreamedTexture Handle);
+    static const TextureStreamStats& GetStats();
+};
+}
+
+#endif // LOFITEXTURESTREAM_H
@@ -0,0 +1,16 @@
+#version 330
+
+in vec2 uv;
+in vec4 color;
+
+out vec4 fragment;
+
+uniform sampler2D spriteTexture;
+
+void main()
+{
+    vec4 Texel = texture(spriteTexture, uv) * color;
+    // Alpha-tested rather than blended, so batches can be drawn in any order
+    if (Texel.a < 0.5) { discard; }
+    fragment = Texel;
+}
@@ -0,0 +1,30 @@
+#version 330
+
+layout(std140) uniform FrameUniforms
+{
+    mat4 View;
+    mat4 Proj;
+    vec4 Time;
+    vec4 Fog;
+};
+
+// Unit quad: [0, 1] x [0, 1]
+in vec3 vPos;
+in vec2 vUV;
+
+// Per-instance
+in vec4 iRect; // xy: bottom-left, zw: size
+in vec4 iUVRect; // xy: UV at vUV (0, 0), zw: UV at vUV (1, 1)
+in vec4 iColor;
+in float iDepth;
+
+out vec2 uv;
+out vec4 color;
+
+void main()
+{
+    vec2 Pos = iRect.xy + vPos.xy * iRect.zw;
+    gl_Position = Proj * View * vec4(Pos, iDepth, 1.0);
+    uv = mix(iUVRect.xy, iUVRect.zw, vUV);
+    color = iColor;
+}
@@ -0,0 +1,46 @@
+#version 330
+// Permutation source, ShaderLibrary defines every LOFI_* feature below to 0 or 1 (see ShaderFeature)
+
+layout(std140) uniform FrameUniforms
+{
+    mat4 View;
+    mat4 Proj;
+    vec4 Time;
+    vec4 Fog; // rgb: color, a: density
+};
+
+#if LOFI_VERTEX_COLOR
+in vec3 color;
+#endif
+#if LOFI_TEXTURE
+in vec2 uv;
+uniform sampler2D baseTexture;
+#endif
+#if LOFI_INSTANCING
+in vec4 faceColor;
+#endif
+#if LOFI_FOG
+in float viewDepth;
+#endif
+
+out vec4 fragment;
+
+void main()
+{
+    vec4 Color = vec4(1.0);
+#if LOFI_TEXTURE
+    Color *= texture(baseTexture, uv);
+#endif
+#if LOFI_VERTEX_COLOR
+    Color.rgb *= color;
+#endif
+#if LOFI_INSTANCING
+    Color *= faceColor;
+#endif
+#if LOFI_FOG
+    // Exponential squared, density 0 turns it off
+    float FogDistance = viewDepth * Fog.a;
+    Color.rgb = mix(Fog.rgb, Color.rgb, exp(-FogDistance * FogDistance));
+#endif
+    fragment = Color;
+}
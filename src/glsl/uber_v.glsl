@@ -0,0 +1,61 @@
+#version 330
+// Permutation source, ShaderLibrary defines every LOFI_* feature below to 0 or 1 (see ShaderFeature)
+
+layout(std140) uniform FrameUniforms
+{
+    mat4 View;
+    mat4 Proj;
+    vec4 Time;
+    vec4 Fog;
+};
+
+in vec3 vPos;
+#if LOFI_VERTEX_COLOR
+in vec3 vCol;
+out vec3 color;
+#endif
+#if LOFI_TEXTURE
+in vec2 vUV;
+out vec2 uv;
+#endif
+
+// Per-instance
+in mat4 iModel;
+#if LOFI_INSTANCING
+in vec4 iFaceCol0;
+in vec4 iFaceCol1;
+in vec4 iFaceCol2;
+in vec4 iFaceCol3;
+in vec4 iFaceCol4;
+in vec4 iFaceCol5;
+out vec4 faceColor;
+#endif
+
+#if LOFI_FOG
+out float viewDepth;
+#endif
+
+void main()
+{
+    vec4 ViewPos = View * iModel * vec4(vPos, 1.0);
+    gl_Position = Proj * ViewPos;
+#if LOFI_VERTEX_COLOR
+    color = vCol;
+#endif
+#if LOFI_TEXTURE
+    uv = vUV;
+#endif
+#if LOFI_INSTANCING
+    // TexCubeVerts stores 4 verts per face: Front, Back, Top, Bottom, Left, Right
+    int Face = gl_VertexID / 4;
+    if (Face == 0) { faceColor = iFaceCol0; }
+    else if (Face == 1) { faceColor = iFaceCol1; }
+    else if (Face == 2) { faceColor = iFaceCol2; }
+    else if (Face == 3) { faceColor = iFaceCol3; }
+    else if (Face == 4) { faceColor = iFaceCol4; }
+    else { faceColor = iFaceCol5; }
+#endif
+#if LOFI_FOG
+    viewDepth = -ViewPos.z;
+#endif
+}
@@ -0,0 +1,279 @@
+/*
+    lofi-atlas -- offline texture atlas packer
+
+    Packs many small images (sticker skins, UI icons, ...) into one RGBA8 atlas so the runtime
+        can draw all of them from a single texture, see src/LofiTextureAtlas.h.
+
+    Usage:
+        lofi-atlas [--size N] [--padding N] <out_name> <image> [image ...]
+
+        Writes <out_name>.png and <out_name>.atlas. Region names are the image filenames without
+        directory or extension. A solid white region named "white" is always added so untextured
+        (solid color) sprites can share the atlas too.
+
+    Build: tools/LofiAtlas.vcxproj, or standalone since it only needs stb:
+        g++ -O2 -Ilibs tools/LofiAtlas.cpp -o lofi-atlas
+*/
+#define _CRT_SECURE_NO_WARNINGS
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb/stb_image_write.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define LOGF(...) printf(__VA_ARGS__)
+
+constexpr int AtlasChannels = 4;
+constexpr int DefaultPadding = 2;
+constexpr int MinAtlasSize = 64;
+constexpr int MaxAtlasSize = 8192;
+constexpr int WhiteRegionSize = 4;
+
+struct AtlasImage
+{
+    std::string Name;
+    int Width = 0;
+    int Height = 0;
+    std::vector<unsigned char> Pixels; // RGBA8, top-down rows
+
+    // Packed position of the padded rect
+    int X = 0;
+    int Y = 0;
+};
+
+// Skyline bottom-left: the packed area's top edge is kept as a list of horizontal segments,
+//     every rect goes wherever it ends up lowest (ties: narrowest leftover gap)
+struct SkylineNode
+{
+    int X;
+    int Y;
+    int Width;
+};
+
+struct SkylinePacker
+{
+    int Width = 0;
+    int Height = 0;
+    std::vector<SkylineNode> Skyline;
+
+    void Init(int InWidth, int InHeight)
+    {
+        Width = InWidth;
+        Height = InHeight;
+        Skyline.clear();
+        Skyline.push_back(SkylineNode{ 0, 0, InWidth });
+    }
+
+    // Y the rect would rest at if its left edge sat on node NodeIdx, -1 if it doesn't fit
+    int FitAt(size_t NodeIdx, int RectWidth, int RectHeight) const
+    {
+        const int X = Skyline[NodeIdx].X;
+        if (X + RectWidth > Width) { return -1; }
+
+        int Y = 0;
+        int WidthLeft = RectWidth;
+        for (size_t Idx = NodeIdx; WidthLeft > 0; Idx++)
+        {
+            Y = std::max(Y, Skyline[Idx].Y);
+            if (Y + RectHeight > Height) { return -1; }
+            WidthLeft -= Skyline[Idx].Width;
+        }
+        return Y;
+    }
+
+    bool Insert(int RectWidth, int RectHeight, int& OutX, int& OutY)
+    {
+        int BestIdx = -1;
+        int BestY = Height;
+        int BestWidth = Width + 1;
+        for (size_t NodeIdx = 0; NodeIdx < Skyline.size(); NodeIdx++)
+        {
+            const int Y = FitAt(NodeIdx, RectWidth, RectHeight);
+            if (Y < 0) { continue; }
+            if (Y < BestY || (Y == BestY && Skyline[NodeIdx].Width < BestWidth))
+            {
+                BestIdx = (int)NodeIdx;
+                BestY = Y;
+                BestWidth = Skyline[NodeIdx].Width;
+            }
+        }
+        if (BestIdx < 0) { return false; }
+
+        OutX = Skyline[BestIdx].X;
+        OutY = BestY;
+
+        // New segment on top of the rect, then trim whatever it now shadows
+        Skyline.insert(Skyline.begin() + BestIdx, SkylineNode{ OutX, OutY + RectHeight, RectWidth });
+        for (size_t Idx = BestIdx + 1; Idx < Skyline.size();)
+        {
+            SkylineNode& Prev = Skyline[Idx - 1];
+            SkylineNode& Curr = Skyline[Idx];
+            const int Shadowed = Prev.X + Prev.Width - Curr.X;
+            if (Shadowed <= 0) { break; }
+            if (Shadowed < Curr.Width)
+            {
+                Curr.X += Shadowed;
+                Curr.Width -= Shadowed;
+                break;
+            }
+            Skyline.erase(Skyline.begin() + Idx);
+        }
+
+        // Merge neighbours at the same height
+        for (size_t Idx = 1; Idx < Skyline.size();)
+        {
+            if (Skyline[Idx - 1].Y == Skyline[Idx].Y)
+            {
+                Skyline[Idx - 1].Width += Skyline[Idx].Width;
+                Skyline.erase(Skyline.begin() + Idx);
+            }
+            else { Idx++; }
+        }
+        return true;
+    }
+};
+
+bool PackAll(std::vector<AtlasImage>& Images, int Padding, int AtlasWidth, int AtlasHeight)
+{
+    SkylinePacker Packer;
+    Packer.Init(AtlasWidth, AtlasHeight);
+    for (AtlasImage& Image : Images)
+    {
+        if (!Packer.Insert(Image.Width + Padding * 2, Image.Height + Padding * 2, Image.X, Image.Y)) { return false; }
+    }
+    return true;
+}
+
+// Copies the image into its padded rect, extruding the border texels into the padding so
+//     bilinear filtering at the region's edge never picks up a neighbour
+void BlitExtruded(const AtlasImage& Image, int Padding, unsigned char* Atlas, int AtlasWidth)
+{
+    const int PaddedWidth = Image.Width + Padding * 2;
+    const int PaddedHeight = Image.Height + Padding * 2;
+    for (int Y = 0; Y < PaddedHeight; Y++)
+    {
+        const int SrcY = std::min(std::max(Y - Padding, 0), Image.Height - 1);
+        for (int X = 0; X < PaddedWidth; X++)
+        {
+            const int SrcX = std::min(std::max(X - Padding, 0), Image.Width - 1);
+            const unsigned char* Src = &Image.Pixels[(SrcY * Image.Width + SrcX) * AtlasChannels];
+            unsigned char* Dst = &Atlas[((Image.Y + Y) * AtlasWidth + (Image.X + X)) * AtlasChannels];
+            memcpy(Dst, Src, AtlasChannels);
+        }
+    }
+}
+
+std::string GetRegionName(const char* Filename)
+{
+    std::string Name = Filename;
+    const size_t SlashIdx = Name.find_last_of("/\\");
+    if (SlashIdx != std::string::npos) { Name = Name.substr(SlashIdx + 1); }
+    const size_t DotIdx = Name.find_last_of('.');
+    if (DotIdx != std::string::npos) { Name = Name.substr(0, DotIdx); }
+    // The table is whitespace separated
+    std::replace(Name.begin(), Name.end(), ' ', '_');
+    return Name;
+}
+
+void PrintUsage()
+{
+    LOGF("Usage: lofi-atlas [--size N] [--padding N] <out_name> <image> [image ...]\n");
+}
+
+int main(int argc, const char* argv[])
+{
+    int FixedSize = 0;
+    int Padding = DefaultPadding;
+    const char* OutName = nullptr;
+    std::vector<const char*> Inputs;
+    for (int ArgIdx = 1; ArgIdx < argc; ArgIdx++)
+    {
+        const char* Arg = argv[ArgIdx];
+        if (0 == strcmp(Arg, "--size") && ArgIdx + 1 < argc) { FixedSize = atoi(argv[++ArgIdx]); }
+        else if (0 == strcmp(Arg, "--padding") && ArgIdx + 1 < argc) { Padding = std::max(0, atoi(argv[++ArgIdx])); }
+        else if (!OutName) { OutName = Arg; }
+        else { Inputs.push_back(Arg); }
+    }
+    if (!OutName || Inputs.empty()) { PrintUsage(); return -1; }
+
+    std::vector<AtlasImage> Images;
+    {
+        AtlasImage White;
+        White.Name = "white";
+        White.Width = WhiteRegionSize;
+        White.Height = WhiteRegionSize;
+        White.Pixels.assign(WhiteRegionSize * WhiteRegionSize * AtlasChannels, 0xFF);
+        Images.push_back(White);
+    }
+    for (const char* Input : Inputs)
+    {
+        AtlasImage Image;
+        int Channels = 0;
+        unsigned char* Data = stbi_load(Input, &Image.Width, &Image.Height, &Channels, AtlasChannels);
+        if (!Data) { LOGF("lofi-atlas: failed to load %s (%s)\n", Input, stbi_failure_reason()); return -1; }
+        Image.Name = GetRegionName(Input);
+        Image.Pixels.assign(Data, Data + Image.Width * Image.Height * AtlasChannels);
+        stbi_image_free(Data);
+        for (const AtlasImage& Other : Images)
+        {
+            if (Other.Name == Image.Name) { LOGF("lofi-atlas: duplicate region name %s (%s)\n", Image.Name.c_str(), Input); return -1; }
+        }
+        Images.push_back(std::move(Image));
+    }
+
+    // Tallest first keeps the skyline flat; ties broken widest first
+    std::sort(Images.begin(), Images.end(), [](const AtlasImage& A, const AtlasImage& B)
+    {
+        return A.Height != B.Height ? A.Height > B.Height : A.Width > B.Width;
+    });
+
+    // Smallest power-of-two square (or 2:1) atlas that holds everything
+    int AtlasWidth = FixedSize > 0 ? FixedSize : MinAtlasSize;
+    int AtlasHeight = AtlasWidth;
+    bool bPacked = PackAll(Images, Padding, AtlasWidth, AtlasHeight);
+    while (!bPacked && FixedSize <= 0 && AtlasWidth <= MaxAtlasSize)
+    {
+        if (AtlasWidth == AtlasHeight) { AtlasWidth *= 2; }
+        else { AtlasHeight *= 2; }
+        if (AtlasWidth > MaxAtlasSize) { break; }
+        bPacked = PackAll(Images, Padding, AtlasWidth, AtlasHeight);
+    }
+    if (!bPacked) { LOGF("lofi-atlas: images don't fit in %dx%d\n", AtlasWidth, AtlasHeight); return -1; }
+
+    std::vector<unsigned char> AtlasPixels((size_t)AtlasWidth * AtlasHeight * AtlasChannels, 0);
+    long long UsedTexels = 0;
+    for (const AtlasImage& Image : Images)
+    {
+        BlitExtruded(Image, Padding, AtlasPixels.data(), AtlasWidth);
+        UsedTexels += (long long)Image.Width * Image.Height;
+    }
+
+    const std::string ImageFilename = std::string(OutName) + ".png";
+    const std::string TableFilename = std::string(OutName) + ".atlas";
+    if (!stbi_write_png(ImageFilename.c_str(), AtlasWidth, AtlasHeight, AtlasChannels, AtlasPixels.data(), AtlasWidth * AtlasChannels))
+    {
+        LOGF("lofi-atlas: failed to write %s\n", ImageFilename.c_str());
+        return -1;
+    }
+
+    FILE* TableFile = fopen(TableFilename.c_str(), "wb");
+    if (!TableFile) { LOGF("lofi-atlas: failed to write %s\n", TableFilename.c_str()); return -1; }
+    // Texel rects of the unpadded images, rows top-down as stored in the .png
+    fprintf(TableFile, "# lofi-atlas: <name> <x> <y> <width> <height>\n");
+    fprintf(TableFile, "atlas %d %d %d\n", AtlasWidth, AtlasHeight, (int)Images.size());
+    for (const AtlasImage& Image : Images)
+    {
+        fprintf(TableFile, "%s %d %d %d %d\n", Image.Name.c_str(), Image.X + Padding, Image.Y + Padding, Image.Width, Image.Height);
+    }
+    fclose(TableFile);
+
+    LOGF("lofi-atlas: %d regions -> %s (%dx%d, %.1f%% used)\n", (int)Images.size(), ImageFilename.c_str(),
+        AtlasWidth, AtlasHeight, 100.0 * (double)UsedTexels / ((double)AtlasWidth * AtlasHeight));
+    return 0;
+}
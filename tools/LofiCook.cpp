@@ -0,0 +1,300 @@
+/*
+    lofi-cook -- offline texture cooker
+
+    Decodes a source image once and writes a KTX2 file holding the full mip chain, RGB8 for images
+        without alpha and RGBA8 otherwise, so the runtime (TextureLoader::LoadContainer) maps the file
+        and uploads it level by level with no image decode and no glGenerateMipmap at startup.
+    Output goes to <name>.cooked.ktx2 by convention, leaving <name>.ktx2 to block-compressed textures
+        built by other tools; the runtime tries those first.
+
+    Mips are a 2x2 box filter evaluated in linear light: texels are decoded from sRGB, averaged,
+        and re-encoded, so dark/bright edges don't darken the way a naive average of sRGB bytes does.
+        --linear skips the sRGB round trip for data textures (normal maps, masks, ...).
+
+    Usage:
+        lofi-cook [--linear] <input image> <output.cooked.ktx2>
+        e.g. lofi-cook assets/feels.jpg assets/feels.cooked.ktx2
+
+    Build: tools/LofiCook.vcxproj, or standalone since it only needs stb:
+        g++ -O2 -Ilibs tools/LofiCook.cpp -o lofi-cook
+*/
+#define _CRT_SECURE_NO_WARNINGS
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define LOFI_COOK_SSE 1
+#else
+#define LOFI_COOK_SSE 0
+#endif
+
+#define LOGF(...) printf(__VA_ARGS__)
+
+constexpr int MaxCookLevels = 16;
+constexpr int LinearToSRGBTableSize = 4096;
+
+// VkFormat values, the loader maps them to GL_RGB8 / GL_RGBA8
+constexpr uint32_t VK_FORMAT_R8G8B8_UNORM = 23;
+constexpr uint32_t VK_FORMAT_R8G8B8_SRGB = 29;
+constexpr uint32_t VK_FORMAT_R8G8B8A8_UNORM = 37;
+constexpr uint32_t VK_FORMAT_R8G8B8A8_SRGB = 43;
+
+struct CookState_t
+{
+    float SRGBToLinear[256];
+    uint8_t LinearToSRGB[LinearToSRGBTableSize];
+} CookState;
+
+void InitConversionTables()
+{
+    for (int Value = 0; Value < 256; Value++)
+    {
+        const float Encoded = Value / 255.0f;
+        CookState.SRGBToLinear[Value] = Encoded <= 0.04045f ? Encoded / 12.92f : powf((Encoded + 0.055f) / 1.055f, 2.4f);
+    }
+    for (int Idx = 0; Idx < LinearToSRGBTableSize; Idx++)
+    {
+        const float Linear = (Idx + 0.5f) / LinearToSRGBTableSize;
+        const float Encoded = Linear <= 0.0031308f ? Linear * 12.92f : 1.055f * powf(Linear, 1.0f / 2.4f) - 0.055f;
+        CookState.LinearToSRGB[Idx] = (uint8_t)(Encoded * 255.0f + 0.5f);
+    }
+}
+
+// Float RGBA, alpha always linear
+struct FloatImage
+{
+    int Width = 0;
+    int Height = 0;
+    std::vector<float> Texels;
+};
+
+void Decode(const uint8_t* Src, int Width, int Height, bool bSRGB, FloatImage& OutImage)
+{
+    OutImage.Width = Width;
+    OutImage.Height = Height;
+    OutImage.Texels.resize((size_t)Width * Height * 4);
+    for (size_t Idx = 0; Idx < (size_t)Width * Height; Idx++)
+    {
+        for (int Channel = 0; Channel < 3; Channel++)
+        {
+            const uint8_t Value = Src[Idx * 4 + Channel];
+            OutImage.Texels[Idx * 4 + Channel] = bSRGB ? CookState.SRGBToLinear[Value] : Value / 255.0f;
+        }
+        OutImage.Texels[Idx * 4 + 3] = Src[Idx * 4 + 3] / 255.0f;
+    }
+}
+
+void Encode(const FloatImage& Image, bool bSRGB, std::vector<uint8_t>& OutBytes)
+{
+    OutBytes.resize(Image.Texels.size());
+    for (size_t Idx = 0; Idx < Image.Texels.size(); Idx++)
+    {
+        float Value = Image.Texels[Idx];
+        Value = Value < 0.0f ? 0.0f : (Value > 1.0f ? 1.0f : Value);
+        const bool bAlpha = (Idx & 3) == 3;
+        if (bSRGB && !bAlpha)
+        {
+            const int TableIdx = (int)(Value * (LinearToSRGBTableSize - 1) + 0.5f);
+            OutBytes[Idx] = CookState.LinearToSRGB[TableIdx];
+        }
+        else
+        {
+            OutBytes[Idx] = (uint8_t)(Value * 255.0f + 0.5f);
+        }
+    }
+}
+
+// 2x2 box filter, one RGBA texel per SSE register; odd edges reuse the last row/column
+void Downsample(const FloatImage& Src, FloatImage& OutDst)
+{
+    OutDst.Width = Src.Width > 1 ? Src.Width / 2 : 1;
+    OutDst.Height = Src.Height > 1 ? Src.Height / 2 : 1;
+    OutDst.Texels.resize((size_t)OutDst.Width * OutDst.Height * 4);
+
+    for (int Y = 0; Y < OutDst.Height; Y++)
+    {
+        const int SrcY0 = Y * 2 < Src.Height ? Y * 2 : Src.Height - 1;
+        const int SrcY1 = Y * 2 + 1 < Src.Height ? Y * 2 + 1 : Src.Height - 1;
+        const float* Row0 = &Src.Texels[(size_t)SrcY0 * Src.Width * 4];
+        const float* Row1 = &Src.Texels[(size_t)SrcY1 * Src.Width * 4];
+        float* DstRow = &OutDst.Texels[(size_t)Y * OutDst.Width * 4];
+        for (int X = 0; X < OutDst.Width; X++)
+        {
+            const int SrcX0 = (X * 2 < Src.Width ? X * 2 : Src.Width - 1) * 4;
+            const int SrcX1 = (X * 2 + 1 < Src.Width ? X * 2 + 1 : Src.Width - 1) * 4;
+#if LOFI_COOK_SSE
+            const __m128 Sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(Row0 + SrcX0), _mm_loadu_ps(Row0 + SrcX1)),
+                _mm_add_ps(_mm_loadu_ps(Row1 + SrcX0), _mm_loadu_ps(Row1 + SrcX1)));
+            _mm_storeu_ps(DstRow + X * 4, _mm_mul_ps(Sum, _mm_set1_ps(0.25f)));
+#else
+            for (int Channel = 0; Channel < 4; Channel++)
+            {
+                DstRow[X * 4 + Channel] = 0.25f * (Row0[SrcX0 + Channel] + Row0[SrcX1 + Channel] +
+                    Row1[SrcX0 + Channel] + Row1[SrcX1 + Channel]);
+            }
+#endif
+        }
+    }
+}
+
+// RGBA8 -> RGB8 in place
+void StripAlpha(std::vector<uint8_t>& Texels)
+{
+    const size_t NumTexels = Texels.size() / 4;
+    for (size_t Idx = 0; Idx < NumTexels; Idx++)
+    {
+        Texels[Idx * 3 + 0] = Texels[Idx * 4 + 0];
+        Texels[Idx * 3 + 1] = Texels[Idx * 4 + 1];
+        Texels[Idx * 3 + 2] = Texels[Idx * 4 + 2];
+    }
+    Texels.resize(NumTexels * 3);
+}
+
+void Write32(std::vector<uint8_t>& Out, uint32_t Value) { Out.insert(Out.end(), (uint8_t*)&Value, (uint8_t*)&Value + 4); }
+void Write64(std::vector<uint8_t>& Out, uint64_t Value) { Out.insert(Out.end(), (uint8_t*)&Value, (uint8_t*)&Value + 8); }
+
+// Khronos basic data format descriptor for 8-bit RGB (3 channels) or RGBA (4)
+void WriteDFD(std::vector<uint8_t>& Out, int NumChannels, bool bSRGB)
+{
+    const uint32_t NumSamples = (uint32_t)NumChannels;
+    const uint32_t BlockSize = 24 + 16 * NumSamples;
+    Write32(Out, 4 + BlockSize); // dfdTotalSize
+    Write32(Out, 0); // vendorId = Khronos, descriptorType = basic
+    Write32(Out, 2 | (BlockSize << 16)); // versionNumber = 1.3, descriptorBlockSize
+    Write32(Out, 1 | (1 << 8) | ((bSRGB ? 2u : 1u) << 16)); // colorModel RGBSDA, primaries BT709, transfer sRGB/linear
+    Write32(Out, 0); // texelBlockDimension: 1x1x1x1
+    Write32(Out, NumSamples); // bytesPlane0
+    Write32(Out, 0);
+    const uint32_t ChannelIds[4] = { 0, 1, 2, 15 | 0x10 }; // R, G, B, A (alpha is always linear)
+    for (uint32_t SampleIdx = 0; SampleIdx < NumSamples; SampleIdx++)
+    {
+        Write32(Out, (SampleIdx * 8) | (7 << 16) | (ChannelIds[SampleIdx] << 24)); // bitOffset, bitLength - 1, channelType
+        Write32(Out, 0); // samplePosition
+        Write32(Out, 0); // sampleLower
+        Write32(Out, 255); // sampleUpper
+    }
+}
+
+// Levels hold tightly packed texels of NumChannels bytes
+bool WriteKTX2(const char* Filename, const std::vector<std::vector<uint8_t>>& Levels, int Width, int Height, int NumChannels, bool bSRGB)
+{
+    static const uint8_t KTX2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+    const uint32_t NumLevels = (uint32_t)Levels.size();
+
+    std::vector<uint8_t> DFD;
+    WriteDFD(DFD, NumChannels, bSRGB);
+
+    const uint32_t LevelIndexOffset = 12 + 36 + 32;
+    const uint32_t DFDOffset = LevelIndexOffset + 24 * NumLevels;
+    // Level data is stored smallest first, each level aligned to lcm(texel size, 4): 4 for RGBA8, 12 for RGB8
+    const uint64_t LevelAlignment = NumChannels == 4 ? 4 : 12;
+    std::vector<uint64_t> LevelOffsets(NumLevels);
+    uint64_t DataOffset = DFDOffset + (uint32_t)DFD.size();
+    for (int LevelIdx = (int)NumLevels - 1; LevelIdx >= 0; LevelIdx--)
+    {
+        DataOffset = (DataOffset + LevelAlignment - 1) / LevelAlignment * LevelAlignment;
+        LevelOffsets[LevelIdx] = DataOffset;
+        DataOffset += Levels[LevelIdx].size();
+    }
+
+    std::vector<uint8_t> Out(KTX2Identifier, KTX2Identifier + sizeof(KTX2Identifier));
+    if (NumChannels == 4) { Write32(Out, bSRGB ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM); }
+    else { Write32(Out, bSRGB ? VK_FORMAT_R8G8B8_SRGB : VK_FORMAT_R8G8B8_UNORM); }
+    Write32(Out, 1); // typeSize
+    Write32(Out, (uint32_t)Width);
+    Write32(Out, (uint32_t)Height);
+    Write32(Out, 0); // pixelDepth
+    Write32(Out, 0); // layerCount
+    Write32(Out, 1); // faceCount
+    Write32(Out, NumLevels);
+    Write32(Out, 0); // supercompressionScheme
+    Write32(Out, DFDOffset);
+    Write32(Out, (uint32_t)DFD.size());
+    Write32(Out, 0); // kvdByteOffset
+    Write32(Out, 0); // kvdByteLength
+    Write64(Out, 0); // sgdByteOffset
+    Write64(Out, 0); // sgdByteLength
+    for (uint32_t LevelIdx = 0; LevelIdx < NumLevels; LevelIdx++)
+    {
+        Write64(Out, LevelOffsets[LevelIdx]);
+        Write64(Out, Levels[LevelIdx].size());
+        Write64(Out, Levels[LevelIdx].size());
+    }
+    Out.insert(Out.end(), DFD.begin(), DFD.end());
+    for (int LevelIdx = (int)NumLevels - 1; LevelIdx >= 0; LevelIdx--)
+    {
+        Out.resize((size_t)LevelOffsets[LevelIdx], 0);
+        Out.insert(Out.end(), Levels[LevelIdx].begin(), Levels[LevelIdx].end());
+    }
+
+    FILE* File = fopen(Filename, "wb");
+    if (!File) { return false; }
+    const bool bResult = fwrite(Out.data(), 1, Out.size(), File) == Out.size();
+    fclose(File);
+    return bResult;
+}
+
+int main(int argc, const char* argv[])
+{
+    bool bSRGB = true;
+    const char* InputFilename = nullptr;
+    const char* OutputFilename = nullptr;
+    for (int ArgIdx = 1; ArgIdx < argc; ArgIdx++)
+    {
+        if (0 == strcmp(argv[ArgIdx], "--linear")) { bSRGB = false; }
+        else if (!InputFilename) { InputFilename = argv[ArgIdx]; }
+        else if (!OutputFilename) { OutputFilename = argv[ArgIdx]; }
+    }
+    if (!InputFilename || !OutputFilename)
+    {
+        LOGF("Usage: lofi-cook [--linear] <input image> <output.cooked.ktx2>\n");
+        return -1;
+    }
+
+    int Width = 0, Height = 0, Channels = 0;
+    uint8_t* SourceData = stbi_load(InputFilename, &Width, &Height, &Channels, 4);
+    if (!SourceData) { LOGF("lofi-cook: failed to load %s (%s)\n", InputFilename, stbi_failure_reason()); return -1; }
+
+    InitConversionTables();
+    // Grey and RGB sources have nothing in alpha, storing it would cost a third more memory for nothing
+    const int NumChannels = (Channels == 2 || Channels == 4) ? 4 : 3;
+
+    // Level 0 is the source bytes untouched, every smaller level is filtered from the previous float level
+    std::vector<std::vector<uint8_t>> Levels;
+    Levels.emplace_back(SourceData, SourceData + (size_t)Width * Height * 4);
+    FloatImage Curr;
+    Decode(SourceData, Width, Height, bSRGB, Curr);
+    stbi_image_free(SourceData);
+
+    while ((Curr.Width > 1 || Curr.Height > 1) && (int)Levels.size() < MaxCookLevels)
+    {
+        FloatImage Next;
+        Downsample(Curr, Next);
+        Levels.emplace_back();
+        Encode(Next, bSRGB, Levels.back());
+        Curr = std::move(Next);
+    }
+    if (NumChannels == 3)
+    {
+        for (std::vector<uint8_t>& Level : Levels) { StripAlpha(Level); }
+    }
+
+    if (!WriteKTX2(OutputFilename, Levels, Width, Height, NumChannels, bSRGB))
+    {
+        LOGF("lofi-cook: failed to write %s\n", OutputFilename);
+        return -1;
+    }
+
+    size_t TotalBytes = 0;
+    for (const std::vector<uint8_t>& Level : Levels) { TotalBytes += Level.size(); }
+    LOGF("lofi-cook: %s -> %s (%dx%d %s, %d levels, %.1f KB, %s)\n", InputFilename, OutputFilename, Width, Height,
+        NumChannels == 4 ? "RGBA8" : "RGB8", (int)Levels.size(), TotalBytes / 1024.0, bSRGB ? "sRGB" : "linear");
+    return 0;
+}